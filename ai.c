@@ -0,0 +1,135 @@
+/*
+********************************************************************************
+* name   :  ai.c
+* author :  Rasmus Kallqvist, 2017
+* brief  :  Computer player 2 for single player games. Plays through the
+*           same potentiometer values as a person would, see pong_step().
+*           Does not touch the hardware, so it also runs in host tools.
+********************************************************************************
+*/
+
+/* Includes ------------------------------------------------------------------*/
+#include "ai.h"
+
+/* Local variables -----------------------------------------------------------*/
+/* Reaction time in ms, aim error in pixels and racket speed in pixels per
+   update step for each difficulty level. Against tools/pongsim.c's
+   default tracking bot they win about 8%, 20%, 51% and 95% of matches. */
+static const uint16_t ai_level_delay_ms[AI_LEVELS]	= {500, 300, 180, 80};
+static const uint16_t ai_level_error[AI_LEVELS]		= { 10,   9,   8,  7};
+static const int32_t  ai_level_speed[AI_LEVELS]		= {FIX_CONST(0.25),
+													   FIX_CONST(0.35),
+													   FIX_CONST(0.5),
+													   FIX_CONST(0.75)};
+
+/* Function definitions ------------------------------------------------------*/
+/* Brief  : Sets up a computer player of difficulty level, 0 to
+ *          AI_LEVELS - 1, for the game in ctx. The seed picks the aim errors.
+ * Author : Rasmus Kallqvist */
+void ai_setup(struct pong_ai *ai, const struct pong_ctx *ctx, uint8_t level,
+			  uint32_t seed)
+{
+	int32_t range = 32 - ctx->right_racket.h; /* see pong_update_step() */
+
+	if(level >= AI_LEVELS)
+		level = AI_LEVELS - 1;
+	memset(ai, 0, sizeof(*ai));
+	ai->delay_steps = ai_level_delay_ms[level] * PONG_UPDATE_HZ / 1000;
+	ai->error = ai_level_error[level];
+	ai->speed = FIX_ROUND(ai_level_speed[level] * 1024 / range);
+	ai->seed = seed;
+	ai->target = ai->analog = 512;
+	ai->state = ctx->state;
+}
+
+/* Brief  : Returns the potentiometer value of the computer player for the
+ *          next update step. Costs a few compares and adds per step, the
+ *          plan is only made again once the ball has turned around at a
+ *          racket or been served, after the reaction time.
+ * Author : Rasmus Kallqvist */
+uint16_t ai_work(struct pong_ai *ai, const struct pong_ctx *ctx)
+{
+	uint8_t moving_right = ctx->ball.dx > 0;
+
+	/* Ball hit a racket, or was served */
+	if(moving_right != ai->moving_right || ctx->state != ai->state)
+	{
+		ai->moving_right = moving_right;
+		ai->state = ctx->state;
+		ai->wait = ai->delay_steps;
+		ai->planned = 0;
+	}
+
+	/* Plan when reaction time is up */
+	if(ai->wait)
+		ai->wait--;
+	else if(!ai->planned)
+	{
+		ai_plan(ai, ctx);
+		ai->planned = 1;
+	}
+
+	/* Turn the knob towards target, no faster than speed */
+	if(ai->analog + ai->speed < ai->target)
+		ai->analog += ai->speed;
+	else if(ai->analog > ai->target + ai->speed)
+		ai->analog -= ai->speed;
+	else
+		ai->analog = ai->target;
+	return ai->analog;
+}
+
+/* Brief  : Picks the potentiometer value that meets the ball with the middle
+ *          of the racket, missing by up to the aim error. Returns to the
+ *          middle of the screen while the ball moves away.
+ * Author : Rasmus Kallqvist */
+void ai_plan(struct pong_ai *ai, const struct pong_ctx *ctx)
+{
+	const struct actor *racket = &ctx->right_racket;
+	int32_t range = 32 - racket->h;
+	int32_t y, row;
+
+	/* Racket top for the ball's centre at the racket, or the middle */
+	if(ctx->ball.dx > 0 && ctx->state == round_playing)
+		y = ai_intercept(ctx) + FIX_FROM_INT(ctx->ball.h - racket->h) / 2;
+	else
+		y = FIX_FROM_INT(32 - racket->h) / 2;
+
+	/* Aim error, from -error to error pixels */
+	ai->seed = ai->seed * 1664525 + 1013904223;
+	y += FIX_FROM_INT((int32_t)((ai->seed >> 16) % (2 * ai->error + 1)) -
+					  ai->error);
+
+	/* Inverse of the racket position in pong_update_step() */
+	row = FIX_ROUND(y);
+	row = row < 0 ? 0 : (row > range ? range : row);
+	row = (row * 1024 + range - 1) / range;
+	ai->target = row > 1023 ? 1023 : row;
+}
+
+/* Brief  : Returns the row in Q16.16 the ball will be at when it reaches the
+ *          right racket. Bounces off the roof and floor are folded in
+ *          instead of simulated, the ball moves along a straight line in
+ *          y and every wall bounce mirrors it back between the walls.
+ * Author : Rasmus Kallqvist */
+int32_t ai_intercept(const struct pong_ctx *ctx)
+{
+	const struct actor *ball = &ctx->ball;
+	int32_t plane = ctx->right_racket.x - FIX_FROM_INT(ball->w);
+	int32_t span = FIX_FROM_INT(FIELD_BOTTOM - FIELD_TOP - ball->h);
+	int32_t y;
+
+	if(ball->dx <= 0 || ball->x >= plane)
+		return ball->y;
+
+	/* Row at the racket without walls, then folded into 0 to 2 * span
+	   and mirrored back on the way up */
+	y = ball->y - FIX_FROM_INT(FIELD_TOP) +
+		(int32_t)((int64_t)(plane - ball->x) * ball->dy / ball->dx);
+	y %= 2 * span;
+	if(y < 0)
+		y += 2 * span;
+	if(y > span)
+		y = 2 * span - y;
+	return y + FIX_FROM_INT(FIELD_TOP);
+}
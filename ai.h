@@ -0,0 +1,48 @@
+/*
+********************************************************************************
+* name   :  ai.h
+* author :  Rasmus Kallqvist, 2017
+* brief  :  Header for ai.c
+********************************************************************************
+*/
+
+#ifndef AI_H
+#define AI_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>  	/* Declarations of uint_32 and the like */
+#include "pong.h"		/* Game state the AI plays from */
+#include "fixed.h"		/* Q16.16 fixed point arithmetic */
+
+/* Defines -------------------------------------------------------------------*/
+#define		AI_LEVELS			4	/* Difficulty levels, 0 is easiest */
+
+/* Structs -------------------------------------------------------------------*/
+/* Brief  : Computer player for the right racket. The point where the ball
+ *          will reach the racket is worked out once per racket hit or
+ *          serve, each update step only moves the racket towards it.
+ * Author : Rasmus Kallqvist */
+struct pong_ai
+{
+	/* Difficulty */
+	uint16_t delay_steps;		/* Reaction time, update steps */
+	uint16_t error;				/* Aim is off by up to this many pixels */
+	uint16_t speed;				/* Potentiometer units per update step */
+	/* Plan */
+	uint32_t seed;				/* Aim error random generator */
+	uint16_t wait;				/* Steps left before planning */
+	uint8_t planned;
+	uint8_t moving_right;		/* Ball direction the plan is for */
+	enum game_state state;		/* Game state the plan is for */
+	uint16_t target;			/* Potentiometer value to move to */
+	uint16_t analog;			/* Potentiometer value being played */
+};
+
+/* Function prototypes -------------------------------------------------------*/
+void ai_setup(struct pong_ai *ai, const struct pong_ctx *ctx, uint8_t level,
+			  uint32_t seed);
+uint16_t ai_work(struct pong_ai *ai, const struct pong_ctx *ctx);
+void ai_plan(struct pong_ai *ai, const struct pong_ctx *ctx);
+int32_t ai_intercept(const struct pong_ctx *ctx);
+
+#endif /* AI_H */
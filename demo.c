@@ -229,3 +229,18 @@ void demo_unfilled_rectangle(void)
 	display_draw_rect(2,18, 2+6,18+6, 1);
 	display_update();
 }
+
+/* Brief  : Demo of display.c function, scrolls a cosine wave drawn from the
+ *			fixed point cosine table
+ * Author : Rasmus Kallqvist */
+void demo_cycling_cosine(void)
+{
+	static uint32_t phase;
+
+	display_cls();
+	display_draw_cos(64, phase);
+	display_update();
+
+	/* Move wave a few degrees per update */
+	phase = (phase + 6) % 360;
+}
@@ -8,6 +8,7 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include <stdint.h>
+#include "display.h"	/* OLED display device drivers and draw functions */
 
 /* Function declarations -----------------------------------------------------*/
 void demo_bouncing_ball(void);
@@ -17,6 +18,7 @@ void demo_update_counting(void);
 void demo_get_btn(void);
 void demo_unset_pixel(void);
 void demo_unfilled_rectangle(void);
+void demo_cycling_cosine(void);
 
 /* Brief  : Test struct for pong ball
 * Author : Michel Bitar */
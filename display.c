@@ -15,8 +15,64 @@
 /* Includes ------------------------------------------------------------------*/
 #include "display.h"
 
+/* Enums ---------------------------------------------------------------------*/
+enum flush_phase {flush_idle, flush_command, flush_data};
+enum power_step  {power_off, power_vdd, power_reset, power_vbat, power_on};
+
 /* Local variables -----------------------------------------------------------*/
-static uint8_t screen_content[128][4];
+/* Double buffered screen, drawing goes to the back buffer while the front
+   buffer is sent to the display. display_swap() exchanges the two. Buffers
+   are page-major, [page][column], the same order the display is written in.
+   Storage is declared as words so fills can write 4 columns at a time. */
+static uint32_t screen_words[2][4][DISPLAY_WIDTH / 4];
+static uint8_t (*screen_back)[128]  = (uint8_t (*)[128]) screen_words[0];
+static uint8_t (*screen_front)[128] = (uint8_t (*)[128]) screen_words[1];
+static uint8_t screen_dirty_lo[4];  /* First column where back and front     */
+static uint8_t screen_dirty_hi[4];  /* might differ, and last such column    */
+static uint8_t screen_resync;       /* Resend all, display contents unknown  */
+static uint32_t screen_frames;      /* Frames swapped to front since boot    */
+static uint32_t spi_byte_count;     /* Bytes sent over spi since boot        */
+static uint32_t spi_cmd_count;      /* Addressing command bytes since boot   */
+static uint32_t screen_touched;     /* Back buffer bytes written since boot  */
+/* Pages drawn to, and rows drawn to instead of the back buffer, see
+   display_draw_to() */
+static uint8_t (*draw_rows)[128];
+static uint8_t draw_first_page;
+static uint8_t draw_num_pages = 4;
+/* Static background layer, copied into the back buffer at start of frame */
+static uint32_t layer_words[4][DISPLAY_WIDTH / 4];
+static uint8_t layer_valid;         /* Layer is drawn and up to date         */
+/* Interrupt driven flush */
+static volatile enum flush_phase flush_phase = flush_idle;
+static volatile uint8_t flush_page; /* Page currently being sent             */
+static volatile uint8_t flush_last; /* Last page sent without new addressing */
+static volatile uint8_t flush_col;  /* Next column to send in current page   */
+static volatile uint8_t flush_pos;  /* Next command byte to send             */
+static uint8_t flush_lo[4];         /* Changed spans of the front buffer     */
+static uint8_t flush_hi[4];
+static uint8_t flush_cmd[6];        /* Page and column commands for the page */
+static uint8_t flush_cmd_len;
+static enum display_flush_mode flush_mode = display_flush_paged;
+static uint8_t flush_home;          /* Burst mode, ram pointer at top left   */
+/* Controller side effects */
+static uint8_t scroll_active;       /* Hardware scroll running, ram locked   */
+/* Timed power up */
+static volatile enum power_step power_step = power_off;
+
+/* Local function prototypes -------------------------------------------------*/
+static void display_swap(void);
+static void flush_span(uint8_t page);
+static uint8_t *screen_row(int page);
+static void screen_touch(uint8_t x0, uint8_t x1, uint8_t page);
+static void screen_fill(uint8_t x0, uint8_t y0,
+                        uint8_t x1, uint8_t y1, uint8_t col);
+static void screen_fill_columns(uint8_t x0, uint8_t x1, uint8_t page,
+                                uint8_t mask, uint8_t col);
+static uint8_t flush_next_page(uint8_t page);
+static uint8_t flush_plan(uint8_t page);
+static void flush_program_mode(void);
+static void display_command(const uint8_t *cmds, uint8_t num_cmds);
+static void flush_send(uint8_t data);
 
 /* Function definitions ------------------------------------------------------*/
 /* Brief  : Sets a single pixel in the byte-representation of the oled display.
@@ -26,15 +82,23 @@ static uint8_t screen_content[128][4];
  * Author : Rasmus Kallqvist */
 void display_set_pixel(uint8_t x, uint8_t y)
 {
-    uint8_t bit_offset = y % 8;                 /* Offset is the remainder  */
-    uint8_t byte_select = (y - bit_offset) / 8; /* Select is floor function */
+    uint8_t bit_offset = y & 0x7;               /* Offset is the remainder  */
+    uint8_t byte_select = y >> 3;               /* Select is floor function */
+    uint8_t *row;
 
     /* Check if valid coordinates */
     if(x < 0 || x > 127 || y < 0 || y > 31)
         return;
+    row = screen_row(byte_select);
+    if(!row)
+        return;
 
-    /* Copy to screen */
-    screen_content[x][byte_select] |= 0x1 << bit_offset;
+    /* Copy to screen, remember column if the byte changed */
+    if(!(row[x] & (0x1 << bit_offset)))
+    {
+        row[x] |= 0x1 << bit_offset;
+        screen_touch(x, x, byte_select);
+    }
 
     return;
 }
@@ -43,165 +107,586 @@ void display_set_pixel(uint8_t x, uint8_t y)
  * Author : Rasmus Kallqvist */
 void display_unset_pixel(uint8_t x, uint8_t y)
 {
-    uint8_t bit_offset = y % 8;                 /* Offset is the remainder  */
-    uint8_t byte_select = (y - bit_offset) / 8; /* Select is floor function */
+    uint8_t bit_offset = y & 0x7;               /* Offset is the remainder  */
+    uint8_t byte_select = y >> 3;               /* Select is floor function */
+    uint8_t *row;
 
     /* Check if valid coordinates */
     if(x < 0 || x > 127 || y < 0 || y > 31)
         return;
+    row = screen_row(byte_select);
+    if(!row)
+        return;
 
-    /* Copy to screen */
-    screen_content[x][byte_select] &= ~(0x1 << bit_offset);
+    /* Copy to screen, remember column if the byte changed */
+    if(row[x] & (0x1 << bit_offset))
+    {
+        row[x] &= ~(0x1 << bit_offset);
+        screen_touch(x, x, byte_select);
+    }
 
     return;
 }
 
 
-/* Brief  : Draws a filled rectangle with top left corner in (x0,y0) and lower
- *          right corner in (x1, y1). If either corner is out of the screen
- *          boundrary, only part of the rectangle will be drawn.
+/* Brief  : Draws a rectangle outline with top left corner in (x0,y0) and
+ *          lower right corner in (x1, y1). If either corner is out of the
+ *          screen boundrary, only part of the rectangle will be drawn.
  * Author : Rasmus Kallqvist */
-void display_draw_rect(int8_t x0, int8_t y0, 
-                           int8_t x1, int8_t y1, uint8_t col)
+void display_draw_rect(int x0, int y0, int x1, int y1, uint8_t col)
 {
-    uint8_t width = x1 - x0;
-    uint8_t height = y1 - y0;
-    uint8_t i, j;
-
     /* Check that width and height is non-negative */
     if(x1 < x0 || y1 < y0)
         return;
 
     /* Draw horizontal lines */
-    for(i = x0; (i < (x0+width)) && (i < DISPLAY_WIDTH); i++)    
-    {
-        if(col==1)
-        {
-            /* Draw white */
-            display_set_pixel(i,y0);
-            display_set_pixel(i,y0+height-1);
-        }
-        if(col==0)
-        {
-            /* Draw black */
-            display_unset_pixel(i,y0);
-            display_unset_pixel(i,y0+height-1);            
-        }
-    }
+    display_draw_rectfill(x0, y0, x1, y0 + 1, col);
+    display_draw_rectfill(x0, y1 - 1, x1, y1, col);
 
     /* Draw vertical lines */
-    for(i = y0; (i < (y0+height)) && (i < DISPLAY_HEIGHT); i++)
-    {
-        if(col==1)
-        {
-            /* Draw white */
-            display_set_pixel(x0,i);
-            display_set_pixel(x0+width-1,i);
-        }
-        if(col==0)
-        {
-            /* Draw black */
-            display_unset_pixel(x0,i);
-            display_unset_pixel(x0+width-1,i);          
-        }        
-    }
+    display_draw_rectfill(x0, y0, x0 + 1, y1, col);
+    display_draw_rectfill(x1 - 1, y0, x1, y1, col);
 }
 
 
 /* Brief  : Draws a filled rectangle with top left corner in (x0,y0) and lower
  *          right corner in (x1, y1). If either corner is out of the screen
- *          boundrary, only part of the rectangle will be drawn.
+ *          boundrary, only part of the rectangle will be drawn. The rectangle
+ *          is clipped once here, then filled a page at a time. Corners may
+ *          lie anywhere, so actor positions can be passed as they are.
  * Author : Rasmus Kallqvist */
-void display_draw_rectfill(int8_t x0, int8_t y0, 
-                           int8_t x1, int8_t y1, uint8_t col)
+void display_draw_rectfill(int x0, int y0, int x1, int y1, uint8_t col)
 {
-    uint8_t width = x1 - x0;
-    uint8_t height = y1 - y0;
-    uint8_t i, j;
-
     /* Check that width and height is non-negative */
     if(x1 < x0 || y1 < y0)
         return;
 
-    /* Draw rectangle to screen */
-    for(i = x0; (i < (x0+width)) && (i < DISPLAY_WIDTH); i++)
-    {
-        for(j = y0; (j < (y0+height)) && (j < DISPLAY_HEIGHT); j++)
-        {
-            if(col==1)
-                /* Draw white */
-                display_set_pixel(i,j); 
-            if(col==0)
-                /* Draw black */
-                display_unset_pixel(i,j); 
-        }
-    }
+    /* Clip rectangle to screen */
+    if(x0 < 0)
+        x0 = 0;
+    if(y0 < 0)
+        y0 = 0;
+    if(x1 > DISPLAY_WIDTH)
+        x1 = DISPLAY_WIDTH;
+    if(y1 > DISPLAY_HEIGHT)
+        y1 = DISPLAY_HEIGHT;
+    if(x0 >= x1 || y0 >= y1)
+        return;
+
+    screen_fill(x0, y0, x1, y1, col);
 }
 
 
-/* Brief  : Calls draw rectangle function to draw a rectangle actor struct.
+/* Brief  : Draws an actor struct with its sprite, or calls draw rectangle
+*           function to draw it as a rectangle if it has none.
 *           Makes writing other stuff much easier on the syntax.
 * Author  : Rasmus Kallqvist */
 void display_draw_actor(struct actor *a)
 {
-    int x0 = (int) round(a->x);
-    int y0 = (int) round(a->y);
-    int x1 = (int) round(a->x + a->w);
-    int y1 = (int) round(a->y + a->h);
-    display_draw_rectfill(x0, y0, x1, y1, 1);
+    int x0 = FIX_ROUND(a->x);
+    int y0 = FIX_ROUND(a->y);
+    int x1 = x0 + a->w;
+    int y1 = y0 + a->h;
+    struct rect *drawn;
+
+    if(a->sprite)
+    {
+        x1 = x0 + a->sprite->w;
+        y1 = y0 + a->sprite->h;
+        display_draw_sprite(a->sprite, x0, y0);
+    }
+    else
+        display_draw_rectfill(x0, y0, x1, y1, 1);
+
+    /* Remember where actor is in this buffer, see display_erase_actor() */
+    if(draw_rows)
+        return;
+    drawn = &a->drawn[display_get_back()];
+    drawn->x0 = x0;
+    drawn->y0 = y0;
+    drawn->x1 = x1;
+    drawn->y1 = y1;
+}
+
+
+/* Brief  : Erases an actor from the back buffer by restoring the background
+ *          layer where it was last drawn into this buffer, two frames ago.
+ *          Together with drawing the actor at its new position, this
+ *          updates a frame without clearing it, as long as nothing but
+ *          actors changed since. Whole 8 pixel column bytes are restored, so
+ *          all actors must be erased before any is drawn.
+ * Author : Rasmus Kallqvist */
+void display_erase_actor(struct actor *a)
+{
+    const struct rect *r = &a->drawn[display_get_back()];
+
+    display_restore_rect(r->x0, r->y0, r->x1, r->y1);
 }
 
-/* Brief  : Draw right and left doted line
+
+/* Brief  : Restores the background layer in the back buffer, for the
+ *          columns x0 up to x1 of the pages covering rows y0 up to y1.
+ *          Only bytes that change are written and marked as dirty.
+ * Author : Rasmus Kallqvist */
+void display_restore_rect(int x0, int y0, int x1, int y1)
+{
+    const uint8_t (*layer)[128] = (const uint8_t (*)[128]) layer_words;
+    int page, x;
+
+    /* Clip to screen */
+    if(x0 < 0)
+        x0 = 0;
+    if(y0 < 0)
+        y0 = 0;
+    if(x1 > DISPLAY_WIDTH)
+        x1 = DISPLAY_WIDTH;
+    if(y1 > DISPLAY_HEIGHT)
+        y1 = DISPLAY_HEIGHT;
+
+    for(page = y0 >> 3; page < 4 && page * 8 < y1; page++)
+    {
+        for(x = x0; x < x1; x++)
+        {
+            if(screen_back[page][x] != layer[page][x])
+            {
+                screen_back[page][x] = layer[page][x];
+                display_mark_dirty(x, page);
+                screen_touched++;
+            }
+        }
+    }
+}
+
+/* Brief  : Draw right and left doted line. The dots of the whole column are
+ *          built as one 32 bit mask, then written a page at a time.
  * Author : Michel Bitar*/
 void display_draw_dotline (int x0, int len)
 {
   int i;
-	for (i = 0; i < (32/len); i++)
+  uint32_t dots = 0;
+  uint8_t page;
+
+	/* Check if valid column and dot length */
+	if (x0 < 0 || x0 > 127 || len < 1)
+		return;
+
+	/* One dot of len pixels, followed by a gap of len pixels */
+	for (i = 0; i < DISPLAY_HEIGHT; i++)
 	{
-		display_draw_rectfill(x0,0+(i*len*2),x0+1,0+(i*len*2)+len,1);
+		if ((i / len) % 2 == 0)
+			dots |= (uint32_t) 0x1 << i;
+	}
+
+	for (page = 0; page < 4; page++)
+	{
+		if ((dots >> (page * 8)) & 0xFF)
+			screen_fill_columns(x0, x0 + 1, page, dots >> (page * 8), 1);
 	}
 }
 
 
 /* Brief  : Draw a cosine wave with period and phase determined by arguments.
- *          Period is measured in pixels, the phase in degrees.
+ *          Period is measured in pixels, the phase in degrees. The angle is
+ *          a fine binary angle with 16 more fraction bits, a full turn is
+ *          2^32, stepped by a full turn over period each column. Any period
+ *          keeps its length, not only those that divide 360. Uses the fixed
+ *          point cosine table, no floating point.
  * Author : Rasmus Kallqvist */
 void display_draw_cos(uint32_t period, uint32_t phase)
 {
     uint8_t x, y;
-    double angle = 0.0;
+    uint32_t angle, step;
 
-    /* Wrap around negative phase */
-    phase = (360 + phase) % 360;
+    if(period == 0)
+        return;
+
+    /* Phase to a binary angle, negative phase wraps around */
+    angle = (uint32_t)(((int32_t) phase % 360 + 360) % 360) *
+            (0xFFFFFFFFu / 360);
+    step = 0xFFFFFFFFu / period;
 
     /* Draw cosine wave to screen */
     for(x = 0; x < 128; x++)
     {
-        y = 16 - 16 * cos( (angle  + phase) * PI / 180);
+        /* y = 16 - 16 * cos(angle), cosine in Q1.15 */
+        y = (16 * TRIG_ONE - 16 * trig_cos_fine(angle >> 16)) >> TRIG_SHIFT;
         display_set_pixel(x, y);
-        angle += 360/period;
+        angle += step;
     }
 }
 
 
-/* Brief  : Sets each byte in the screen to zero
+/* Brief  : Sets each byte in the back buffer to zero. Only bytes that held
+ *          pixels are marked as dirty, empty columns stay untouched. Always
+ *          clears the back buffer, regardless of display_draw_to().
  * Author : Rasmus Kallqvist */
 void display_cls(void)
 {
+    uint32_t *words = (uint32_t *) screen_back;
+    uint8_t i, j;
+    for(i = 0; i < 4; i++)
+    {
+        for(j = 0; j < DISPLAY_WIDTH / 4; j++)
+        {
+            /* Clear four columns at a time */
+            if(words[i * (DISPLAY_WIDTH / 4) + j])
+            {
+                words[i * (DISPLAY_WIDTH / 4) + j] = 0x00;
+                display_mark_dirty(j * 4, i);
+                display_mark_dirty(j * 4 + 3, i);
+                screen_touched += 4;
+            }
+        }
+    }
+}
+
+
+/* Brief  : Starts drawing the static background layer. Until
+ *          display_layer_end(), drawing goes to the layer instead of the
+ *          back buffer. The layer starts out empty.
+ * Author : Rasmus Kallqvist */
+void display_layer_begin(void)
+{
+    uint8_t i, j;
+
+    for(i = 0; i < 4; i++)
+        for(j = 0; j < DISPLAY_WIDTH / 4; j++)
+            layer_words[i][j] = 0x00;
+    display_draw_to((uint8_t (*)[128]) layer_words, 0, 4);
+    layer_valid = 0;
+}
+
+
+/* Brief  : Finishes drawing the background layer, drawing goes back to the
+ *          back buffer.
+ * Author : Rasmus Kallqvist */
+void display_layer_end(void)
+{
+    display_draw_to(0, 0, 4);
+    layer_valid = 1;
+}
+
+
+/* Brief  : Returns non-zero if the background layer is drawn and up to date.
+ * Author : Rasmus Kallqvist */
+uint8_t display_layer_valid(void)
+{
+    return layer_valid;
+}
+
+
+/* Brief  : Marks the background layer as out of date, for when the static
+ *          parts of the screen change. It must then be drawn again before
+ *          display_restore_layer() is used.
+ * Author : Rasmus Kallqvist */
+void display_layer_invalidate(void)
+{
+    layer_valid = 0;
+}
+
+
+/* Brief  : Sets the back buffer to the background layer, four columns at a
+ *          time. Replaces display_cls() at the start of a frame when the
+ *          static parts of the screen are kept in the layer. Only bytes that
+ *          change are marked as dirty. Clears the back buffer if the layer
+ *          is not valid.
+ * Author : Rasmus Kallqvist */
+void display_restore_layer(void)
+{
+    uint32_t *words = (uint32_t *) screen_back;
     uint8_t i, j;
+
+    if(!layer_valid)
+    {
+        display_cls();
+        return;
+    }
+
     for(i = 0; i < 4; i++)
     {
-        for(j = 0; j < 128; j++)
+        for(j = 0; j < DISPLAY_WIDTH / 4; j++)
         {
-            screen_content[j][i] = 0x00;
+            /* Copy four columns at a time */
+            if(words[i * (DISPLAY_WIDTH / 4) + j] != layer_words[i][j])
+            {
+                words[i * (DISPLAY_WIDTH / 4) + j] = layer_words[i][j];
+                display_mark_dirty(j * 4, i);
+                display_mark_dirty(j * 4 + 3, i);
+                screen_touched += 4;
+            }
         }
     }
 }
 
 
+/* Brief  : Widens the dirty column span of a page to include column x. Must
+ *          be called whenever a byte in the back buffer changes, only the
+ *          dirty spans are compared against the front buffer at swap.
+ * Author : Rasmus Kallqvist */
+void display_mark_dirty(uint8_t x, uint8_t page)
+{
+    if(x < screen_dirty_lo[page])
+        screen_dirty_lo[page] = x;
+    if(x > screen_dirty_hi[page])
+        screen_dirty_hi[page] = x;
+}
+
+
+/* Brief  : Forces the next display_update() or display_flush_begin() to
+ *          resend the whole screen, for when the display graphic ram no
+ *          longer matches the front buffer.
+ * Author : Rasmus Kallqvist */
+void display_mark_all_dirty(void)
+{
+    screen_resync = 1;
+}
+
+
+/* Brief  : Copies the front buffer into the back buffer, so the next frame
+ *          can be drawn on top of the last one sent instead of the one
+ *          before it. Used for overlays such as the pause splash.
+ * Author : Rasmus Kallqvist */
+void display_copy_front(void)
+{
+    uint8_t page;
+
+    /* Wait until front buffer is no longer being sent */
+    while(display_flush_busy());
+
+    for(page = 0; page < 4; page++)
+        display_copy_front_page(page);
+}
+
+
+/* Brief  : Copies one page of the front buffer into the back buffer, four
+ *          columns at a time. Only reads the front buffer, so it may run
+ *          while the front buffer is being sent.
+ * Author : Rasmus Kallqvist */
+void display_copy_front_page(uint8_t page)
+{
+    uint32_t *back = (uint32_t *) screen_back[page];
+    const uint32_t *front = (const uint32_t *) screen_front[page];
+    uint8_t j;
+
+    for(j = 0; j < DISPLAY_WIDTH / 4; j++)
+    {
+        if(back[j] != front[j])
+        {
+            back[j] = front[j];
+            screen_touched += 4;
+        }
+    }
+
+    /* Page is now the same in both buffers */
+    screen_dirty_lo[page] = DISPLAY_WIDTH;
+    screen_dirty_hi[page] = 0;
+}
+
+
+/* Brief  : Makes the back buffer the new front buffer in O(1) by swapping
+ *          pointers. Before the swap, the dirty spans are narrowed down to
+ *          the columns that actually differ between the two buffers, which
+ *          is what needs to be sent. Must not be called during a flush.
+ * Author : Rasmus Kallqvist */
+static void display_swap(void)
+{
+    uint8_t (*drawn)[128] = screen_back;
+    uint8_t page;
+    uint8_t changed;
+
+    for(page = 0; page < 4; page++)
+        flush_span(page);
+    screen_resync = 0;
+
+    /* Burst mode sends the whole frame if anything changed */
+    if(flush_mode == display_flush_burst)
+    {
+        changed = 0;
+        for(page = 0; page < 4; page++)
+            changed |= flush_lo[page] <= flush_hi[page];
+        for(page = 0; changed && page < 4; page++)
+        {
+            flush_lo[page] = 0;
+            flush_hi[page] = DISPLAY_WIDTH - 1;
+        }
+    }
+
+    screen_back = screen_front;
+    screen_front = drawn;
+    screen_frames++;
+}
+
+
+/* Brief  : Narrows the dirty span of page down to the columns where the back
+ *          buffer differs from the front buffer, and makes those the columns
+ *          to send, or all of them if the display is out of sync.
+ * Author : Rasmus Kallqvist */
+static void flush_span(uint8_t page)
+{
+    uint8_t lo, hi;
+
+    /* Skip unchanged bytes at both ends of the dirty span */
+    lo = screen_dirty_lo[page];
+    hi = screen_dirty_hi[page];
+    while(lo <= hi && screen_back[page][lo] == screen_front[page][lo])
+        lo++;
+    while(lo <= hi && screen_back[page][hi] == screen_front[page][hi])
+        hi--;
+    if(lo > hi)
+    {
+        lo = DISPLAY_WIDTH;
+        hi = 0;
+    }
+
+    /* Columns to send, everything if display is out of sync */
+    flush_lo[page] = screen_resync ? 0 : lo;
+    flush_hi[page] = screen_resync ? DISPLAY_WIDTH - 1 : hi;
+
+    /* After swap, back and front differ by exactly these columns */
+    screen_dirty_lo[page] = lo;
+    screen_dirty_hi[page] = hi;
+}
+
+
+/* Brief  : Limits drawing to num_pages pages starting at first_page, and
+ *          redirects it to rows instead of the back buffer unless rows is
+ *          null. Drawing outside those pages is clipped away. Rows must be
+ *          word aligned. display_draw_to(0, 0, 4) goes back to drawing to
+ *          all of the back buffer.
+ * Author : Rasmus Kallqvist */
+void display_draw_to(uint8_t (*rows)[128], uint8_t first_page,
+                     uint8_t num_pages)
+{
+    draw_rows = rows;
+    draw_first_page = first_page;
+    draw_num_pages = num_pages;
+}
+
+
+/* Brief  : Returns which of the two screen buffers is the back buffer, 0 or
+ *          1. Alternates with each frame swapped to the front buffer.
+ * Author : Rasmus Kallqvist */
+uint8_t display_get_back(void)
+{
+    return screen_back != (uint8_t (*)[128]) screen_words[0];
+}
+
+
+/* Brief  : Returns the number of back buffer bytes written since boot, by
+ *          drawing, clearing and restoring the background layer. Sample it
+ *          before and after the draw step to get the bytes touched per frame.
+ * Author : Rasmus Kallqvist */
+uint32_t display_get_touched_bytes(void)
+{
+    return screen_touched;
+}
+
+
+/* Brief  : Returns the number of frames swapped to the front buffer since
+ *          boot, by display_update() or display_flush_begin(). Also counts
+ *          up when a hardware scroll is stopped, as that leaves the graphic
+ *          ram contents shifted.
+ * Author : Rasmus Kallqvist */
+uint32_t display_get_frames(void)
+{
+    return screen_frames;
+}
+
+
+/* Brief  : Returns the row of page being drawn to, or null if the page is
+ *          outside of what is being drawn to.
+ * Author : Rasmus Kallqvist */
+static uint8_t *screen_row(int page)
+{
+    if(page < draw_first_page || page >= draw_first_page + draw_num_pages)
+        return 0;
+    if(draw_rows)
+        return draw_rows[page - draw_first_page];
+    return screen_back[page];
+}
+
+
+/* Brief  : Marks columns x0 to x1 of page as dirty, if drawing to the back
+ *          buffer.
+ * Author : Rasmus Kallqvist */
+static void screen_touch(uint8_t x0, uint8_t x1, uint8_t page)
+{
+    if(draw_rows)
+        return;
+    display_mark_dirty(x0, page);
+    display_mark_dirty(x1, page);
+    screen_touched += x1 - x0 + 1;
+}
+
+
+/* Brief  : Fills the rectangle from (x0,y0) up to but not including (x1,y1)
+ *          in the pages being drawn to. Coordinates must already be clipped to the
+ *          screen. One bit mask is computed per page, covering the rows of
+ *          the rectangle within that page.
+ * Author : Rasmus Kallqvist */
+static void screen_fill(uint8_t x0, uint8_t y0,
+                        uint8_t x1, uint8_t y1, uint8_t col)
+{
+    uint8_t page;
+    uint8_t top, bottom;
+
+    for(page = y0 >> 3; page <= ((y1 - 1) >> 3); page++)
+    {
+        /* Rows of the rectangle within this page */
+        top = (y0 > page * 8) ? y0 - page * 8 : 0;
+        bottom = (y1 < page * 8 + 8) ? y1 - page * 8 : 8;
+
+        screen_fill_columns(x0, x1, page,
+                            (0xFF << top) & (0xFF >> (8 - bottom)), col);
+    }
+}
+
+
+/* Brief  : Sets (col = 1) or clears (col = 0) the bits in mask for columns
+ *          x0 up to but not including x1 of a page being drawn to.
+ *          Columns in the middle are written a word, four columns, at a time.
+ * Author : Rasmus Kallqvist */
+static void screen_fill_columns(uint8_t x0, uint8_t x1, uint8_t page,
+                                uint8_t mask, uint8_t col)
+{
+    uint8_t *bytes = screen_row(page);
+    uint32_t *words = (uint32_t *) bytes;
+    uint32_t word_mask = mask * 0x01010101u;
+    uint8_t x = x0;
+
+    if(!bytes)
+        return;
+    screen_touch(x0, x1 - 1, page);
+
+    if(col)
+    {
+        /* Columns before first word boundrary */
+        for(; x < x1 && (x & 0x3); x++)
+            bytes[x] |= mask;
+        /* Whole words */
+        for(; x + 4 <= x1; x += 4)
+            words[x >> 2] |= word_mask;
+        /* Remaining columns */
+        for(; x < x1; x++)
+            bytes[x] |= mask;
+    }
+    else
+    {
+        for(; x < x1 && (x & 0x3); x++)
+            bytes[x] &= ~mask;
+        for(; x + 4 <= x1; x += 4)
+            words[x >> 2] &= ~word_mask;
+        for(; x < x1; x++)
+            bytes[x] &= ~mask;
+    }
+}
+
+
 /* Driver functions */
 
-/* Brief  : Performs low level initiation of the i/o shield OLED-display
+/* Brief  : Performs low level initiation of the i/o shield OLED-display,
+ *          blocking with generous busy wait delays. See display_power_begin()
+ *          for a version that does not block.
  * Author : Original code by Fredrik Lundeval / Axel Isaksson / Diligent corp
  *          Display command macros and some comments by Rasmus Kallqvist */
 void init_display(void)
@@ -240,12 +725,103 @@ void init_display(void)
     /* Turn on display */
     spi_send_recv(CMD_DISPLAY_ON);
 
-    /* Clear out graphic RAM */
+    /* Addressing mode of graphic ram */
+    flush_program_mode();
+
+    /* Spi2 interrupt priority for interrupt driven flush */
+    IPCCLR(7) = 0x1F << 24;
+    IPCSET(7) = 0x3 << 26;
+
+    /* Clear out graphic RAM, its power up contents are unknown */
     display_cls();
+    display_mark_all_dirty();
+    power_step = power_on;
     display_update();
 }
 
 
+/* Brief  : Starts the non-blocking power up of the i/o shield OLED-display.
+ *          Performs the first step of the power sequence and returns the
+ *          number of microseconds to wait before display_power_work() is
+ *          called for the next step. Meanwhile the screen buffers can be
+ *          drawn to, but not sent, see display_power_ready().
+ * Author : Rasmus Kallqvist
+ *          power sequence from init_display() */
+uint32_t display_power_begin(void)
+{
+    power_step = power_off;
+    return display_power_work();
+}
+
+
+/* Brief  : Performs the next step of the OLED-display power sequence and
+ *          returns the microseconds to wait before calling it again, or zero
+ *          once the display is turned on. Meant to be called from a timer
+ *          interrupt, each step only sends a handful of command bytes.
+ * Author : Rasmus Kallqvist
+ *          power sequence from init_display() */
+uint32_t display_power_work(void)
+{
+    switch(power_step)
+    {
+        /* Apply power to display controller (VDD) */
+        case(power_off) :
+            DISPLAY_CHANGE_TO_COMMAND_MODE;
+            DISPLAY_ACTIVATE_VDD;
+            power_step = power_vdd;
+            return DISPLAY_VDD_DELAY_US;
+
+        /* Turn off display, start reset pulse */
+        case(power_vdd) :
+            spi_send_recv(CMD_DISPLAY_OFF);
+            DISPLAY_ACTIVATE_RESET;
+            power_step = power_reset;
+            return DISPLAY_RESET_DELAY_US;
+
+        /* End reset pulse, enable 7.5 V and apply power to display (VBAT) */
+        case(power_reset) :
+            DISPLAY_DO_NOT_RESET;
+            spi_send_recv(CMD_SET_CHARGE_PUMP);
+            spi_send_recv(CMD_ENABLE_CHARGE_PUMP);
+            spi_send_recv(CMD_SET_PRECHARGE_PERIOD);
+            spi_send_recv(CMD_CHARGE_PHASE1(1) | CMD_CHARGE_PHASE2(15));
+            DISPLAY_ACTIVATE_VBAT;
+            power_step = power_vbat;
+            return DISPLAY_VBAT_DELAY_US;
+
+        /* Set COM output, scan direction and pins, turn on display */
+        case(power_vbat) :
+            spi_send_recv(CMD_SET_SEGMENT_REMAP);
+            spi_send_recv(CMD_SET_COM_SCAN_REMAP);
+            spi_send_recv(CMD_SET_COM_PIN_CONFIG);
+            spi_send_recv(CMD_SEQ_COM_LEFTRIGHT_REMAP);
+            spi_send_recv(CMD_DISPLAY_ON);
+            flush_program_mode();
+
+            /* Spi2 interrupt priority for interrupt driven flush */
+            IPCCLR(7) = 0x1F << 24;
+            IPCSET(7) = 0x3 << 26;
+
+            /* Graphic ram contents are unknown, first frame sends all */
+            display_mark_all_dirty();
+            power_step = power_on;
+            return 0;
+
+        default :
+            return 0;
+    }
+}
+
+
+/* Brief  : Returns non-zero once the display is powered up and frames can be
+ *          sent with display_update() or display_flush_begin().
+ * Author : Rasmus Kallqvist */
+uint8_t display_power_ready(void)
+{
+    return power_step == power_on;
+}
+
+
 /* Brief  : Clears the display by writing all zeroes to graphic ram
  * Author : Rasmus Kallqvist */
 void clear_display(void)
@@ -278,122 +854,645 @@ void clear_display(void)
 }
 
 
-/* Brief  : Writies the contents of screen_content to the display graphic ram.
- *          To change screen_content contents, use display_set_pixel().
+/* Brief  : Swaps the screen buffers and writes the new front buffer to the
+ *          display graphic ram. To draw to the back buffer, use
+ *          display_set_pixel(). In paged mode only the columns that differ
+ *          from the previous frame are sent, pages without changes are
+ *          skipped. In burst mode a changed frame is sent whole.
  * Author : Rasmus Kallqvist */
 void display_update(void)
 {
     uint8_t cur_page;
     uint8_t cur_col;
     uint8_t data_byte;
+    uint8_t i, num_cmds;
+
+    /* Let an interrupt driven flush finish first */
+    while(display_flush_busy());
+    display_scroll_stop();
+    display_swap();
 
     /* Display screen graphic contents */
     for(cur_page = 0; cur_page < 4; cur_page++)
     {
-        DISPLAY_CHANGE_TO_COMMAND_MODE;
-        quicksleep(10);
-
-        /* Set page address */
-        spi_send_recv(CMD_SET_PAGE_ADDRESS);
-        spi_send_recv(cur_page);
+        /* Skip page if nothing changed */
+        if(flush_lo[cur_page] > flush_hi[cur_page])
+            continue;
 
-        /* Set cursor at left column */
-        spi_send_recv(0x00);
-        spi_send_recv(0x10);
+        /* Set page address and cursor at first changed column */
+        num_cmds = flush_plan(cur_page);
+        if(num_cmds)
+        {
+            DISPLAY_CHANGE_TO_COMMAND_MODE;
+            quicksleep(10);
+            for(i = 0; i < num_cmds; i++)
+                spi_send_recv(flush_cmd[i]);
+        }
 
         DISPLAY_CHANGE_TO_DATA_MODE;
         quicksleep(10);
 
-        /* Set each column in page to zero */
-        for(cur_col = 0; cur_col < 128; cur_col++)
+        /* Send each changed column, of all pages addressed at once */
+        for(; cur_page <= flush_last; cur_page++)
         {
-          data_byte = screen_content[cur_col][cur_page];
-          spi_send_recv(data_byte);
+            for(cur_col = flush_lo[cur_page];
+                cur_col <= flush_hi[cur_page]; cur_col++)
+            {
+              data_byte = screen_front[cur_page][cur_col];
+              spi_send_recv(data_byte);
+            }
         }
+        cur_page--;
+    }
+}
+
+
+/* Brief  : Swaps the screen buffers and starts sending the new front buffer
+ *          to the display without blocking. The bytes are fed to spi2 one at
+ *          a time from display_flush_isr(), which runs each time spi2 has
+ *          shifted out a byte. The next frame can be drawn to the back
+ *          buffer while the flush is in progress.
+ * Author : Rasmus Kallqvist */
+void display_flush_begin(void)
+{
+    /* Let a flush in progress finish first */
+    while(display_flush_busy());
+    display_scroll_stop();
+
+    /* Finished frame becomes the front buffer */
+    display_swap();
+
+    /* Drop any stale received byte and overflow from polled transfers */
+    (void) SPI2BUF;
+    SPI2STATCLR = 0x40;
+    IFSCLR(1) = 0x1 << 7;
+
+    /* Send first dirty page, interrupt takes care of the rest */
+    if(flush_next_page(0))
+        IECSET(1) = 0x1 << 7; /* spi2 receive interrupt enable */
+}
+
+
+/* Brief  : Returns non-zero while an interrupt driven flush is in progress.
+ * Author : Rasmus Kallqvist */
+uint8_t display_flush_busy(void)
+{
+    return flush_phase != flush_idle;
+}
+
+
+/* Brief  : Starts a frame that is sent a page at a time, as each page is
+ *          drawn, see display_stream_page(). Waits for a flush in progress.
+ * Author : Rasmus Kallqvist */
+void display_stream_begin(void)
+{
+    uint8_t page;
+
+    while(display_flush_busy());
+    display_scroll_stop();
+
+    /* No page to send until it is drawn */
+    for(page = 0; page < 4; page++)
+    {
+        flush_lo[page] = DISPLAY_WIDTH;
+        flush_hi[page] = 0;
+    }
+
+    /* Drop any stale received byte and overflow from polled transfers */
+    (void) SPI2BUF;
+    SPI2STATCLR = 0x40;
+    IFSCLR(1) = 0x1 << 7;
+}
+
+
+/* Brief  : Starts sending page of the back buffer, drawn since
+ *          display_stream_begin(), while the next page is drawn. Pages must
+ *          be sent in rising order. The changed columns are copied into the
+ *          front buffer, which keeps what the display shows, so the back
+ *          buffer page is free to be drawn again as soon as this returns.
+ *          Without a swap both buffers hold the frame when it is done.
+ * Author : Rasmus Kallqvist */
+void display_stream_page(uint8_t page)
+{
+    uint8_t col;
+
+    /* The interrupt must not see a half written span */
+    IECCLR(1) = 0x1 << 7;
+    flush_span(page);
+    for(col = screen_dirty_lo[page]; col <= screen_dirty_hi[page]; col++)
+        screen_front[page][col] = screen_back[page][col];
+    screen_dirty_lo[page] = DISPLAY_WIDTH;
+    screen_dirty_hi[page] = 0;
+
+    /* The interrupt goes idle when it runs out of pages, start it again */
+    if(display_flush_busy() || flush_next_page(page))
+        IECSET(1) = 0x1 << 7;
+}
+
+
+/* Brief  : Ends a frame sent with display_stream_page(). It counts as
+ *          swapped to the front buffer, see display_get_frames().
+ * Author : Rasmus Kallqvist */
+void display_stream_end(void)
+{
+    screen_resync = 0;
+    screen_frames++;
+}
+
+
+/* Brief  : Spi2 receive interrupt handler for the interrupt driven flush.
+ *          The receive flag is raised once a byte has been fully shifted out,
+ *          so it is safe to toggle the D/C pin here between the command and
+ *          data phase of a page.
+ * Author : Rasmus Kallqvist */
+void display_flush_isr(void)
+{
+    /* Byte has been shifted out, discard the reply */
+    (void) SPI2BUF;
+    IFSCLR(1) = 0x1 << 7;
+
+    switch(flush_phase)
+    {
+        /* Sending page and column address */
+        case(flush_command) :
+            if(flush_pos < flush_cmd_len)
+            {
+                flush_send(flush_cmd[flush_pos++]);
+                break;
+            }
+            /* Address set, switch to pixel data */
+            DISPLAY_CHANGE_TO_DATA_MODE;
+            flush_phase = flush_data;
+            flush_send(screen_front[flush_page][flush_col++]);
+            break;
+
+        /* Sending pixel data */
+        case(flush_data) :
+            if(flush_col <= flush_hi[flush_page])
+            {
+                flush_send(screen_front[flush_page][flush_col++]);
+                break;
+            }
+            /* Page done, burst goes on into the next page without
+               addressing, the ram pointer has wrapped there already */
+            if(flush_page < flush_last)
+            {
+                flush_page++;
+                flush_col = flush_lo[flush_page];
+                flush_send(screen_front[flush_page][flush_col++]);
+                break;
+            }
+            /* Move on to next dirty page or stop */
+            if(!flush_next_page(flush_page + 1))
+                IECCLR(1) = 0x1 << 7;
+            break;
+
+        default :
+            IECCLR(1) = 0x1 << 7;
+            break;
+    }
+}
+
+
+/* Brief  : Starts the command phase of the first dirty page at or after
+ *          page. Returns zero and goes idle if no dirty page is left.
+ * Author : Rasmus Kallqvist */
+static uint8_t flush_next_page(uint8_t page)
+{
+    /* Find next page with changes */
+    while(page < 4 && flush_lo[page] > flush_hi[page])
+        page++;
+    if(page == 4)
+    {
+        flush_phase = flush_idle;
+        return 0;
+    }
+
+    /* Page address and cursor at first dirty column */
+    flush_cmd_len = flush_plan(page);
+    flush_page = page;
+    flush_col = flush_lo[page];
+
+    /* Previous byte is fully shifted out when we get here */
+    if(flush_cmd_len)
+    {
+        flush_phase = flush_command;
+        flush_pos = 1;
+        DISPLAY_CHANGE_TO_COMMAND_MODE;
+        flush_send(flush_cmd[0]);
+    }
+    else
+    {
+        /* Burst continues where the last one ended, no addressing */
+        flush_phase = flush_data;
+        DISPLAY_CHANGE_TO_DATA_MODE;
+        flush_send(screen_front[flush_page][flush_col++]);
+    }
+    return 1;
+}
+
+
+/* Brief  : Fills flush_cmd with the commands that address the dirty span of
+ *          page, and sets flush_last to the last page that follows it in the
+ *          same data burst. Returns the number of command bytes, zero when
+ *          the ram pointer is already in place.
+ *          In paged mode every page is addressed on its own. In burst mode
+ *          the ram pointer wraps from the end of one page to the start of
+ *          the next, so consecutive whole pages are sent as one burst, and a
+ *          whole frame leaves the pointer back at the top left corner.
+ * Author : Rasmus Kallqvist */
+static uint8_t flush_plan(uint8_t page)
+{
+    uint8_t last = page;
+    uint8_t whole_frame;
+    uint8_t n = 0;
+
+    if(flush_mode == display_flush_paged)
+    {
+        flush_last = page;
+        flush_cmd[n++] = CMD_SET_PAGE_ADDRESS;
+        flush_cmd[n++] = page;      /* Start page */
+        flush_cmd[n++] = page;      /* End page   */
+        flush_cmd[n++] = CMD_SET_LOW_COLUMN(flush_lo[page]);
+        flush_cmd[n++] = CMD_SET_HIGH_COLUMN(flush_lo[page]);
+        spi_cmd_count += n;
+        return n;
+    }
+
+    /* Whole pages following a whole page join the burst */
+    while(last < 3 && flush_lo[last] == 0 &&
+          flush_hi[last] == DISPLAY_WIDTH - 1 &&
+          flush_lo[last + 1] == 0 && flush_hi[last + 1] == DISPLAY_WIDTH - 1)
+        last++;
+    flush_last = last;
+
+    /* Whole frame from the top left corner needs no addressing */
+    whole_frame = page == 0 && last == 3;
+    if(whole_frame && flush_home)
+        return 0;
+    flush_home = whole_frame;
+
+    /* Window of columns and pages the burst wraps within */
+    flush_cmd[n++] = CMD_SET_COLUMN_ADDRESS;
+    flush_cmd[n++] = flush_lo[page];
+    flush_cmd[n++] = flush_hi[page];
+    flush_cmd[n++] = CMD_SET_PAGE_ADDRESS;
+    flush_cmd[n++] = page;
+    flush_cmd[n++] = last;
+    spi_cmd_count += n;
+    return n;
+}
+
+
+/* Brief  : Sets the addressing mode of display graphic ram to match the
+ *          flush mode. Sends commands with polled spi, the display must be
+ *          powered and no flush in progress.
+ * Author : Rasmus Kallqvist */
+static void flush_program_mode(void)
+{
+    DISPLAY_CHANGE_TO_COMMAND_MODE;
+    quicksleep(10);
+    spi_send_recv(CMD_SET_MEMORY_MODE);
+    if(flush_mode == display_flush_burst)
+        spi_send_recv(CMD_MEMORY_HORIZONTAL);
+    else
+        spi_send_recv(CMD_MEMORY_PAGE);
+    spi_cmd_count += 2;
+
+    /* Window and ram pointer are set by the first frame */
+    flush_home = 0;
+}
+
+
+/* Brief  : Selects how frames are sent to the display. Paged mode addresses
+ *          each changed page and sends only its changed columns. Burst mode
+ *          puts the display in horizontal addressing mode, where the ram
+ *          pointer wraps over the whole 128x4 window, and sends each changed
+ *          frame as one 512 byte data burst without any commands. Paged mode
+ *          sends fewer bytes for small changes, burst mode needs no command
+ *          phases and D/C switches for big ones.
+ * Author : Rasmus Kallqvist */
+void display_set_flush_mode(enum display_flush_mode mode)
+{
+    /* Let a flush in progress finish first */
+    while(display_flush_busy());
+
+    flush_mode = mode;
+    if(power_step == power_on)
+    {
+        flush_program_mode();
+        display_mark_all_dirty();
     }
 }
 
 
-/* Brief  : Print text to screen_content buffer, starting at position (x, y)
+/* Brief  : Starts continuous hardware scrolling of pages first_page to
+ *          last_page, one column left or right every interval frames of the
+ *          controller, see CMD_SCROLL_INTERVAL_*. The display keeps scrolling
+ *          by itself, no bytes are sent until display_scroll_stop().
+ * Author : Rasmus Kallqvist */
+void display_scroll_horizontal(uint8_t right, uint8_t first_page,
+                               uint8_t last_page, uint8_t interval)
+{
+    uint8_t cmds[8];
+
+    cmds[0] = right ? CMD_SCROLL_RIGHT : CMD_SCROLL_LEFT;
+    cmds[1] = 0x00;                 /* Dummy byte   */
+    cmds[2] = first_page;
+    cmds[3] = interval;
+    cmds[4] = last_page;
+    cmds[5] = 0x00;                 /* Dummy bytes  */
+    cmds[6] = 0xFF;
+    cmds[7] = CMD_SCROLL_ACTIVATE;
+    display_scroll_stop();
+    display_command(cmds, sizeof(cmds));
+    scroll_active = 1;
+}
+
+
+/* Brief  : Starts continuous diagonal hardware scrolling. Pages first_page to
+ *          last_page move one column left or right, and the whole screen
+ *          moves up rows_per_step rows, every interval frames. Rows wrap
+ *          around within the display height.
+ * Author : Rasmus Kallqvist */
+void display_scroll_diagonal(uint8_t right, uint8_t first_page,
+                             uint8_t last_page, uint8_t interval,
+                             uint8_t rows_per_step)
+{
+    uint8_t cmds[10];
+
+    cmds[0] = CMD_SET_VERTICAL_SCROLL_AREA;
+    cmds[1] = 0;                    /* No fixed rows at top */
+    cmds[2] = DISPLAY_HEIGHT;       /* Rows in scroll area  */
+    cmds[3] = right ? CMD_SCROLL_DIAG_RIGHT : CMD_SCROLL_DIAG_LEFT;
+    cmds[4] = 0x00;                 /* Dummy byte   */
+    cmds[5] = first_page;
+    cmds[6] = interval;
+    cmds[7] = last_page;
+    cmds[8] = rows_per_step;
+    cmds[9] = CMD_SCROLL_ACTIVATE;
+    display_scroll_stop();
+    display_command(cmds, sizeof(cmds));
+    scroll_active = 1;
+}
+
+
+/* Brief  : Stops hardware scrolling if it is running. Scrolling moves the
+ *          graphic ram contents, so the next frame resends everything.
+ *          Called before anything is written to graphic ram, which is not
+ *          allowed while scrolling.
+ * Author : Rasmus Kallqvist */
+void display_scroll_stop(void)
+{
+    uint8_t cmd = CMD_SCROLL_DEACTIVATE;
+
+    if(!scroll_active)
+        return;
+    display_command(&cmd, 1);
+    scroll_active = 0;
+    display_mark_all_dirty();
+    screen_frames++;
+}
+
+
+/* Brief  : Sets the graphic ram row shown at the top of the display. Rows
+ *          above it wrap around to the bottom, so stepping the start line
+ *          scrolls the screen vertically for one command byte per step.
+ * Author : Rasmus Kallqvist */
+void display_set_start_line(uint8_t line)
+{
+    uint8_t cmd = CMD_SET_START_LINE(line);
+
+    display_command(&cmd, 1);
+}
+
+
+/* Brief  : Shifts the displayed image up by rows, by offsetting which COM
+ *          line shows the first row.
+ * Author : Rasmus Kallqvist */
+void display_set_offset(uint8_t rows)
+{
+    uint8_t cmds[2];
+
+    cmds[0] = CMD_SET_DISPLAY_OFFSET;
+    cmds[1] = rows & 0x3F;
+    display_command(cmds, sizeof(cmds));
+}
+
+
+/* Brief  : Sets display brightness, 0 dimmest to 255 brightest.
+ * Author : Rasmus Kallqvist */
+void display_set_contrast(uint8_t level)
+{
+    uint8_t cmds[2];
+
+    cmds[0] = CMD_SET_CONTRAST;
+    cmds[1] = level;
+    display_command(cmds, sizeof(cmds));
+}
+
+
+/* Brief  : Shows lit pixels dark and dark pixels lit while invert is set.
+ *          Graphic ram is left as it is.
+ * Author : Rasmus Kallqvist */
+void display_set_invert(uint8_t invert)
+{
+    uint8_t cmd = invert ? CMD_DISPLAY_INVERSE : CMD_DISPLAY_NORMAL;
+
+    display_command(&cmd, 1);
+}
+
+
+/* Brief  : Sends command bytes with polled spi, once any flush in progress
+ *          has finished. Does nothing before the display is powered up.
+ * Author : Rasmus Kallqvist */
+static void display_command(const uint8_t *cmds, uint8_t num_cmds)
+{
+    uint8_t i;
+
+    if(power_step != power_on)
+        return;
+    while(display_flush_busy());
+
+    DISPLAY_CHANGE_TO_COMMAND_MODE;
+    quicksleep(10);
+    for(i = 0; i < num_cmds; i++)
+        spi_send_recv(cmds[i]);
+    spi_cmd_count += num_cmds;
+}
+
+
+/* Brief  : Puts one byte in the spi2 transmit buffer without waiting.
+ * Author : Rasmus Kallqvist */
+static void flush_send(uint8_t data)
+{
+    spi_byte_count++;
+    SPI2BUF = data;
+}
+
+
+/* Brief  : Print text to the back buffer, starting at position (x, y).
+ *          Prints at most 16 characters, stopping at the string terminator.
+ *          Font columns are OR:ed into the buffer a byte at a time, text
+ *          that does not start on a page boundrary is split over two pages.
+ *          Text partly outside the screen is clipped.
  * Author : Rasmus Kallqvist
  *          original code by Fredrik Lundeval / Axel Isaksson */
 void display_print(char *s, int x, int y)
 {
-    int cur_char, cur_slice, cur_col, cur_row;
     int c_printed; /* number of characters printed */
-    char textbuff[16];
-
-    /* Check if valid coordinates */
-    if(x < 0 || x > (127 - 8) || y < 0 || y > (31 - 8))
-        return;
+    int cur_col, col_x;
+    int page = y >> 3;          /* Page of glyph top row            */
+    uint8_t shift = y & 0x7;    /* Glyph row offset within the page */
+    uint8_t *top_row, *bottom_row;
+    uint8_t cur_slice;
+    const uint8_t *glyph;
 
     /* Check if empty string */
     if(!s)
         return;
 
-    /* Copy string contents to text buffer */
-    for(cur_char = 0; cur_char < 16; cur_char++)
-    {
-        if(*s)
-        {
-            textbuff[cur_char] = *s;
-            s++;
-        }
-        else
-        {
-            textbuff[cur_char] = ' ';
-        }
-    }
+    /* Check if any part of the text is on screen */
+    if(x > 127 || y < -7 || y > 31)
+        return;
+
+    /* Pages the glyphs are split over */
+    top_row = screen_row(page);
+    bottom_row = shift ? screen_row(page + 1) : 0;
+    if(!top_row && !bottom_row)
+        return;
 
     /* Copy string to screen buffer */
-    for(c_printed = 0; c_printed < 16; c_printed++)
+    for(c_printed = 0; c_printed < 16 && s[c_printed]; c_printed++)
     {
-        /* Get next ascii character to print */
-        cur_char = textbuff[c_printed];
+        /* Get bitmap of next ascii character to print */
+        glyph = &font[(s[c_printed] & 0x7F) * 8];
 
         /* Copy bitmap data to screen buffer */
         for(cur_col = 0; cur_col < 8; cur_col++)
         {
+            /* Skip columns outside of screen */
+            col_x = x + 8 * c_printed + cur_col;
+            if(col_x < 0)
+                continue;
+            if(col_x > 127)
+                break;
+
             /* Get 8 pixel high slice from character bitmap */
-            cur_slice = font[cur_char*8 + cur_col];
+            cur_slice = glyph[cur_col];
 
             /* Copy current 8 pixel slice to screen buffer */
-            for(cur_row = 0; cur_row < 8; cur_row++)
-            {
-                /* If pixel in slice is set, then set pixel in buffer */
-                if( (cur_slice >> cur_row) & 0x1 )
-                    display_set_pixel(x+8*c_printed+cur_col, y+cur_row);
-            }
+            if(top_row)
+                top_row[col_x] |= cur_slice << shift;
+            if(bottom_row)
+                bottom_row[col_x] |= cur_slice >> (8 - shift);
         }
     }
+
+    /* Remember columns covered by text, if any of it is on screen */
+    col_x = x + 8 * c_printed - 1;
+    if(c_printed == 0 || col_x < 0)
+        return;
+    if(col_x > 127)
+        col_x = 127;
+    if(top_row)
+        screen_touch(x < 0 ? 0 : x, col_x, page);
+    if(bottom_row)
+        screen_touch(x < 0 ? 0 : x, col_x, page + 1);
 }
 
 /* Brief  : Draws the pong logo bmp to the screen buffer
  * Author : Rasmus Kallqvist */
 void display_draw_logo(int x0, int y0)
 {
-    int byte;
-    int x, y;
-    int page, col, row;
-    for(page = 0; page < 3; page++) 
+    display_draw_sprite(&logo_sprite, x0, y0);
+}
+
+
+/* Brief  : Draws a sprite with its top left corner in (x0, y0) to the screen
+ *          buffer. Each page-packed column byte is shifted into a 16 bit span
+ *          on the fly, which covers the two screen pages the byte lands in,
+ *          so each column costs one or two byte operations per page.
+ *          Parts of the sprite outside of the screen are clipped.
+ * Author : Rasmus Kallqvist */
+void display_draw_sprite(const struct sprite *s, int x0, int y0)
+{
+    int page = y0 >> 3;         /* Screen page of sprite top row   */
+    uint8_t shift = y0 & 0x7;   /* Row offset within that page     */
+    uint8_t src_pages = (s->h + 7) >> 3;
+    uint8_t src_page;
+    int dst_page;
+    int col, col_lo, col_hi;
+    uint16_t span, mask_span;
+    const uint8_t *data;
+    const uint8_t *mask;
+    uint8_t *top_row, *bottom_row;
+
+    /* Clip columns to screen */
+    col_lo = (x0 < 0) ? -x0 : 0;
+    col_hi = (x0 + s->w > DISPLAY_WIDTH) ? DISPLAY_WIDTH - x0 : s->w;
+    if(col_lo >= col_hi || y0 >= DISPLAY_HEIGHT || y0 + s->h <= 0)
+        return;
+
+    for(src_page = 0; src_page < src_pages; src_page++)
     {
-        for(col = 0; col < 38; col++)
+        dst_page = page + src_page;
+        data = &s->data[src_page * s->w];
+        mask = s->mask ? &s->mask[src_page * s->w] : 0;
+
+        /* Screen pages this sprite page lands in */
+        top_row = screen_row(dst_page);
+        bottom_row = shift ? screen_row(dst_page + 1) : 0;
+        if(!top_row && !bottom_row)
+            continue;
+
+        for(col = col_lo; col < col_hi; col++)
         {
-            for(row = 0; row < 8; row++)
+            /* Column byte spread over this and the next screen page */
+            span = (uint16_t) data[col] << shift;
+            mask_span = mask ? (uint16_t) mask[col] << shift : 0;
+
+            if(top_row)
+            {
+                top_row[x0 + col] &= ~mask_span;
+                top_row[x0 + col] |= span;
+            }
+            if(bottom_row)
             {
-                byte = ponglogo[page*38+col];
-                if( !((byte >> row) & 0x1))
-                {
-                    y = page * 8 + row;
-                    x = col;
-                    if(y < 19) // night hack, logo's only 19 pixels high
-                    {
-                        display_set_pixel(x0+x,y0+y);
-                    }
-                }
+                bottom_row[x0 + col] &= ~(mask_span >> 8);
+                bottom_row[x0 + col] |= span >> 8;
             }
         }
+
+        /* Remember columns covered by sprite */
+        if(top_row)
+            screen_touch(x0 + col_lo, x0 + col_hi - 1, dst_page);
+        if(bottom_row)
+            screen_touch(x0 + col_lo, x0 + col_hi - 1, dst_page + 1);
+    }
+}
+
+
+/* Brief  : Turns a sprite into a filled w by h block, using data as storage
+ *          for the bitmap. Data must hold at least w * (h + 7) / 8 bytes.
+ *          Used to draw rectangular actors as sprites.
+ * Author : Rasmus Kallqvist */
+void display_make_block(struct sprite *s, uint8_t *data, uint8_t w, uint8_t h)
+{
+    uint8_t page, col, rows;
+
+    for(page = 0; page < (h + 7) >> 3; page++)
+    {
+        /* All rows of page, except below the bottom of the block */
+        rows = (h - page * 8 < 8) ? h - page * 8 : 8;
+        for(col = 0; col < w; col++)
+            data[page * w + col] = 0xFF >> (8 - rows);
     }
+
+    s->w = w;
+    s->h = h;
+    s->data = data;
+    s->mask = 0;
 }
 
 
@@ -412,12 +1511,30 @@ void quicksleep(int cyc)
  * Author : Fredrik Lundeval / Axel Isaksson */
 uint8_t spi_send_recv(uint8_t data)
 {
+    spi_byte_count++;
     while(!(SPI2STAT & 0x08));
     SPI2BUF = data;
     while(!(SPI2STAT & 1));
     return SPI2BUF;
 }
 
+/* Brief  : Returns number of bytes sent over spi since boot. Sample it before
+ *          and after display_update() to get the number of bytes per frame.
+ * Author : Rasmus Kallqvist */
+uint32_t display_get_spi_bytes(void)
+{
+    return spi_byte_count;
+}
+
+
+/* Brief  : Returns the number of addressing and effect command bytes sent
+ *          since boot, not counting power up commands.
+ * Author : Rasmus Kallqvist */
+uint32_t display_get_cmd_bytes(void)
+{
+    return spi_cmd_count;
+}
+
 /* Brief  : Function to help debugging.
    Author : Fredrik Lundeval / Axel Isaksson
             Modified by Rasmus Kallqvist
@@ -7,6 +7,9 @@
 ********************************************************************************
 */
 
+#ifndef DISPLAY_H
+#define DISPLAY_H
+
 /* Includes ------------------------------------------------------------------*/
 #include <stdint.h>   /* Declarations of uint_32 and the like */
 #include <pic32mx.h>  /* Declarations of hardware-specific addresses etc */
@@ -14,6 +17,8 @@
 #include "font.h"	  /* Defines a bitmap font */
 #include "structs.h"  /* Contains definitions for actor struct */
 #include "logo.h"	  /* Pong logo bitmap */
+#include "trig.h"	  /* Fixed point sine and cosine */
+#include "fixed.h"	  /* Q16.16 fixed point arithmetic */
 
 /* Defines -------------------------------------------------------------------*/
 /* Macros for display control pins */
@@ -38,32 +43,119 @@
 #define CMD_SET_COM_PIN_CONFIG			(uint8_t)0xDA
 #define CMD_SEQ_COM_LEFTRIGHT_REMAP		(uint8_t)0x20
 #define	CMD_SET_PAGE_ADDRESS			(uint8_t)0x22
+#define CMD_SET_LOW_COLUMN(x)			(uint8_t)(0x00 | ((x) & 0xF))
+#define CMD_SET_HIGH_COLUMN(x)			(uint8_t)(0x10 | ((x) >> 4))
+#define CMD_SET_MEMORY_MODE				(uint8_t)0x20
+#define CMD_MEMORY_HORIZONTAL			(uint8_t)0x00
+#define CMD_MEMORY_PAGE					(uint8_t)0x02
+#define CMD_SET_COLUMN_ADDRESS			(uint8_t)0x21
+#define CMD_SCROLL_RIGHT				(uint8_t)0x26
+#define CMD_SCROLL_LEFT					(uint8_t)0x27
+#define CMD_SCROLL_DIAG_RIGHT			(uint8_t)0x29
+#define CMD_SCROLL_DIAG_LEFT			(uint8_t)0x2A
+#define CMD_SCROLL_DEACTIVATE			(uint8_t)0x2E
+#define CMD_SCROLL_ACTIVATE				(uint8_t)0x2F
+#define CMD_SET_VERTICAL_SCROLL_AREA	(uint8_t)0xA3
+#define CMD_SET_START_LINE(x)			(uint8_t)(0x40 | ((x) & 0x3F))
+#define CMD_SET_DISPLAY_OFFSET			(uint8_t)0xD3
+#define CMD_SET_CONTRAST				(uint8_t)0x81
+#define CMD_DISPLAY_NORMAL				(uint8_t)0xA6
+#define CMD_DISPLAY_INVERSE				(uint8_t)0xA7
+/* Scroll step intervals in controller frames, see display_scroll_*() */
+#define CMD_SCROLL_INTERVAL_2			(uint8_t)0x07
+#define CMD_SCROLL_INTERVAL_3			(uint8_t)0x04
+#define CMD_SCROLL_INTERVAL_4			(uint8_t)0x05
+#define CMD_SCROLL_INTERVAL_5			(uint8_t)0x00
+#define CMD_SCROLL_INTERVAL_25			(uint8_t)0x06
+#define CMD_SCROLL_INTERVAL_64			(uint8_t)0x01
+#define CMD_SCROLL_INTERVAL_128			(uint8_t)0x02
+#define CMD_SCROLL_INTERVAL_256			(uint8_t)0x03
+/* Power up delays in microseconds. The defaults are the minimums from the
+   SSD1306 datasheet and i/o shield reference manual, with some margin.
+   Define DISPLAY_CONSERVATIVE_POWERUP to get delays close to the busy waits
+   of init_display() instead. */
+#ifdef DISPLAY_CONSERVATIVE_POWERUP
+#define DISPLAY_VDD_DELAY_US			125000
+#define DISPLAY_RESET_DELAY_US			10
+#define DISPLAY_VBAT_DELAY_US			1250000
+#else
+#define DISPLAY_VDD_DELAY_US			1000
+#define DISPLAY_RESET_DELAY_US			10
+#define DISPLAY_VBAT_DELAY_US			100000
+#endif
 /* Display properties */
 #define DISPLAY_WIDTH					128
 #define DISPLAY_HEIGHT					32
+#define DISPLAY_CONTRAST_DEFAULT		0x7F
 /* Math */
 #define PI 								3.14159
 
+/* Enums ---------------------------------------------------------------------*/
+/* How frames are addressed in display graphic ram, see
+   display_set_flush_mode() */
+enum display_flush_mode {display_flush_paged, display_flush_burst};
+
 /* Function prototypes -------------------------------------------------------*/
 /* Hardware abstractions */
 void display_set_pixel(uint8_t x, uint8_t y);
 void display_unset_pixel(uint8_t x, uint8_t y);
 void display_print(char *s, int x, int y);
-void display_draw_rect(int8_t x0, int8_t y0, 
-                           int8_t x1, int8_t y1, uint8_t col);
-void display_draw_rectfill(int8_t x0, int8_t y0, 
-                           int8_t x1, int8_t y1, uint8_t col);
+void display_draw_rect(int x0, int y0, int x1, int y1, uint8_t col);
+void display_draw_rectfill(int x0, int y0, int x1, int y1, uint8_t col);
 void display_draw_actor(struct actor *a);
+void display_erase_actor(struct actor *a);
+void display_restore_rect(int x0, int y0, int x1, int y1);
 void display_draw_dotline (int x0, int len);
 void display_draw_cos(uint32_t period, uint32_t phase);
 void display_cls(void);
+void display_layer_begin(void);
+void display_layer_end(void);
+uint8_t display_layer_valid(void);
+void display_layer_invalidate(void);
+void display_restore_layer(void);
+void display_mark_dirty(uint8_t x, uint8_t page);
+void display_mark_all_dirty(void);
+void display_copy_front(void);
+void display_copy_front_page(uint8_t page);
+void display_draw_to(uint8_t (*rows)[128], uint8_t first_page,
+                     uint8_t num_pages);
+uint8_t display_get_back(void);
+uint32_t display_get_touched_bytes(void);
+uint32_t display_get_frames(void);
 void display_draw_logo(int x0, int y0);
+void display_draw_sprite(const struct sprite *s, int x0, int y0);
+void display_make_block(struct sprite *s, uint8_t *data, uint8_t w, uint8_t h);
 /* Device drivers */
 void init_display(void);
+uint32_t display_power_begin(void);
+uint32_t display_power_work(void);
+uint8_t display_power_ready(void);
 void display_update(void);
+void display_flush_begin(void);
+uint8_t display_flush_busy(void);
+void display_stream_begin(void);
+void display_stream_page(uint8_t page);
+void display_stream_end(void);
+void display_flush_isr(void);
+void display_set_flush_mode(enum display_flush_mode mode);
+/* Controller side effects */
+void display_scroll_horizontal(uint8_t right, uint8_t first_page,
+                               uint8_t last_page, uint8_t interval);
+void display_scroll_diagonal(uint8_t right, uint8_t first_page,
+                             uint8_t last_page, uint8_t interval,
+                             uint8_t rows_per_step);
+void display_scroll_stop(void);
+void display_set_start_line(uint8_t line);
+void display_set_offset(uint8_t rows);
+void display_set_contrast(uint8_t level);
+void display_set_invert(uint8_t invert);
 /* Helper functions */
 void quicksleep(int cyc);
 uint8_t spi_send_recv(uint8_t data);
+uint32_t display_get_spi_bytes(void);
+uint32_t display_get_cmd_bytes(void);
 void display_debug(volatile int * const addr);
 void num32asc(char * s, int n);
-char int2char(int n);
\ No newline at end of file
+char int2char(int n);
+
+#endif /* DISPLAY_H */
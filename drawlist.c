@@ -0,0 +1,271 @@
+/*
+********************************************************************************
+* name   :  drawlist.c
+* author :  Rasmus Kallqvist, 2017
+* brief  :  Retained mode drawing. A frame is described as a list of draw
+*           commands, which drawlist_send() rasterises one display page at a
+*           time, clipped to that page, and streams to the display page by
+*           page. Pages whose commands are the same as in the previous frame
+*           are not rasterised, but copied from the front buffer. Only the
+*           changed columns of each page go to the display.
+********************************************************************************
+*/
+
+/* Includes ------------------------------------------------------------------*/
+#include "drawlist.h"
+
+/* Enums ---------------------------------------------------------------------*/
+enum draw_type {draw_rect, draw_rectfill, draw_text, draw_sprite, draw_dotline};
+
+/* Structs -------------------------------------------------------------------*/
+/* Brief  : One draw command, with the arguments of its display.c function
+ * Author : Rasmus Kallqvist */
+struct draw_cmd
+{
+    uint8_t type;
+    uint8_t col;
+    int16_t x0, y0;     /* Top left corner, or column of dotline       */
+    int16_t x1, y1;     /* Lower right corner, or dot length of dotline */
+    const struct sprite *sprite;
+    char text[DRAWLIST_TEXT_LEN];
+};
+
+/* Local variables -----------------------------------------------------------*/
+static struct draw_cmd list_cmds[2][DRAWLIST_LEN]; /* Current and previous */
+static uint8_t list_len[2];
+static uint8_t list_cur;            /* Index of list being built           */
+static uint8_t list_synced;         /* Previous list is what display shows */
+static uint32_t list_frames;        /* Display frame count at last send    */
+
+/* Local function prototypes -------------------------------------------------*/
+static struct draw_cmd *drawlist_add(uint8_t type);
+static uint8_t drawlist_on_page(const struct draw_cmd *c, uint8_t page);
+static uint8_t drawlist_page_same(uint8_t page);
+static void drawlist_raster(const struct draw_cmd *c);
+
+/* Function definitions ------------------------------------------------------*/
+/* Brief  : Starts describing a new frame. The list of the last frame is kept
+ *          to find the pages that did not change.
+ * Author : Rasmus Kallqvist */
+void drawlist_begin(void)
+{
+    list_cur ^= 1;
+    list_len[list_cur] = 0;
+}
+
+/* Brief  : Adds a rectangle outline, see display_draw_rect()
+ * Author : Rasmus Kallqvist */
+void drawlist_rect(int x0, int y0, int x1, int y1, uint8_t col)
+{
+    struct draw_cmd *c = drawlist_add(draw_rect);
+    if(!c)
+        return;
+    c->x0 = x0;
+    c->y0 = y0;
+    c->x1 = x1;
+    c->y1 = y1;
+    c->col = col;
+}
+
+/* Brief  : Adds a filled rectangle, see display_draw_rectfill()
+ * Author : Rasmus Kallqvist */
+void drawlist_rectfill(int x0, int y0, int x1, int y1, uint8_t col)
+{
+    struct draw_cmd *c = drawlist_add(draw_rectfill);
+    if(!c)
+        return;
+    c->x0 = x0;
+    c->y0 = y0;
+    c->x1 = x1;
+    c->y1 = y1;
+    c->col = col;
+}
+
+/* Brief  : Adds text, see display_print(). The string is copied, so it may
+ *          change after this call.
+ * Author : Rasmus Kallqvist */
+void drawlist_text(char *s, int x, int y)
+{
+    struct draw_cmd *c = drawlist_add(draw_text);
+    uint8_t i;
+    if(!c || !s)
+        return;
+    c->x0 = x;
+    c->y0 = y;
+    c->x1 = x + 8 * DRAWLIST_TEXT_LEN;
+    c->y1 = y + 8;
+    /* Copy text, pad with terminators so commands compare equal */
+    for(i = 0; i < DRAWLIST_TEXT_LEN; i++)
+    {
+        c->text[i] = *s;
+        if(*s)
+            s++;
+    }
+}
+
+/* Brief  : Adds a sprite, see display_draw_sprite()
+ * Author : Rasmus Kallqvist */
+void drawlist_sprite(const struct sprite *s, int x, int y)
+{
+    struct draw_cmd *c = drawlist_add(draw_sprite);
+    if(!c)
+        return;
+    c->x0 = x;
+    c->y0 = y;
+    c->x1 = x + s->w;
+    c->y1 = y + s->h;
+    c->sprite = s;
+}
+
+/* Brief  : Adds a dotted vertical line, see display_draw_dotline()
+ * Author : Rasmus Kallqvist */
+void drawlist_dotline(int x0, int len)
+{
+    struct draw_cmd *c = drawlist_add(draw_dotline);
+    if(!c)
+        return;
+    c->x0 = x0;
+    c->y0 = 0;
+    c->x1 = len;
+    c->y1 = DISPLAY_HEIGHT;
+}
+
+/* Brief  : Rasterises the frame one page at a time, and starts sending
+ *          each page as soon as it is done, while the next one is
+ *          rasterised. The page of the back buffer is the working buffer,
+ *          see display_stream_page(). Pages intersected by the same commands
+ *          as in the previous frame are copied from the front buffer
+ *          instead, and send nothing, unless something else has been sent
+ *          to the display since. Returns without waiting for the last page.
+ * Author : Rasmus Kallqvist */
+void drawlist_send(void)
+{
+    uint8_t page, i;
+    const struct draw_cmd *c;
+
+    /* Frames sent from the screen buffers, or scrolling, overwrite what
+       we sent */
+    display_stream_begin();
+    if(list_frames != display_get_frames())
+        list_synced = 0;
+
+    for(page = 0; page < 4; page++)
+    {
+        if(list_synced && drawlist_page_same(page))
+            display_copy_front_page(page);
+        else
+        {
+            /* Clear page, then rasterise commands intersecting it */
+            display_draw_to(0, page, 1);
+            display_draw_rectfill(0, page * 8, DISPLAY_WIDTH, page * 8 + 8, 0);
+            for(i = 0; i < list_len[list_cur]; i++)
+            {
+                c = &list_cmds[list_cur][i];
+                if(drawlist_on_page(c, page))
+                    drawlist_raster(c);
+            }
+        }
+        display_stream_page(page);
+    }
+    display_draw_to(0, 0, 4);
+
+    display_stream_end();
+    list_synced = 1;
+    list_frames = display_get_frames();
+}
+
+/* Brief  : Returns next free command in list being built, or null when the
+ *          list is full. Commands that do not fit are dropped.
+ * Author : Rasmus Kallqvist */
+static struct draw_cmd *drawlist_add(uint8_t type)
+{
+    struct draw_cmd *c;
+    uint8_t i;
+
+    if(list_len[list_cur] == DRAWLIST_LEN)
+        return 0;
+    c = &list_cmds[list_cur][list_len[list_cur]++];
+
+    /* Clear all fields, unused ones take part in comparisons */
+    c->type = type;
+    c->col = 0;
+    c->x0 = c->y0 = c->x1 = c->y1 = 0;
+    c->sprite = 0;
+    for(i = 0; i < DRAWLIST_TEXT_LEN; i++)
+        c->text[i] = 0;
+    return c;
+}
+
+/* Brief  : Returns non-zero if the command can draw anything on page
+ * Author : Rasmus Kallqvist */
+static uint8_t drawlist_on_page(const struct draw_cmd *c, uint8_t page)
+{
+    return c->y0 < (page + 1) * 8 && c->y1 > page * 8;
+}
+
+/* Brief  : Returns non-zero if the commands intersecting page are the same,
+ *          in the same order, in the current and previous list.
+ * Author : Rasmus Kallqvist */
+static uint8_t drawlist_page_same(uint8_t page)
+{
+    const struct draw_cmd *a = list_cmds[list_cur];
+    const struct draw_cmd *b = list_cmds[list_cur ^ 1];
+    uint8_t a_len = list_len[list_cur];
+    uint8_t b_len = list_len[list_cur ^ 1];
+    uint8_t i = 0, j = 0, k;
+
+    while(1)
+    {
+        /* Next command on page in each list */
+        while(i < a_len && !drawlist_on_page(&a[i], page))
+            i++;
+        while(j < b_len && !drawlist_on_page(&b[j], page))
+            j++;
+        if(i == a_len || j == b_len)
+            return i == a_len && j == b_len;
+
+        /* Compare them */
+        if(a[i].type != b[j].type || a[i].col != b[j].col ||
+           a[i].x0 != b[j].x0 || a[i].y0 != b[j].y0 ||
+           a[i].x1 != b[j].x1 || a[i].y1 != b[j].y1 ||
+           a[i].sprite != b[j].sprite)
+            return 0;
+        for(k = 0; k < DRAWLIST_TEXT_LEN; k++)
+        {
+            if(a[i].text[k] != b[j].text[k])
+                return 0;
+        }
+        i++;
+        j++;
+    }
+}
+
+/* Brief  : Draws a command with its display.c function
+ * Author : Rasmus Kallqvist */
+static void drawlist_raster(const struct draw_cmd *c)
+{
+    char text[DRAWLIST_TEXT_LEN + 1];
+    uint8_t i;
+
+    switch(c->type)
+    {
+        case(draw_rect) :
+            display_draw_rect(c->x0, c->y0, c->x1, c->y1, c->col);
+            break;
+        case(draw_rectfill) :
+            display_draw_rectfill(c->x0, c->y0, c->x1, c->y1, c->col);
+            break;
+        case(draw_text) :
+            for(i = 0; i < DRAWLIST_TEXT_LEN; i++)
+                text[i] = c->text[i];
+            text[DRAWLIST_TEXT_LEN] = 0;
+            display_print(text, c->x0, c->y0);
+            break;
+        case(draw_sprite) :
+            display_draw_sprite(c->sprite, c->x0, c->y0);
+            break;
+        case(draw_dotline) :
+            display_draw_dotline(c->x0, c->x1);
+            break;
+    }
+}
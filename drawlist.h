@@ -0,0 +1,29 @@
+/*
+********************************************************************************
+* name   :  drawlist.h
+* author :  Rasmus Kallqvist, 2017
+* brief  :  Header file for drawlist.c
+********************************************************************************
+*/
+
+#ifndef DRAWLIST_H
+#define DRAWLIST_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>     /* Declarations of uint_32 and the like */
+#include "display.h"    /* OLED display device drivers and draw functions */
+
+/* Defines -------------------------------------------------------------------*/
+#define DRAWLIST_LEN        16      /* Max number of commands per frame */
+#define DRAWLIST_TEXT_LEN   16      /* Max characters of a text command */
+
+/* Function prototypes -------------------------------------------------------*/
+void drawlist_begin(void);
+void drawlist_rect(int x0, int y0, int x1, int y1, uint8_t col);
+void drawlist_rectfill(int x0, int y0, int x1, int y1, uint8_t col);
+void drawlist_text(char *s, int x, int y);
+void drawlist_sprite(const struct sprite *s, int x, int y);
+void drawlist_dotline(int x0, int len);
+void drawlist_send(void);
+
+#endif /* DRAWLIST_H */
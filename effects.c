@@ -0,0 +1,96 @@
+/*
+********************************************************************************
+* name   :  effects.c
+* author :  Rasmus Kallqvist, 2017
+* brief  :  Sequences display effects that run in the display controller, such
+*           as contrast fades, from the main loop. Each step only sends a few
+*           command bytes, the screen contents are not resent.
+********************************************************************************
+*/
+
+/* Include -------------------------------------------------------------------*/
+#include "effects.h"
+
+/* Declarations --------------------------------------------------------------*/
+enum effect {effect_none, effect_fade, effect_pulse};
+
+/* Local variables -----------------------------------------------------------*/
+static enum effect cur_effect = effect_none;
+static uint16_t contrast = DISPLAY_CONTRAST_DEFAULT << 8;	/* 8.8 fixed point */
+static int32_t contrast_step;		/* Change per frame, 8.8 fixed point */
+static uint8_t frames_left;			/* Frames until fade reaches target */
+static uint8_t pulse_frames;		/* Frames of each half of a pulse */
+static uint8_t fade_from, fade_to;	/* Contrast levels of current fade */
+
+
+/* Function definitions ------------------------------------------------------*/
+/* Brief  : Fades display contrast from its current level to the level to,
+ *          over the given number of calls to effects_work().
+ * Author : Rasmus Kallqvist 	*/
+void effects_fade(uint8_t to, uint8_t frames)
+{
+	if(frames == 0)
+		frames = 1;
+	contrast_step = (((int32_t)to << 8) - (int32_t)contrast) / frames;
+	frames_left = frames;
+	fade_to = to;
+	cur_effect = effect_fade;
+}
+
+/* Brief  : Fades display contrast back and forth between the levels low and
+ *          high, taking the given number of frames in each direction, until
+ *          stopped with effects_stop().
+ * Author : Rasmus Kallqvist 	*/
+void effects_pulse(uint8_t low, uint8_t high, uint8_t frames)
+{
+	effects_fade(high, frames);
+	fade_from = low;
+	fade_to = high;
+	pulse_frames = frames;
+	cur_effect = effect_pulse;
+}
+
+/* Brief  : Stops any running effect and restores the default contrast
+ * Author : Rasmus Kallqvist 	*/
+void effects_stop(void)
+{
+	cur_effect = effect_none;
+	contrast = DISPLAY_CONTRAST_DEFAULT << 8;
+	display_set_contrast(DISPLAY_CONTRAST_DEFAULT);
+}
+
+/* Brief  : Returns non-zero while an effect is running
+ * Author : Rasmus Kallqvist 	*/
+uint8_t effects_busy(void)
+{
+	return cur_effect != effect_none;
+}
+
+/* Brief  : Steps the running effect by one frame, sending the new contrast
+ *          level to the display if it changed. Call once per frame.
+ * Author : Rasmus Kallqvist 	*/
+void effects_work(void)
+{
+	uint8_t prev_level = contrast >> 8;
+
+	if(cur_effect == effect_none)
+		return;
+
+	/* Step towards target, land exactly on it */
+	frames_left--;
+	if(frames_left)
+		contrast += contrast_step;
+	else
+		contrast = (uint16_t)fade_to << 8;
+
+	if((contrast >> 8) != prev_level)
+		display_set_contrast(contrast >> 8);
+
+	/* Target reached */
+	if(frames_left)
+		return;
+	if(cur_effect == effect_pulse)
+		effects_pulse(fade_to, fade_from, pulse_frames);
+	else
+		cur_effect = effect_none;
+}
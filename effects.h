@@ -0,0 +1,23 @@
+/*
+********************************************************************************
+* name   :  effects.h
+* author :  Rasmus Kallqvist, 2017
+* brief  :  Header file for effects.c
+********************************************************************************
+*/
+
+#ifndef EFFECTS_H
+#define EFFECTS_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>  	/* Declarations of uint_32 and the like */
+#include "display.h"  	/* OLED display device drivers and draw functions */
+
+/* Function declarations -----------------------------------------------------*/
+void effects_fade(uint8_t to, uint8_t frames);
+void effects_pulse(uint8_t low, uint8_t high, uint8_t frames);
+void effects_stop(void);
+uint8_t effects_busy(void);
+void effects_work(void);
+
+#endif /* EFFECTS_H */
@@ -0,0 +1,33 @@
+/*
+********************************************************************************
+* name   :  fixed.h
+* author :  Rasmus Kallqvist, 2017
+* brief  :  Q16.16 fixed point arithmetic. Values are int32_t with 16 integer
+*           and 16 fraction bits, so game physics runs on integer instructions
+*           instead of software float calls, with the same results on the
+*           target and on a host.
+********************************************************************************
+*/
+
+#ifndef FIXED_H
+#define FIXED_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>     /* Declarations of uint_32 and the like */
+
+/* Defines -------------------------------------------------------------------*/
+#define FIX_SHIFT           16
+#define FIX_ONE             ((int32_t)1 << FIX_SHIFT)
+/* Conversions. FIX_CONST is for constant expressions only, the compiler
+   folds the float math away. */
+#define FIX_CONST(x)        ((int32_t)((x) * FIX_ONE + ((x) < 0 ? -0.5 : 0.5)))
+#define FIX_FROM_INT(i)     ((int32_t)(i) * FIX_ONE)
+#define FIX_ROUND(a)        (((int32_t)(a) + (FIX_ONE >> 1)) >> FIX_SHIFT)
+/* Arithmetic, product is rounded towards minus infinity */
+#define FIX_MUL(a, b)       ((int32_t)(((int64_t)(a) * (b)) >> FIX_SHIFT))
+#define FIX_ABS(a)          ((a) < 0 ? -(a) : (a))
+#define FIX_SGN(a)          ((a) < 0 ? -FIX_ONE : FIX_ONE)
+/* Saturates a to the range lo to hi */
+#define FIX_CLAMP(a, lo, hi) ((a) < (lo) ? (lo) : ((a) > (hi) ? (hi) : (a)))
+
+#endif /* FIXED_H */
@@ -20,26 +20,180 @@
 /* Includes ------------------------------------------------------------------*/
 #include "input.h"
 
+/* Defines -------------------------------------------------------------------*/
+#define ADC_HALF_BUFFER	8	/* Results in each half of the split buffers */
+
+/* Scans of an interrupt fit in half of the buffers, and the sums take whole
+   interrupts */
+typedef char adc_scans_check[
+	ADC_SCAN_COUNT * ADC_IRQ_SCANS <= ADC_HALF_BUFFER &&
+	INPUT_OVERSAMPLE % ADC_IRQ_SCANS == 0 ? 1 : -1];
+
 /* Local variables -----------------------------------------------------------*/
 static uint8_t analog_pin_nr[6] = {2, 4, 8, 10, 12, 14};
 
+/* Latest filtered values of A0 to A2, written by input_adc_isr(). The
+   sequence counter is odd while the values are being written and is bumped
+   twice per filtered value. */
+static volatile uint16_t adc_values[ADC_SCAN_COUNT];
+static volatile uint32_t adc_seq;
+
+/* Filter state, only touched by input_adc_isr() */
+static uint8_t adc_scans;						/* Scans in the sums */
+static uint16_t adc_prev[ADC_SCAN_COUNT][2];	/* Last two samples */
+static uint16_t adc_sum[ADC_SCAN_COUNT];		/* Oversampling sums */
+static int32_t adc_smooth[ADC_SCAN_COUNT];		/* IIR output, 6 fraction bits */
+
+/* Debouncing, only touched by input_debounce_isr(). Bit n of a mask is the
+   event input n, see INPUT_BTN() and INPUT_SW(). */
+static uint8_t debounce_state;				/* Debounced inputs */
+static uint8_t debounce_count[8];			/* Samples in a row that differ */
+static uint32_t debounce_edge[8];			/* First of those samples */
+
+/* Event queue, single producer input_debounce_isr() and single consumer
+   main loop. Each index is only written by one side. */
+static struct input_event event_queue[INPUT_EVENT_QUEUE];
+static volatile uint32_t event_head;		/* Next to put, producer */
+static volatile uint32_t event_tail;		/* Next to get, consumer */
+static volatile uint32_t event_dropped;		/* Events lost to a full queue */
+
 
 /* Function definitions ------------------------------------------------------*/
-/* 	Brief	: Get sampled analog input values
+/* 	Brief	: Get latest filtered analog input value of A0 to A2, see
+			  input_adc_isr(). Does not wait for the ADC, the pins are
+			  scanned in the background.
 	Author	: Rasmus Kallqvist / Axel Isaksson */
 uint16_t input_get_analog(uint8_t pin)
 {
-	/* Select potentiometer in MUX A */
-	AD1CHSCLR = 0xF << 16; // clear bit <19:16>
-	AD1CHSSET = analog_pin_nr[pin] << 16; // select analog input in MUX A
+	uint32_t seq;
+	uint16_t value;
+
+	if(pin >= ADC_SCAN_COUNT)
+		return 0;
+
+	/* Read again if new values were latched meanwhile */
+	do
+	{
+		seq = adc_seq;
+		value = adc_values[pin];
+	}
+	while((seq & 0x1) || seq != adc_seq);
+
+	return value;
+}
+
+/* 	Brief	: Copies the latest filtered values of A0 to A2, all latched at
+			  the same time, to values. Returns the number of values latched
+			  so far, so a caller can tell if anything new was sampled.
+	Author	: Rasmus Kallqvist */
+uint32_t input_get_analogs(uint16_t *values)
+{
+	uint32_t seq;
+	uint8_t i;
+
+	do
+	{
+		seq = adc_seq;
+		for(i = 0; i < ADC_SCAN_COUNT; i++)
+			values[i] = adc_values[i];
+	}
+	while((seq & 0x1) || seq != adc_seq);
+
+	return seq >> 1;
+}
+
+/* 	Brief	: Filters one oversampled value of an analog input, sum is
+			  INPUT_OVERSAMPLE samples added up. Returns the value to use,
+			  0 - 1023, which only moves to another of the INPUT_ROWS
+			  racket rows once the filtered value is more than
+			  INPUT_DEADBAND past the boundary of the row of last.
+	Author	: Rasmus Kallqvist */
+uint16_t input_filter(uint8_t pin, uint16_t sum, uint16_t last)
+{
+	int32_t x = (int32_t)sum << (6 - INPUT_OVERSAMPLE_SHIFT);
+	int32_t value, row, last_row, edge;
+
+	/* First order low pass, y += (x - y) / 2^INPUT_FILTER_SHIFT */
+	adc_smooth[pin] += (x - adc_smooth[pin]) >> INPUT_FILTER_SHIFT;
+	value = (adc_smooth[pin] + 32) >> 6;
+
+	/* Hysteresis around the racket rows, see pong_update_step(), so noise
+	   at a pixel boundary does not flip the racket back and forth. Within
+	   a row the value goes through, next to it the value is held at the
+	   edge of the last row until it is clear of the boundary. */
+	row = value * INPUT_ROWS / 1024;
+	last_row = last * INPUT_ROWS / 1024;
+	if(row == last_row + 1)
+	{
+		edge = (row * 1024 + INPUT_ROWS - 1) / INPUT_ROWS; /* First of row */
+		if(value < edge + INPUT_DEADBAND)
+			return edge - 1;
+	}
+	if(row == last_row - 1)
+	{
+		edge = (last_row * 1024 + INPUT_ROWS - 1) / INPUT_ROWS;
+		if(value + INPUT_DEADBAND >= edge)
+			return edge;
+	}
+	return value;
+}
+
+/* 	Brief	: Adds the median of the last three scans to the oversampling
+			  sums for each of the ADC_IRQ_SCANS scans in the half of the
+			  ADC buffers the ADC is done with, then filters and latches
+			  new values once there are INPUT_OVERSAMPLE scans in the sums.
+			  Called from the interrupt handler when the ADC interrupt flag
+			  is set. Must not be interrupted by code that reads the values,
+			  or the reader would spin forever. Costs at most a few dozen
+			  instructions per input and scan.
+	Author	: Rasmus Kallqvist */
+void input_adc_isr(void)
+{
+	/* Result buffers are 16 bytes apart, scanned pins go in rising order.
+	   The ADC goes on filling the other half of them while this one is
+	   read, BUFS is set while it fills the upper half. */
+	volatile uint32_t *buf = (volatile uint32_t *)&ADC1BUF0;
+	uint16_t a, b, c, t;
+	uint8_t i, n;
+
+	if(!(AD1CON2 & (0x1 << 7)))
+		buf += 4 * ADC_HALF_BUFFER;
+
+	/* Median of the last three samples drops single sample spikes */
+	for(n = 0; n < ADC_IRQ_SCANS; n++)
+	{
+		for(i = 0; i < ADC_SCAN_COUNT; i++)
+		{
+			c = buf[4 * (n * ADC_SCAN_COUNT + i)];
+			if(adc_seq == 0 && adc_scans == 0 && n == 0) /* Very first scan */
+				adc_prev[i][0] = adc_prev[i][1] = c;
+			a = adc_prev[i][0];
+			b = adc_prev[i][1];
+			adc_prev[i][0] = b;
+			adc_prev[i][1] = c;
+			if(a > b) { t = a; a = b; b = t; }	/* a <= b */
+			adc_sum[i] += c < a ? a : (c > b ? b : c);
+		}
+	}
+	IFSCLR(1) = 0x1 << 1; // reset interrupt flag, after reading the buffers
+
+	adc_scans += ADC_IRQ_SCANS;
+	if(adc_scans < INPUT_OVERSAMPLE)
+		return;
+	adc_scans = 0;
 
-	/* Start sampling, wait until conversion is done */
-	AD1CON1 |= (0x1 << 1);				// start sampling analog input
-	while(!(AD1CON1 & (0x1 << 1))); 	// wait for sampling to finish
-	while(!(AD1CON1 & 0x1));			// wait for conversion to finish 
+	/* Start the low pass at the first values instead of rising from 0 */
+	if(adc_seq == 0)
+		for(i = 0; i < ADC_SCAN_COUNT; i++)
+			adc_smooth[i] = (int32_t)adc_sum[i] << (6 - INPUT_OVERSAMPLE_SHIFT);
 
-	/* Return sampled value found in buffer */
-	return ADC1BUF0;
+	adc_seq++;
+	for(i = 0; i < ADC_SCAN_COUNT; i++)
+	{
+		adc_values[i] = input_filter(i, adc_sum[i], adc_values[i]);
+		adc_sum[i] = 0;
+	}
+	adc_seq++;
 }
 
 /* Brief  : Get push button state (Button 3:0)
@@ -53,29 +207,145 @@ uint8_t input_get_btn(uint8_t btn)
 	return (regval >> btn) & 0x1;	
 }
 
+/* Brief  : Get switch state (Switch 3:0)
+ * Author : Rasmus Kallqvist
+ * Note   : Switches are indexed 3:0 in code but labeled 4:1 */
+uint8_t input_get_sw(uint8_t sw)
+{
+	return (PORTD >> (8 + sw)) & 0x1;	/* Switches are PORTD bits 11:8 */
+}
+
+/* Brief  : Get buttons 3:0 in bits 3:0 and switches 3:0 in bits 7:4, the
+ *          same bits as event inputs INPUT_BTN() and INPUT_SW()
+ * Author : Rasmus Kallqvist */
+uint8_t input_get_all(void)
+{
+	uint32_t regval = 0;
+	regval |= (PORTD >> 4) & (0x07 << 1);   /* Buttons 3:1, PORTD bits 7:5 */
+	regval |= (PORTF & 0x02) >> 1; 			/* Button 0, PORTF bit 1 */
+	regval |= (PORTD >> 4) & (0x0F << 4);	/* Switches, PORTD bits 11:8 */
+	return regval;
+}
+
+/* Brief  : Samples the buttons and switches and queues an event whenever
+ *          one has read the same for INPUT_DEBOUNCE_SAMPLES samples in a
+ *          row after changing. Bounces start the count over. Called every
+ *          INPUT_SAMPLE_US from a timer interrupt, now is the time stamp
+ *          given to events.
+ * Author : Rasmus Kallqvist */
+void input_debounce_isr(uint32_t now)
+{
+	struct input_event event;
+	uint8_t raw, changed, i;
+
+	raw = input_get_all();
+	changed = raw ^ debounce_state;
+	for(i = 0; i < 8; i++)
+	{
+		if(!(changed >> i & 0x1))
+		{
+			debounce_count[i] = 0;		/* Bounced back, or never changed */
+			continue;
+		}
+		if(debounce_count[i]++ == 0)
+			debounce_edge[i] = now;
+		if(debounce_count[i] < INPUT_DEBOUNCE_SAMPLES)
+			continue;
+
+		/* Held long enough, new state */
+		debounce_count[i] = 0;
+		debounce_state ^= 0x1 << i;
+		event.time = debounce_edge[i];
+		event.input = i;
+		event.pressed = raw >> i & 0x1;
+		input_event_put(&event);
+	}
+}
+
+/* Brief  : Adds an event to the queue, only called by one producer. Returns
+ *          0 and counts the event as dropped if the queue is full.
+ * Author : Rasmus Kallqvist */
+uint8_t input_event_put(const struct input_event *event)
+{
+	uint32_t head = event_head;
+
+	if(head - event_tail >= INPUT_EVENT_QUEUE)
+	{
+		event_dropped++;
+		return 0;
+	}
+	event_queue[head & (INPUT_EVENT_QUEUE - 1)] = *event;
+	__sync_synchronize();	/* Event is written before it is made visible */
+	event_head = head + 1;
+	return 1;
+}
+
+/* Brief  : Takes the oldest event off the queue, only called by one
+ *          consumer. Returns 0 if there was none.
+ * Author : Rasmus Kallqvist */
+uint8_t input_event_get(struct input_event *event)
+{
+	uint32_t tail = event_tail;
+
+	if(tail == event_head)
+		return 0;
+	__sync_synchronize();	/* Head is read before the event it covers */
+	*event = event_queue[tail & (INPUT_EVENT_QUEUE - 1)];
+	__sync_synchronize();	/* Event is read before its slot is given back */
+	event_tail = tail + 1;
+	return 1;
+}
+
+/* Brief  : Returns the number of events lost because the queue was full
+ * Author : Rasmus Kallqvist */
+uint32_t input_events_dropped(void)
+{
+	return event_dropped;
+}
+
 /* 	Brief	: Initialize the ADC peripheral
 	Author	: Original code by Axel Isaksson, edited by Rasmus Kallqvist */
 void init_adc(void)
 {
+	uint8_t i;
+
 	/* Set up LED pins as outputs */
 	TRISECLR = 0xFF;
 
-	/* Enable analog input A0, Port B pin 2 */
-	AD1PCFGCLR = ~(0x1 << 2);
-	TRISBSET   =  (0x1 << 2);
-
-	/* Enable analog input A1, Port B pin 4 */
-	AD1PCFGCLR = ~(0x1 << 4);
-	TRISBSET   =  (0x1 << 4);
+	/* Enable analog inputs A0 to A2 and scan them in rising order */
+	AD1CSSL = 0x0;
+	for(i = 0; i < ADC_SCAN_COUNT; i++)
+	{
+		AD1PCFGCLR = (0x1 << analog_pin_nr[i]);
+		TRISBSET   = (0x1 << analog_pin_nr[i]);
+		AD1CSSL   |= (0x1 << analog_pin_nr[i]);
+	}
 
 	/* Data format in uint32, 0 - 1023
-	Manual sampling, auto conversion when sampling is done
-	FORM = 0x4; SSRC = 0x7; CLRASAM = 0x0; ASAM = 0x0; */
-	AD1CON1		= (0x4 << 8) | (0x7 << 5);
-	AD1CON2 	= 0x0;
-	AD1CON3SET 	= 0x1 << 15;
+	Sampling starts again by itself after each conversion, auto conversion
+	when sampling is done
+	FORM = 0x4; SSRC = 0x7; CLRASAM = 0x0; ASAM = 0x1; */
+	AD1CON1		= (0x4 << 8) | (0x7 << 5) | (0x1 << 2);
+
+	/* Scan the inputs in AD1CSSL, interrupt after ADC_IRQ_SCANS full
+	scans. Split buffers, the ADC fills one half of 8 results while the
+	interrupt handler reads the other.
+	CSCNA = 0x1; SMPI = ADC_SCAN_COUNT * ADC_IRQ_SCANS - 1; BUFM = 0x1; */
+	AD1CON2 	= (0x1 << 10) | ((ADC_SCAN_COUNT * ADC_IRQ_SCANS - 1) << 2) |
+				  (0x1 << 1);
+
+	/* Peripheral clock, TAD = 2 * (ADCS + 1) * TPB = 1.6 us, and 31 TAD
+	sampling. A conversion is 31 + 12 TAD, one scan of A0 to A2 about 200 us
+	ADRC = 0x0; SAMC = 31; ADCS = 31; */
+	AD1CON3 	= (31 << 8) | 31;
+
+	/* Enable ADC interrupts */
+	IPCCLR(6) = 0x1F << 24;
+	IPCSET(6) = 0x7 << 26;		// set interrupt priority to 7, shadow set
+	IFSCLR(1) = 0x1 << 1;		// clear adc interrupt flag
+	IECSET(1) = 0x1 << 1;		// adc interrupt enable
 
-	/* Turn on ADC */
+	/* Turn on ADC, scanning runs from here on */
 	AD1CON1SET = (0x1 << 15);
 }
 
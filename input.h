@@ -6,12 +6,59 @@
 ********************************************************************************
 */
 
+#ifndef INPUT_H
+#define INPUT_H
+
 /* Includes ------------------------------------------------------------------*/
 #include <pic32mx.h>	/* Declarations of hardware-specific addresses etc */
 #include <stdint.h>     /* Contains uint32_t and the like */
 
+/* Defines -------------------------------------------------------------------*/
+#define ADC_SCAN_COUNT	3	/* Analog inputs A0 to A2 are scanned */
+
+/* Potentiometer filtering, see input_adc_isr(). A scan takes about 200 us */
+#define ADC_IRQ_SCANS			2	/* Scans per ADC interrupt, half of the
+									   result buffers */
+#define INPUT_OVERSAMPLE_SHIFT	2	/* Scans averaged per value, 2^n, a
+									   multiple of ADC_IRQ_SCANS */
+#define INPUT_OVERSAMPLE		(1 << INPUT_OVERSAMPLE_SHIFT)
+#define INPUT_FILTER_SHIFT		2	/* Low pass weight of a new value, 2^-n */
+#define INPUT_ROWS				20	/* Racket rows the values are read as,
+									   32 - RACKET_H, see pong_update_step() */
+#define INPUT_DEADBAND			4	/* Past a row boundary needed to move to
+									   the next row, 0 - 1023 units */
+
+/* Button and switch events, see input_debounce_isr() */
+#define INPUT_SAMPLE_US			1000	/* Buttons and switches sampled this often */
+#define INPUT_DEBOUNCE_SAMPLES	5		/* Same samples in a row to change state */
+#define INPUT_EVENT_QUEUE		16		/* Events buffered, a power of 2 */
+#define INPUT_BTN(n)			(n)		/* Event input of button n, 0 - 3 */
+#define INPUT_SW(n)				(4 + (n))	/* Event input of switch n, 0 - 3 */
+
+/* Structs -------------------------------------------------------------------*/
+/* Brief  : A button or switch changed state, after debouncing
+ * Author : Rasmus Kallqvist */
+struct input_event
+{
+	uint32_t time;		/* First sample of the new, settled state, in
+						   input_debounce_isr() time */
+	uint8_t input;		/* INPUT_BTN(n) or INPUT_SW(n) */
+	uint8_t pressed;	/* 1 if pressed or switched on, 0 if released */
+};
+
 /* Function prototypes -------------------------------------------------------*/
 uint16_t input_get_analog(uint8_t pin);
+uint32_t input_get_analogs(uint16_t *values);
+uint16_t input_filter(uint8_t pin, uint16_t sum, uint16_t last);
+void input_adc_isr(void);
 uint8_t input_get_btn(uint8_t btn);
+uint8_t input_get_sw(uint8_t sw);
+uint8_t input_get_all(void);
+void input_debounce_isr(uint32_t now);
+uint8_t input_event_put(const struct input_event *event);
+uint8_t input_event_get(struct input_event *event);
+uint32_t input_events_dropped(void);
 void init_adc(void);
 void init_btn(void);
+
+#endif /* INPUT_H */
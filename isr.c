@@ -0,0 +1,51 @@
+/*
+********************************************************************************
+* name   :  isr.c
+* author :  Rasmus Kallqvist, 2017
+* brief  :  Multi-vector interrupts with a C handler per vector. Each vector
+*           stub in vectors.S jumps to the entry code in
+*           _isr_primary_install, which calls the handler in isr_handlers.
+*           Vectors without a handler still go to user_isr().
+********************************************************************************
+*/
+
+/* Includes ------------------------------------------------------------------*/
+#include "isr.h"
+
+/* Global variables ----------------------------------------------------------*/
+void (*isr_handlers[ISR_VECTORS])(void);	/* Read by vectors.S */
+extern void (*_isr_primary_install[ISR_VECTORS])(void);	/* vectors.S */
+
+/* Local variables -----------------------------------------------------------*/
+static uint64_t isr_stack[ISR_STACK_BYTES / 8];	/* Shadow set stack, 8 byte
+													   aligned as calls need */
+static uint8_t isr_shadow;					/* Shadow register set is set up */
+
+/* Function definitions ------------------------------------------------------*/
+/* Brief  : Switches interrupts to multi-vector mode and sets up the shadow
+ *          register set for fast handlers. Call before interrupts are
+ *          enabled, and before installing handlers.
+ * Author : Rasmus Kallqvist */
+void init_isr(void)
+{
+	isr_shadow = shadow_set_init(&isr_stack[ISR_STACK_BYTES / 8]) != 0;
+	INTCONSET = 0x1 << 12;	// MVEC, multi-vector mode
+}
+
+/* Brief  : Makes interrupts on vector go straight to handler, which must
+ *          clear the interrupt flag. A fast handler skips the register
+ *          saves when its interrupt priority is ISR_SHADOW_PRIORITY, as
+ *          those run on the shadow register set. At other priorities it
+ *          is entered the normal way.
+ * Author : Rasmus Kallqvist */
+void isr_install(uint8_t vector, void (*handler)(void), uint8_t fast)
+{
+	uint32_t status = disable_interrupt();
+
+	isr_handlers[vector] = handler;
+	if(fast && isr_shadow)
+		_isr_primary_install[vector] = _isr_fast;
+	else
+		_isr_primary_install[vector] = _isr_trampoline;
+	restore_interrupt(status);
+}
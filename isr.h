@@ -0,0 +1,37 @@
+/*
+********************************************************************************
+* name   :  isr.h
+* author :  Rasmus Kallqvist, 2017
+* brief  :  Header for isr.c
+********************************************************************************
+*/
+
+#ifndef ISR_H
+#define ISR_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <pic32mx.h>	/* Declarations of hardware-specific addresses etc */
+#include <stdint.h>  	/* Declarations of uint_32 and the like */
+
+/* Defines -------------------------------------------------------------------*/
+#define		ISR_VECTORS			64
+#define		ISR_STACK_BYTES		512		/* Stack of the shadow register set */
+#define		ISR_SHADOW_PRIORITY	7		/* Priority that gets the shadow set */
+/* Interrupt vectors in use */
+#define		ISR_VECTOR_CORE_TIMER	0
+#define		ISR_VECTOR_ADC			27
+#define		ISR_VECTOR_SPI2			31
+
+/* Function prototypes -------------------------------------------------------*/
+void init_isr(void);
+void isr_install(uint8_t vector, void (*handler)(void), uint8_t fast);
+/* Vector entry code, vectors.S */
+void _isr_trampoline(void);
+void _isr_fast(void);
+/* Interrupt control and shadow set setup, init.S */
+void enable_interrupt(void);
+uint32_t disable_interrupt(void);
+void restore_interrupt(uint32_t status);
+uint32_t shadow_set_init(void *sp);
+
+#endif /* ISR_H */
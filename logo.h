@@ -8,6 +8,8 @@
 
 #ifndef LOGO_H
 #define LOGO_H
+/* Page-packed sprite data, 3 pages of 38 columns. Set bits are lit pixels,
+   rows below the 19th are zero. */
 static const uint8_t ponglogo[114] =
 {
 	////////////////////////////////////////
@@ -31,9 +33,11 @@ static const uint8_t ponglogo[114] =
 	//                                      
 	//                                       
 	////////////////////////////////////////
-	0x0C, 0x0C, 0xCC, 0xCC, 0xCC, 0xCC, 0x0C, 0x1C, 0xFC, 0xFC, 0x3C, 0x1C, 0x8C, 0xCC, 0xCC, 0x8C, 0x1C, 0x3C, 0xFC, 0xFC, 0x0C, 0x0C, 0x1C, 0x3C, 0x7C, 0xFC, 0x0C, 0x0C, 0xFC, 0xFC, 0x3C, 0x1C, 0x8C, 0xCC, 0xCC, 0x8C, 0x1C, 0x3C, 
-	0x80, 0x80, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFE, 0xFF, 0xFF, 0xE0, 0xC0, 0x8F, 0x9F, 0x9F, 0x8F, 0xC0, 0xE0, 0xFF, 0xFF, 0x80, 0x80, 0xFF, 0xFE, 0xFC, 0xF8, 0x80, 0x80, 0xFF, 0xFF, 0xE0, 0xC0, 0x8F, 0x9F, 0x9F, 0x93, 0x83, 0xC3, 
-	0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 
+	0xF3, 0xF3, 0x33, 0x33, 0x33, 0x33, 0xF3, 0xE3, 0x03, 0x03, 0xC3, 0xE3, 0x73, 0x33, 0x33, 0x73, 0xE3, 0xC3, 0x03, 0x03, 0xF3, 0xF3, 0xE3, 0xC3, 0x83, 0x03, 0xF3, 0xF3, 0x03, 0x03, 0xC3, 0xE3, 0x73, 0x33, 0x33, 0x73, 0xE3, 0xC3, 
+	0x7F, 0x7F, 0x03, 0x03, 0x03, 0x03, 0x03, 0x01, 0x00, 0x00, 0x1F, 0x3F, 0x70, 0x60, 0x60, 0x70, 0x3F, 0x1F, 0x00, 0x00, 0x7F, 0x7F, 0x00, 0x01, 0x03, 0x07, 0x7F, 0x7F, 0x00, 0x00, 0x1F, 0x3F, 0x70, 0x60, 0x60, 0x6C, 0x7C, 0x3C, 
+	0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 
 };
 
+static const struct sprite logo_sprite = {38, 19, ponglogo, 0};
+
 #endif /* LOGO_H */
\ No newline at end of file
@@ -11,75 +11,212 @@
 #include "main.h"
 
 /* Local variables -----------------------------------------------------------*/
-/* Timer */
-static uint32_t timer_counter;	/* Tracks number of timer 2 interrupts */
-static uint8_t  timeout_flag;	/* Signals 1/30th second has elapsed */
-static uint8_t  update_counter; /* Tracks 30 updates per second */
+/* Timers */
+static volatile uint8_t timeout_flag;	/* Signals 1/30th second has elapsed */
+static struct sched_timer frame_timer;	/* Menu frames, 30 per second */
+static struct sched_timer input_timer;	/* Button and switch sampling */
+static struct sched_timer display_timer;	/* Display power up steps */
+/* Game */
+static struct pong_ctx game;
+static struct pong_ai ai;		/* Player 2 in single player games */
+/* Game loop, see game_loop_work(). Times in core timer ticks. */
+static struct pong_ai *loop_opponent;
+static uint8_t loop_paused;
+static uint32_t loop_last;		/* Time the loop last ran */
+static uint32_t loop_lag;		/* Game time not yet updated */
+static uint32_t loop_undrawn;	/* Updates since last frame */
+static uint32_t loop_dropped;	/* Updates never drawn, this second */
+static uint32_t loop_busy;		/* Loop time spent working, this second */
+static uint32_t loop_stat;		/* Start of this second */
+static uint32_t loop_stat_count;	/* Interrupts and their ticks then */
+static uint32_t loop_stat_ticks;
+/* Game loop statistics */
+static uint32_t frames_dropped;	/* Updates never drawn, during last second */
+static uint32_t interrupt_rate;	/* Interrupts during last second */
+static uint8_t  idle_percent;	/* Main loop time with nothing to do */
+static uint32_t isr_latency;	/* Least interrupt entry time, CPU cycles */
+static volatile uint32_t interrupt_count;	/* Interrupts so far */
+static volatile uint32_t interrupt_ticks;	/* Core timer ticks spent in them */
+
+/* Local function prototypes -------------------------------------------------*/
+static void game_loop_stat_begin(uint32_t now);
 
 /* Function definitions ------------------------------------------------------*/
 /* Main */
 int main(void)
 {
 
-	// pause buttons 
-	uint8_t button_state;
-	uint8_t prev_button_state = 0; 
-	uint8_t game_paused = 0;
+	// buttons and switches
+	struct input_event event;
+	uint8_t switches = 0;			/* Debounced switch states, bits 3:0 */
 	uint8_t start_pressed = 0;
+	// single player
+	struct pong_ai *opponent = 0;
 
 	/* Low level initialization */
 	init_mcu();
 
-	/* Initialization */
+	/* Initialization, display powers up in timer interrupt */
 	led_write(0x1); // signal bootup
-	init_tim();
+	init_sched();
 	init_adc();
-	init_display();
+#ifndef ISR_SINGLE_VECTOR
+	/* A vector per interrupt source, short ones on the shadow register set */
+	init_isr();
+	isr_install(ISR_VECTOR_CORE_TIMER, core_timer_isr, 1);
+	isr_install(ISR_VECTOR_ADC, adc_isr, 1);
+	isr_install(ISR_VECTOR_SPI2, spi_isr, 0);
+#endif
+	frame_timer.run = frame_tick;
+	sched_add(&frame_timer, SCHED_US(MENU_FRAME_US), SCHED_US(MENU_FRAME_US));
+	input_timer.run = input_tick;
+	sched_add(&input_timer, SCHED_US(INPUT_SAMPLE_US), SCHED_US(INPUT_SAMPLE_US));
+	display_timer.run = display_power_tick;
+	sched_add(&display_timer, SCHED_US(display_power_begin()), 0);
 	enable_interrupt();
-	led_write(0x0); // bootup done
 
-	/* Set up game */
-	pong_setup();
+	/* Set up game and draw menu while display powers up */
+	pong_setup(&game);
+	menu_draw_title();
+	while(!display_power_ready());
+	led_write(0x0); // bootup done
 
-	/* Menu screen */
+	/* Menu screen, pulses by fading display contrast */
+	effects_pulse(0x10, 0xFF, 30);
 	while(!start_pressed)
 	{
-		/* Push button starts game */
-		button_state = input_get_btn(3);
-		if(button_state & !prev_button_state)
-			start_pressed = 1;
-		prev_button_state = button_state;
-
-		/* Show logo */
-		display_cls();
-		display_draw_dotline(0,1);
-		display_draw_dotline(126,1);
-		display_draw_logo(45,0);
-		display_print("press start",20,19+2);
-		display_update();
+		/* Clock menu at 30 updates per second */
+		while(!timeout_flag);
+		timeout_flag = 0; // reset timeout flag
+
+		/* Show logo, only changed pages are sent */
+		drawlist_send();
+		menu_draw_title();
+		effects_work();
+
+		/* Push button starts game, switches are kept track of */
+		while(input_event_get(&event))
+		{
+			if(event.input == INPUT_BTN(3) && event.pressed)
+				start_pressed = 1;
+			else if(event.input >= INPUT_SW(0) && event.pressed)
+				switches |= 0x1 << (event.input - INPUT_SW(0));
+			else if(event.input >= INPUT_SW(0))
+				switches &= ~(0x1 << (event.input - INPUT_SW(0)));
+		}
+	}
+	effects_stop();
+	sched_cancel(&frame_timer);
+
+	/* Switch 1 makes player 2 a computer player, switches 3:2 set how good
+	   it is */
+	if(switches & 0x1)
+	{
+		ai_setup(&ai, &game, (switches >> 1) & 0x3, sched_now());
+		opponent = &ai;
 	}
 
 	/* Run game */
+	game_loop_begin(opponent);
 	while(1)
+		game_loop_work();
+
+	return 0;
+}
+
+/* Starts the game loop, with player 2 the computer player opponent unless
+   it is null. Game state is updated at a fixed rate, from the time that
+   has passed. Frames are drawn whenever the game has moved on and the
+   display is done with the previous frame, so slow frames do not slow the
+   game. */
+void game_loop_begin(struct pong_ai *opponent)
+{
+	loop_opponent = opponent;
+	loop_paused = 0;
+	loop_lag = loop_undrawn = 0;
+	loop_last = sched_now();
+	game_loop_stat_begin(loop_last);
+}
+
+/* Starts a second of game loop statistics at now */
+static void game_loop_stat_begin(uint32_t now)
+{
+	loop_dropped = loop_busy = 0;
+	loop_stat = now;
+	loop_stat_count = interrupt_count;
+	loop_stat_ticks = interrupt_ticks;
+}
+
+/* One pass of the game loop, runs the updates that are due and draws */
+void game_loop_work(void)
+{
+	struct input_event event;
+	uint32_t now, ticks, latency;
+	uint8_t worked = 0;
+
+	/* Accumulate time passed, give up on catching up if far behind */
+	now = sched_now();
+	ticks = interrupt_ticks;
+	loop_lag += now - loop_last;
+	loop_last = now;
+	if(loop_lag > SCHED_US(GAME_MAX_LAG_US))
+		loop_lag = SCHED_US(GAME_MAX_LAG_US);
+
+	/* Fixed rate updates */
+	while(loop_lag >= SCHED_US(PONG_STEP_US))
 	{
-		/* Clock game at 30 updates per second */
-		while(!timeout_flag);
-		timeout_flag = 0; // reset timeout flag
+		loop_lag -= SCHED_US(PONG_STEP_US);
+		loop_undrawn++;
+		worked = 1;
+
+		/* Push button toggles pause mode, once per press. Statistics are
+		   of the game being played, they start over. */
+		while(input_event_get(&event))
+			if(event.input == INPUT_BTN(3) && event.pressed)
+			{
+				loop_paused = !loop_paused;
+				game_loop_stat_begin(now);
+			}
 
-		/* Push button toggles pause mode */		
-		button_state = input_get_btn(3);
-		if(button_state & !prev_button_state)
-			game_paused = !game_paused;
-		prev_button_state = button_state;
-		
 		/* Iterate game state */
-		if(game_paused)
-			pong_pause();
+		if(!loop_paused)
+			pong_step(&game, loop_opponent);
+	}
+
+	/* Draw latest game state, updates in between are never shown */
+	if(loop_undrawn && !display_flush_busy())
+	{
+		if(loop_paused)
+			pong_pause(&game);
 		else
-			pong_work();
+			pong_draw(&game);
+		loop_dropped += loop_undrawn - 1;
+		loop_undrawn = 0;
+		worked = 1;
 	}
 
-	return 0;
+	/* Loop time spent on updates and drawing, without the interrupts taken
+	   meanwhile, which are counted below */
+	if(worked)
+	{
+		ticks = interrupt_ticks - ticks;
+		loop_busy += sched_now() - now - ticks;
+	}
+
+	/* Frame statistics, once per second of play, the pause screen shows
+	   the last. Idle is what is left after work in the loop and all
+	   interrupts. */
+	if(!loop_paused && now - loop_stat >= SCHED_US(1000000))
+	{
+		frames_dropped = loop_dropped;
+		interrupt_rate = interrupt_count - loop_stat_count;
+		latency = sched_entry_latency();
+		isr_latency = latency == SCHED_NO_LATENCY ? latency : 2 * latency;
+		loop_busy += interrupt_ticks - loop_stat_ticks;
+		idle_percent = loop_busy > now - loop_stat ? 0 :
+					   100 - loop_busy / ((now - loop_stat) / 100);
+		game_loop_stat_begin(now);
+	}
 }
 
 /* Low level initialization of microcontroller */
@@ -114,40 +251,116 @@ void init_mcu(void)
 	SPI2CONSET = 0x8000;	/* SPI2CON bit ON = 1; */
 }
 
-/* Init timer 2 with timeout interrupts */
-void init_tim(void)
+/* Menu frame timer, wakes up the menu loop */
+void frame_tick(struct sched_timer *timer)
+{
+	timeout_flag = 0x1;
+}
+
+/* Button and switch timer, samples them for debouncing */
+void input_tick(struct sched_timer *timer)
+{
+	input_debounce_isr(sched_now());
+}
+
+/* Display power up timer, steps the power up sequence when its delay has
+   passed and waits for the next step */
+void display_power_tick(struct sched_timer *timer)
+{
+	uint32_t wait = display_power_work();
+
+	if(wait)
+		sched_add(timer, SCHED_US(wait), 0);
+}
+
+
+/* Core timer interrupt, a scheduled deadline is due */
+void core_timer_isr(void)
+{
+	uint32_t start = sched_now();
+
+	sched_isr();
+	interrupt_count++;
+	interrupt_ticks += sched_now() - start;
+}
+
+/* ADC interrupt, the potentiometers have been scanned */
+void adc_isr(void)
+{
+	uint32_t start = sched_now();
+
+	input_adc_isr();
+	interrupt_count++;
+	interrupt_ticks += sched_now() - start;
+}
+
+/* Spi 2 interrupt, a display byte has been shifted out */
+void spi_isr(void)
 {
-	/* Configure Timer 2 */
-	T2CON     = 0x0;        	// reset control register
-	T2CONSET  = (0x4 << 4);     // set prescaler to 1:16
-	PR2       = TMR2PERIOD; 	// set period length
-	TMR2      = 0;          	// reset timer value
-	T2CONSET  = (0x1 << 15);    // start the timer
+	uint32_t start = sched_now();
 
-	/* Enable Timer 2 interrupts */
-	IPC(2)    = 0x4;        	// set interrupt priority to 4
-	IECSET(0) = 0x1<<8;      	// timer 2 interrupt enable
-	IFSCLR(0) = 0x1<<8;      	// clear timer 2 interrupt flag
+	display_flush_isr();
+	interrupt_count++;
+	interrupt_ticks += sched_now() - start;
 }
 
 
-/* Dummy function for handling interrupts */
+/* Handles interrupts on vectors without a handler installed, which is all
+   of them in single vector mode */
 void user_isr(void)
 {
- 	/* Timer 2 timeout */
-  	if(IFS(0) & 0x1<<8) // check interrupt flag
+ 	/* Core timer, a scheduled deadline is due */
+  	if(IFS(0) & 0x1) // check interrupt flag
   	{
-  		timer_counter++;
-  		if(timer_counter == 3333) // 30 updates per second
-  		{
-  			timeout_flag = 0x1;		// set timeout flag
-  			timer_counter = 0x0; 	// reset timer counter
-  		}
-
-  		IFSCLR(0) = 0x01<<8; // reset interrupt flag
+  		core_timer_isr();
   	}
 
+ 	/* Spi 2 has shifted out a display byte */
+  	if(IEC(1) & IFS(1) & 0x1<<7) // check interrupt enabled and flagged
+  	{
+  		spi_isr();
+  	}
+
+ 	/* ADC has scanned the potentiometers */
+  	if(IFS(1) & 0x1<<1) // check interrupt flag
+  	{
+  		adc_isr();
+  	}
+}
+
+/* Returns the number of game updates during the last second played that
+   were never drawn, because the display was still busy with an earlier
+   frame. Shown on the pause screen with GAME_STATS. */
+uint32_t game_frames_dropped(void)
+{
+	return frames_dropped;
+}
+
+/* Returns the number of interrupts during the last second of the game.
+   Shown on the pause screen with GAME_STATS. */
+uint32_t game_interrupt_rate(void)
+{
+	return interrupt_rate;
+}
+
+/* Returns the percentage of the last second of the game that the main loop
+   had nothing to do and no interrupt ran. Time in the interrupt entry and
+   exit code counts as idle. Shown on the pause screen with GAME_STATS. */
+uint8_t game_idle_percent(void)
+{
+	return idle_percent;
 }
+
+/* Returns the least number of CPU cycles during the last second of the game
+   from a core timer compare match to its handler, sched_isr(), starting.
+   SCHED_NO_LATENCY if no core timer interrupt ran in that second.
+   Build with ISR_SINGLE_VECTOR to compare with the old user_isr() path.
+   Shown on the pause screen with GAME_STATS. */
+uint32_t game_isr_latency(void)
+{
+	return isr_latency;
+}
+
 /* Turn LED7 to LED0 on or off, bits in write_data specifies LED states */
 void led_write(uint8_t write_data)
 {
@@ -14,27 +14,43 @@
 #include "structs.h"	/* Contains definitions for actor struct */
 #include "pong.h"		/* Contains pong game logic */
 #include "menu.h"		/* Menu state machines */
+#include "effects.h"	/* Contrast fades and other display effects */
+#include "ai.h"			/* Computer player for single player games */
+#include "schedule.h"	/* Timer deadlines on the core timer */
+#include "isr.h"		/* Interrupt handler per vector */
 
 /* Defines -------------------------------------------------------------------*/
-/* Timer */
-#define   	CLOCKFREQ       80000000    	// 80 MHz
-#define   	TIMEOUTPERIOD   0.00001  		// 10 us
-#define   	TMR2PRESCALER   16 			    // (80 MHz / 16) = 5 MHz
-#define   	TMR2PERIOD      ( (CLOCKFREQ / TMR2PRESCALER) * TIMEOUTPERIOD ) - 1
-/* Pong game */
-#define 	PLAYINGFIELD_W		64
-#define 	LEFT_EDGE			(DISPLAY_WIDTH - PLAYINGFIELD_W) / 2
-#define 	RIGHT_EDGE			DISPLAY_WIDTH - PLAYINGFIELD_W / 2
-#define		PLAYINGFIELD_MIDDLE DISPLAY_WIDTH / 2 - 1
+/* Menu */
+#define		MENU_FRAME_US		33333	// 30 menu frames per second
+/* Game loop */
+#define		GAME_MAX_LAG_US		100000	// game time dropped beyond this lag
+/* Interrupts go through one handler per vector. Define ISR_SINGLE_VECTOR to
+   handle them all in user_isr() instead, as before. */
+/* Define GAME_STATS to show the game loop statistics of the last second
+   played on the pause screen, see game_frames_dropped() and the like. */
 
 
 /* Function prototypes -------------------------------------------------------*/
 /* Init and interrupts */
 void user_isr(void);
+void core_timer_isr(void);
+void adc_isr(void);
+void spi_isr(void);
 void init_mcu(void);
-void init_tim(void);
+/* Game loop */
+void game_loop_begin(struct pong_ai *opponent);
+void game_loop_work(void);
+/* Timer callbacks */
+void frame_tick(struct sched_timer *timer);
+void input_tick(struct sched_timer *timer);
+void display_power_tick(struct sched_timer *timer);
 /* Peripherals */
 void led_write(uint8_t write_data);
+/* Statistics */
+uint32_t game_frames_dropped(void);
+uint32_t game_interrupt_rate(void);
+uint8_t game_idle_percent(void);
+uint32_t game_isr_latency(void);
 /* Demos */
 void demo_bouncing_ball(void);
 void demo_moving_ball(void);
@@ -15,6 +15,18 @@ enum menu_state {item_1, item_2, item_3, num_items};
 
 
 /* Function definitions ------------------------------------------------------*/
+/* Brief  : Describes the title screen with logo and start prompt as a draw
+ *          list. Does not send it to the display, see drawlist_send().
+ * Author : Rasmus Kallqvist 	*/
+void menu_draw_title(void)
+{
+	drawlist_begin();
+	drawlist_dotline(0,1);
+	drawlist_dotline(126,1);
+	drawlist_sprite(&logo_sprite,45,0);
+	drawlist_text("press start",20,19+2);
+}
+
 /* Brief  : Testing a menu state machine system 
  * Author : Rasmus Kallqvist 	*/ 
 void menu_test(void)
@@ -10,9 +10,11 @@
 #include <pic32mx.h>	/* Declarations of hardware-specific addresses etc */
 #include <stdint.h>  	/* Declarations of uint_32 and the like */
 #include "display.h"  	/* OLED display device drivers and draw functions */
+#include "drawlist.h"  	/* Retained mode drawing a page at a time */
 #include "input.h"		/* Read potentiometer and buttons values */
 
 /* Declarations --------------------------------------------------------------*/
 
 /* Function declarations -----------------------------------------------------*/
+void menu_draw_title(void);
 
@@ -2,172 +2,105 @@
 ********************************************************************************
 * name   :  pong.c
 * author :  Rasmus Kallqvist / Michel Bitar, 2017
-* brief  :  Contains all game logic for pong game.
+* brief  :  Contains all game logic for pong game. Does not touch the
+*           hardware, drawing and inputs are in pong_draw.c, so the same rules
+*           run in the host match simulator tools/pongsim.c.
 ********************************************************************************
 */
 
 /* Includes ------------------------------------------------------------------*/
 #include "pong.h"
 
-/* Local variables -----------------------------------------------------------*/
-static struct  	actor g_ball;
-static struct  	actor g_left_racket;
-static struct  	actor g_right_racket;
-static int	   	g_pl1_score; 	/* Player 1 score tracker */
-static int     	g_pl2_score; 	/* Player 2 score tracker */
-static enum 	player 	   g_winning_player;
+/* Variables -----------------------------------------------------------------*/
+/* Gameplay constants the firmware plays with */
+const struct pong_params pong_default_params =
+{
+	BALL_SPEEDUP,
+	BALL_MAXSPEED,
+	RACKET_W,
+	RACKET_H,
+	RACKET_EDGE_OFFSET
+};
 
 /* Function definitions ------------------------------------------------------*/
-/* Brief  : Set up pong game and initialize file local variables.
+/* Brief  : Sets up a new pong game in ctx with the default gameplay
+ *          constants.
    Author : Michel Bitar */
-void pong_setup(void)
+void pong_setup(struct pong_ctx *ctx)
 {
-	/* Settings */
-	uint32_t edge_offset = 34; // distance from screen edge
-
-	/* Intialize game structs */
-	g_left_racket.w = 3;
-	g_left_racket.h = 12; 
-	g_left_racket.x = edge_offset;
-	g_left_racket.y = 16 - 1 - (g_left_racket.h / 2);
-
-	g_right_racket.w = g_left_racket.w;
-	g_right_racket.h = g_left_racket.h;
-	g_right_racket.x = 128 - 1 - g_right_racket.w - edge_offset;
-	g_right_racket.y = 16 - 1 - (g_right_racket.h / 2);
-
-	g_ball.w = 2;
-	g_ball.h = 2;
-	g_ball.x = 64-1;
-	g_ball.y = 16-1;
-	g_ball.dx = 1;
-	g_ball.dy = -1;
+	pong_setup_params(ctx, &pong_default_params);
 }
 
-/* Brief  : Draws a pause splash screen displayed with the game is puased 
- * Author : Rasmus Kallqvist */
-void pong_pause(void)
+/* Brief  : Sets up a new pong game in ctx with the gameplay constants in
+ *          params, see struct pong_params.
+   Author : Michel Bitar and Rasmus Kallqvist */
+void pong_setup_params(struct pong_ctx *ctx, const struct pong_params *params)
 {
-	/* Draw splash over paused game state */
-	display_draw_rectfill(18,10, (18+88+2),(10+10+3), 0);
-	display_draw_rect    (18,10, (18+88+2),(10+10+3), 1);
-	display_print("game paused", 19, 12);
-	display_update();
+	uint32_t edge_offset = params->edge_offset; // distance from screen edge
+
+	/* Start of match, nothing drawn yet */
+	memset(ctx, 0, sizeof(*ctx));
+	ctx->params = *params;
+	ctx->state = match_begin;
+	ctx->redraw = 1;
+
+	/* Intialize game structs, sprites are set when drawn */
+	ctx->left_racket.w = params->racket_w;
+	ctx->left_racket.h = params->racket_h;
+	ctx->left_racket.x = FIX_FROM_INT(edge_offset);
+	ctx->left_racket.y = FIX_FROM_INT(16 - 1 - (ctx->left_racket.h / 2));
+
+	ctx->right_racket.w = ctx->left_racket.w;
+	ctx->right_racket.h = ctx->left_racket.h;
+	ctx->right_racket.x =
+		FIX_FROM_INT(128 - 1 - ctx->right_racket.w - edge_offset);
+	ctx->right_racket.y = FIX_FROM_INT(16 - 1 - (ctx->right_racket.h / 2));
+
+	ctx->ball.w = 2;
+	ctx->ball.h = 2;
+	ctx->ball.x = FIX_FROM_INT(64-1);
+	ctx->ball.y = FIX_FROM_INT(16-1);
+	ctx->ball.dx = FIX_ONE;
+	ctx->ball.dy = -FIX_ONE;
 }
 
-/* Brief  : Carries out one iteration of the pong game state with the sequence;
- * 			draw game state, read inputs, and update game state.
- * Author : Michel Bitar and Rasmus Kallqvist */
-void pong_work(void)
-{
-	static enum	game_state current_state = match_begin;
-	static int updates_waited;
-	enum game_state next_state;
-	uint16_t analog_values[2];
-	uint32_t c; // ascii values
-
-	/* Draw step */
-	display_cls();
-	switch(current_state)
-	{
-		/* Draw match begin message */
-		case(match_begin) :
-			updates_waited++;
-			/* "Get ready" for 2 seconds */
-			if(updates_waited <= 60)
-			{
-				display_print("Get ready", 28, 12);
-			}
-			/* "Playing to N" for 2 seconds */
-			if(updates_waited > 60)
-			{
-				display_print("Playing to ", 16, 12);
-				c = 0x30 + MATCH_SCORE;
-				display_print((char*)&c, 104, 12);
-			}
-			/* Reset counter after 4 seconds */
-			if(updates_waited == 120)
-				updates_waited = 0;
-			break;
-
-		/* Draw player won message */
-		case(match_end) : 
-			if(g_winning_player == player_1)
-				display_print("Player 1", 32, 8);
-				display_print("wins!", 48, 16);
-			if(g_winning_player == player_2)
-				display_print("Player 2", 32, 8);
-				display_print("wins!", 48, 16);
-			break;
-
-		/* Draw pong round */
-		default : 
-			/* Draw actors */
-			display_draw_actor(&g_left_racket);
-			display_draw_actor(&g_right_racket);
-			display_draw_actor(&g_ball);
-			/* Draw playing field */
-			display_draw_dotline(LEFT_EDGE - 1, 3);
-			display_draw_dotline(RIGHT_EDGE - 1, 3);
-			/* Draw scores */
-			c = 0x30 + g_pl1_score;
-			display_print("pl1", 0, 0);
-			display_print((char*)&c, 8, 10);
-			c  = 0x30 + g_pl2_score;
-			display_print("pl2", 128-24, 0);
-			display_print((char*)&c, 128-16, 10);
-			break;
-	}
- 	display_update();
-
-	/* Input step */
-	analog_values[0] = 1023 - input_get_analog(1);	/* Player 1 */
-	analog_values[1] = 1023 - input_get_analog(2); 	/* Player 2 */
-
-	/* Update step */
-	next_state = pong_update_step(analog_values, current_state);
-
-	/* Update state machine */
-	current_state = next_state;
-}
-
-
-/* Brief  : Carries out the update step of one pong game iteration.
+/* Brief  : Carries out the update step of one pong game iteration. Only
+ *			changes ctx, so games can be updated side by side or copied.
  * Author : Michel Bitar and Rasmus Kallqvist 
  * Note   : Next state defaults to the current state. */
-enum game_state pong_update_step(uint16_t* analog_values,
-					  enum	game_state current_state)
+void pong_update_step(struct pong_ctx *ctx, const uint16_t *analog_values)
 {
+	enum game_state current_state = ctx->state;
 	enum game_state next_state = current_state; 
-	enum player scoring_player;
-	static int updates_waited;
+	enum player scoring_player = no_player;
+
+	ctx->state_us += PONG_STEP_US;
 
   	/* Update racket positions */
-    g_left_racket.y = analog_values[0] * (32 - g_left_racket.h) / 1024;
-	g_right_racket.y = analog_values[1] * (32 - g_right_racket.h) / 1024;
+    ctx->left_racket.y =
+		FIX_FROM_INT(analog_values[0] * (32 - ctx->left_racket.h) / 1024);
+	ctx->right_racket.y =
+		FIX_FROM_INT(analog_values[1] * (32 - ctx->right_racket.h) / 1024);
 
 	/* Update game state */
 	switch(current_state)
 	{
 		/* Start of match */
 		case(match_begin):
-			updates_waited++;
-			/* Start first round after 4 seconds */
-			if(updates_waited == 120) 
+			/* Start first round after messages */
+			if(ctx->state_us >= MATCH_BEGIN_MS * 1000) 
 			{
-				updates_waited = 0; // reset counter 
 				next_state = round_begin;
 			}
 			break;
 
 		/* Start of a round */
 		case(round_begin):
-			updates_waited++;
-			/* Pause 0.5 second inbetween rounds */
-			if(updates_waited == 15)
+			/* Pause inbetween rounds */
+			if(ctx->state_us >= ROUND_BEGIN_MS * 1000)
 			{
-				updates_waited = 0; // reset counter
-				g_ball.dx = g_ball.dx / g_ball.dx; // reset speed, keep sign
+				ctx->ball.dx = FIX_SGN(ctx->ball.dx); // reset speed, keep sign
+				ctx->rally = 0;
 				next_state = round_playing;
 			}
 			break;
@@ -175,19 +108,19 @@ enum game_state pong_update_step(uint16_t* analog_values,
 		/* Round is going on */
 		case(round_playing):			
 			/* Move ball */
-			scoring_player = pong_update_ball();
+			scoring_player = pong_update_ball(ctx);
 
 			/* Check if player 1 scored */
 			if(scoring_player==player_1)
 			{
-				g_pl1_score++;
-				if(g_pl1_score==MATCH_SCORE)
+				ctx->pl1_score++;
+				if(ctx->pl1_score==MATCH_SCORE)
 				{
 					/* Player 2 won match */
-					g_winning_player = player_1;
+					ctx->winning_player = player_1;
 					/* Reset scores */
-					g_pl1_score = 0;
-					g_pl2_score = 0;
+					ctx->pl1_score = 0;
+					ctx->pl2_score = 0;
 					next_state = match_end;
 				}
 				else
@@ -198,14 +131,14 @@ enum game_state pong_update_step(uint16_t* analog_values,
 			/* Check if player 2 scored */
 			if(scoring_player==player_2)
 			{
-				g_pl2_score++;
-				if(g_pl2_score==MATCH_SCORE)
+				ctx->pl2_score++;
+				if(ctx->pl2_score==MATCH_SCORE)
 				{
 					/* Player 2 won match */
-					g_winning_player = player_2;
+					ctx->winning_player = player_2;
 					/* Reset scores */
-					g_pl1_score = 0;
-					g_pl2_score = 0;
+					ctx->pl1_score = 0;
+					ctx->pl2_score = 0;
 					next_state = match_end;
 				}
 				else
@@ -216,67 +149,121 @@ enum game_state pong_update_step(uint16_t* analog_values,
 
 		/* End of match */
 		case(match_end):
-			updates_waited++;
-			/* Display victory message for 2.5 seconds */
-			if(updates_waited == 75) 
+			/* Display victory message */
+			if(ctx->state_us >= MATCH_END_MS * 1000) 
 			{
-				updates_waited = 0; // reset
 				next_state = match_begin;
 			}
 			break;	
 		}
 
-	return next_state;
+	/* Static parts of the screen belong to the state, and new scores need a
+	   full redraw */
+	if(next_state != current_state || scoring_player != no_player)
+		ctx->redraw = 1;
+
+	/* Time in state starts over */
+	if(next_state != current_state)
+		ctx->state_us = 0;
+
+	ctx->state = next_state;
 }
 
 
 /* Brief  : Ball part of game state update step.
  *			Returns which player scored.
  * Author : Michel Bitar and Rasmus Kallqvist */
-enum player pong_update_ball(void)
+enum player pong_update_ball(struct pong_ctx *ctx)
 {
 	enum player scoring_player;
-
-	/* Collide ball with roof and floor */
-	if(g_ball.x+g_ball.w >= 127 | g_ball.x <= 1)
-		g_ball.dx = -g_ball.dx;
-	if(g_ball.y+g_ball.h >= 31 | g_ball.y <= 0)
-		g_ball.dy = -g_ball.dy;
-	
-	/* Collide ball with rackets */
-	if(actor_collision(&g_ball, &g_right_racket)
-		 || actor_collision(&g_ball, &g_left_racket))
+	struct actor *rackets[2] = {&ctx->left_racket, &ctx->right_racket};
+	int32_t rem = BALL_STEP;	/* Fraction of speed left to move */
+	int32_t mx, my;			/* Motion left */
+	int32_t t, t_hit;
+	uint8_t i, bounce, axis, hit_axis;
+	uint8_t pinned = 0;		/* Vertical bounces in a row without moving */
+	struct actor *hit;
+
+	/* Move ball, resolving the earliest collision within the motion and
+	   continuing with the rest of it after bouncing. The ball can not pass
+	   through a racket or the floor however fast it moves. */
+	for(bounce = 0; bounce < BALL_MAX_BOUNCES && rem > 0; bounce++)
 	{
-		/* Bounce back ball and increase speed */
-		g_ball.dx = -g_ball.dx * BALL_SPEEDUP;
-		/* Cap ball speed to a max value */
-		if(ABS(g_ball.dx) >= BALL_MAXSPEED)
+		mx = FIX_MUL(ctx->ball.dx, rem);
+		my = FIX_MUL(ctx->ball.dy, rem);
+		/* Ball squeezed between a racket and the roof or floor can not
+		   bounce out vertically, it slides out sideways */
+		if(pinned > 1)
+			my = 0;
+		t_hit = NO_HIT;
+		hit = 0;
+		hit_axis = 1;
+
+		/* Roof and floor */
+		if(my < 0)
+			t_hit = sweep_time(FIX_FROM_INT(FIELD_TOP) - ctx->ball.y, my);
+		if(my > 0)
+			t_hit = sweep_time(FIX_FROM_INT(FIELD_BOTTOM) -
+							   (ctx->ball.y + FIX_FROM_INT(ctx->ball.h)), my);
+		if(t_hit < 0)
+			t_hit = 0; // already outside, bounce back at once
+		if(t_hit > FIX_ONE)
+			t_hit = NO_HIT;
+
+		/* Rackets */
+		for(i = 0; i < 2; i++)
 		{
-			g_ball.dx = SGN(g_ball.dx) * BALL_MAXSPEED;
-		}		
-	}
+			t = actor_sweep(&ctx->ball, mx, my, rackets[i], &axis);
+			if(t < t_hit)
+			{
+				t_hit = t;
+				hit = rackets[i];
+				hit_axis = axis;
+			}
+		}
 
-	// developer test 
-	if(ABS(g_ball.dx) == BALL_MAXSPEED)
-		led_write(0xFF);
-	else
-		led_write(0x00);
+		/* No collision, move all the way */
+		if(t_hit == NO_HIT)
+		{
+			ctx->ball.x += mx;
+			ctx->ball.y += my;
+			break;
+		}
 
-	/* Move ball */
-	g_ball.x += g_ball.dx;
-    g_ball.y += g_ball.dy;
+		/* Move up to the collision and bounce */
+		ctx->ball.x += FIX_MUL(mx, t_hit);
+		ctx->ball.y += FIX_MUL(my, t_hit);
+		rem = FIX_MUL(rem, FIX_ONE - t_hit);
+		pinned = (t_hit == 0 && hit_axis) ? pinned + 1 : 0;
+		if(hit_axis)
+			ctx->ball.dy = -ctx->ball.dy;
+		else
+		{
+			ctx->ball.dx = -ctx->ball.dx;
+			/* Racket hit increases speed, saturating at max speed */
+			if(hit)
+			{
+				ctx->ball.dx = FIX_MUL(ctx->ball.dx,
+									   ctx->params.ball_speedup);
+				ctx->ball.dx = FIX_CLAMP(ctx->ball.dx,
+										 -ctx->params.ball_maxspeed,
+										 ctx->params.ball_maxspeed);
+				ctx->rally++;
+			}
+		}
+	}
 
     /* Check if scored */
-    if(g_ball.x > RIGHT_EDGE)
+    if(ctx->ball.x > FIX_FROM_INT(RIGHT_EDGE))
     {
-    	g_ball.x = PLAYINGFIELD_MIDDLE;
-    	g_ball.dx = -g_ball.dx;
+    	ctx->ball.x = FIX_FROM_INT(PLAYINGFIELD_MIDDLE);
+    	ctx->ball.dx = -ctx->ball.dx;
     	scoring_player = player_1;
     }
-    else if(g_ball.x < LEFT_EDGE)
+    else if(ctx->ball.x < FIX_FROM_INT(LEFT_EDGE))
     {
-    	g_ball.x = PLAYINGFIELD_MIDDLE;
-    	g_ball.dx = -g_ball.dx;
+    	ctx->ball.x = FIX_FROM_INT(PLAYINGFIELD_MIDDLE);
+    	ctx->ball.dx = -ctx->ball.dx;
     	scoring_player = player_2;
     }
     else
@@ -288,13 +275,114 @@ enum player pong_update_ball(void)
 }
 
 
-/* Brief  : Checks for actor collision using Axis Aligned Bounding Box (AABB)
- * Author : Michel Bitar */
-int actor_collision(struct actor *a, struct actor *b)
+/* Brief  : Swept AABB test, actor a moving by (mx, my) against actor b
+ *			standing still. Returns the fraction of the motion in Q16.16 at
+ *			which they first touch, or NO_HIT if they do not within the
+ *			motion. Axis is set to 0 if a hits a left or right face of b, and
+ *			1 for a top or bottom face. Actors that already overlap collide
+ *			at once, unless a is on its way out.
+ * Author : Rasmus Kallqvist */
+int32_t actor_sweep(struct actor *a, int32_t mx, int32_t my,
+					struct actor *b, uint8_t *axis)
+{
+	int32_t aw = FIX_FROM_INT(a->w), ah = FIX_FROM_INT(a->h);
+	int32_t bw = FIX_FROM_INT(b->w), bh = FIX_FROM_INT(b->h);
+	int32_t entry_x, exit_x, entry_y, exit_y;
+	int32_t entry, exit;
+
+	/* Rule out b if it is outside the box swept by a */
+	if(a->x + (mx < 0 ? mx : 0) >= b->x + bw ||
+	   a->x + aw + (mx > 0 ? mx : 0) <= b->x ||
+	   a->y + (my < 0 ? my : 0) >= b->y + bh ||
+	   a->y + ah + (my > 0 ? my : 0) <= b->y)
+		return NO_HIT;
+
+	/* Times a overlaps b along each axis */
+	if(!actor_sweep_axis(a->x, aw, mx, b->x, bw, &entry_x, &exit_x) ||
+	   !actor_sweep_axis(a->y, ah, my, b->y, bh, &entry_y, &exit_y))
+		return NO_HIT;
+
+	/* Overlapping on both axes at once */
+	entry = entry_x > entry_y ? entry_x : entry_y;
+	exit = exit_x < exit_y ? exit_x : exit_y;
+	if(entry >= exit || entry > FIX_ONE || exit <= 0)
+		return NO_HIT;
+
+	*axis = entry_x < entry_y;
+	if(entry >= 0)
+		return entry;
+
+	/* Already overlapping, collide only if a moves further into b */
+	if(*axis == 0 && (mx > 0) != (2 * a->x + aw < 2 * b->x + bw))
+		return NO_HIT;
+	if(*axis == 1 && (my > 0) != (2 * a->y + ah < 2 * b->y + bh))
+		return NO_HIT;
+	return 0;
+}
+
+
+/* Brief  : Finds the times, as fractions of the motion m in Q16.16, at which
+ *			a span at p of length size starts and stops overlapping the
+ *			span at q of length q_size along one axis. Returns zero if they
+ *			never overlap.
+ * Author : Rasmus Kallqvist */
+uint8_t actor_sweep_axis(int32_t p, int32_t size, int32_t m,
+						 int32_t q, int32_t q_size,
+						 int32_t *entry, int32_t *exit)
 {
-	if ( (a->x + a->dx) < (b->x + b->w) && (a->x + a->w + a->dx) > (b->x) &&
-		 (a->y + a->dy) < (b->y + b->h) && (a->y + a->h + a->dy) > (b->y) )
+	/* Not moving, overlapping all the time or never */
+	if(m == 0)
+	{
+		if(p + size <= q || p >= q + q_size)
+			return 0;
+		*entry = INT32_MIN;
+		*exit = INT32_MAX;
 		return 1;
+	}
+
+	if(m > 0)
+	{
+		*entry = sweep_time(q - (p + size), m);
+		*exit = sweep_time(q + q_size - p, m);
+	}
 	else
-		return 0;
+	{
+		*entry = sweep_time(q + q_size - p, m);
+		*exit = sweep_time(q - (p + size), m);
+	}
+	return 1;
+}
+
+
+/* Brief  : Returns the fraction in Q16.16 of the motion m needed to cover
+ *			dist, saturated to the int32_t range. Rounds towards zero, like
+ *			dist * FIX_ONE / m in 64 bits, but the target has no 64 bit
+ *			divide, so the whole part is a 32 bit divide and the fraction is
+ *			worked out a bit at a time. Motions must be under 2^30.
+ * Author : Rasmus Kallqvist */
+int32_t sweep_time(int32_t dist, int32_t m)
+{
+	uint32_t d = dist < 0 ? -(uint32_t) dist : (uint32_t) dist;
+	uint32_t n = m < 0 ? -(uint32_t) m : (uint32_t) m;
+	uint32_t q = d / n;
+	uint32_t r = d % n;
+	uint8_t neg = (dist < 0) != (m < 0);
+	uint8_t i;
+
+	/* Whole part too big for Q16.16 */
+	if(q >= 0x1 << (31 - FIX_SHIFT))
+		return neg ? INT32_MIN : INT32_MAX;
+
+	/* Long division of the remainder, one fraction bit at a time */
+	for(i = 0; i < FIX_SHIFT; i++)
+	{
+		r <<= 1;
+		q <<= 1;
+		if(r >= n)
+		{
+			r -= n;
+			q |= 0x1;
+		}
+	}
+	return neg ? -(int32_t) q : (int32_t) q;
 }
@@ -2,41 +2,110 @@
 ********************************************************************************
 * name   :  pong.h
 * author :  Rasmus Kallqvist / Michel Bitar, 2017
-* brief  :  Header for pong.c
+* brief  :  Header for pong.c and pong_draw.c. Only the drawing half uses
+*           the hardware, so pong.c also builds for host tools.
 ********************************************************************************
 */
 
+#ifndef PONG_H
+#define PONG_H
+
 /* Includes ------------------------------------------------------------------*/
-#include <pic32mx.h>	/* Declarations of hardware-specific addresses etc */
 #include <stdint.h>  	/* Declarations of uint_32 and the like */
-#include "display.h"  	/* OLED display device drivers and draw functions */
-#include "input.h"		/* Read potentiometer and buttons values */
+#include <string.h>		/* memset */
 #include "structs.h"	/* Contains definitions for actor struct */
+#include "fixed.h"		/* Q16.16 fixed point arithmetic */
 
 /* Defines -------------------------------------------------------------------*/
 #define		MATCH_SCORE			5
+/* Game time */
+#define		PONG_UPDATE_HZ		120	/* Fixed rate of pong_step() */
+#define		PONG_STEP_US		(1000000 / PONG_UPDATE_HZ)
+#define		PONG_SPEED_HZ		30	/* Speeds are pixels per 1/30 s */
+#define		BALL_STEP			FIX_CONST((double)PONG_SPEED_HZ / PONG_UPDATE_HZ)
+#define		MATCH_BEGIN_MS		4000
+#define		MATCH_READY_MS		2000 /* "Get ready" part of match begin */
+#define		ROUND_BEGIN_MS		500
+#define		MATCH_END_MS		2500
+#define 	FIELD_WIDTH			128	/* Same as DISPLAY_WIDTH */
 #define 	PLAYINGFIELD_W		64
-#define 	LEFT_EDGE			(DISPLAY_WIDTH - PLAYINGFIELD_W) / 2
-#define 	RIGHT_EDGE			DISPLAY_WIDTH - PLAYINGFIELD_W / 2
-#define		PLAYINGFIELD_MIDDLE DISPLAY_WIDTH / 2 - 1
-#define 	BALL_SPEEDUP		1.1
-#define 	BALL_MAXSPEED		4
-/* Macro */
-#define 	ABS(x)				(x*x)/x
-#define 	SGN(x)				ABS(x)/x
+#define 	LEFT_EDGE			(FIELD_WIDTH - PLAYINGFIELD_W) / 2
+#define 	RIGHT_EDGE			FIELD_WIDTH - PLAYINGFIELD_W / 2
+#define		PLAYINGFIELD_MIDDLE FIELD_WIDTH / 2 - 1
+/* Default tuning, see struct pong_params */
+#define 	BALL_SPEEDUP		FIX_CONST(1.1)
+#define 	BALL_MAXSPEED		FIX_FROM_INT(4)
+#define 	RACKET_W			3
+#define 	RACKET_H			12
+#define 	RACKET_EDGE_OFFSET	34	/* Distance from screen edge */
+#define 	BALL_MAX_BOUNCES	4	/* Collisions resolved per update */
+#define 	FIELD_TOP			0	/* Rows the ball bounces between */
+#define 	FIELD_BOTTOM		31
+#define 	NO_HIT				INT32_MAX /* Time of impact when none */
 	
 /* Enums ---------------------------------------------------------------------*/
 enum game_state {match_begin, round_begin, round_playing, match_end};
 enum player	    {no_player, player_1, player_2};
 
+/* Structs -------------------------------------------------------------------*/
+/* Brief  : Gameplay constants of one game. The firmware plays with
+ *          pong_default_params, tools/pongsim.c sweeps them.
+ *          Rackets are at most 8 pixels wide, and both rackets have to fit
+ *          on screen.
+ * Author : Rasmus Kallqvist */
+struct pong_params
+{
+	int32_t ball_speedup;		/* Q16.16 factor applied on racket hits */
+	int32_t ball_maxspeed;		/* Q16.16 limit of horizontal speed */
+	uint8_t racket_w;
+	uint8_t racket_h;
+	uint8_t edge_offset;		/* Racket distance from screen edge */
+};
+
+/* Brief  : Complete state of one pong game. All pong functions work on a
+ *          context passed to them, so several games can run side by side and
+ *          a game can be saved by copying its context.
+ * Author : Rasmus Kallqvist */
+struct pong_ctx
+{
+	struct pong_params params;
+	struct actor ball;
+	struct actor left_racket;
+	struct actor right_racket;
+	int pl1_score;				/* Player 1 score tracker */
+	int pl2_score;				/* Player 2 score tracker */
+	enum player winning_player;
+	enum game_state state;
+	uint32_t state_us;			/* Game time spent in current state */
+	uint16_t rally;				/* Racket hits in current round */
+	/* Rendering */
+	uint8_t redraw;				/* Static parts of screen have changed */
+	uint8_t round_drawn[2];		/* Screen buffer holds a round frame */
+};
+
+/* Declarations --------------------------------------------------------------*/
+struct pong_ai;					/* Computer player, see ai.h */
+
+/* Variables -----------------------------------------------------------------*/
+extern const struct pong_params pong_default_params;
+
 /* Function prototypes -------------------------------------------------------*/
-/* Pong game */
-void pong_setup(void);
-void pong_pause(void);
-void pong_work(void); 
-void pong_draw_step(enum game_state current_state);
-enum game_state pong_update_step(uint16_t* analog_values,
-					  enum	game_state current_state);
-enum player pong_update_ball(void);
-int actor_collision(struct actor *a, struct actor *b);
+/* Pong game, pong_draw.c */
+void pong_pause(struct pong_ctx *ctx);
+void pong_work(struct pong_ctx *ctx, struct pong_ai *ai);
+void pong_draw(struct pong_ctx *ctx);
+void pong_step(struct pong_ctx *ctx, struct pong_ai *ai);
+void pong_draw_background(struct pong_ctx *ctx);
+/* Game rules, pong.c */
+void pong_setup(struct pong_ctx *ctx);
+void pong_setup_params(struct pong_ctx *ctx, const struct pong_params *params);
+void pong_update_step(struct pong_ctx *ctx, const uint16_t *analog_values);
+enum player pong_update_ball(struct pong_ctx *ctx);
+int32_t actor_sweep(struct actor *a, int32_t mx, int32_t my,
+					struct actor *b, uint8_t *axis);
+uint8_t actor_sweep_axis(int32_t p, int32_t size, int32_t m,
+						 int32_t q, int32_t q_size,
+						 int32_t *entry, int32_t *exit);
+int32_t sweep_time(int32_t dist, int32_t m);
 
+#endif /* PONG_H */
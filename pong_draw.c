@@ -0,0 +1,247 @@
+/*
+********************************************************************************
+* name   :  pong_draw.c
+* author :  Rasmus Kallqvist / Michel Bitar, 2017
+* brief  :  Board side of the pong game. Reads the potentiometers, draws the
+*           game state and sends it to the display. Game rules are in pong.c.
+********************************************************************************
+*/
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"	/* Display, inputs, LEDs and pong.h */
+
+/* Local variables -----------------------------------------------------------*/
+/* Sprites, shared by all games */
+static struct	sprite g_racket_sprite;
+static struct	sprite g_ball_sprite;
+static uint8_t	g_racket_bitmap[4*8]; 	/* Up to 8 columns, full height */
+static uint8_t	g_ball_bitmap[4*8];
+
+/* Local function prototypes -------------------------------------------------*/
+#ifdef GAME_STATS
+static void pong_draw_stats(void);
+static char *pong_stat_text(char *s, const char *label, uint32_t n);
+#endif
+
+/* Function definitions ------------------------------------------------------*/
+/* Brief  : Draws a pause splash screen displayed with the game is puased 
+ * Author : Rasmus Kallqvist */
+void pong_pause(struct pong_ctx *ctx)
+{
+	/* Draw splash over paused game state */
+	ctx->round_drawn[0] = ctx->round_drawn[1] = 0;
+	display_copy_front();
+	display_draw_rectfill(18,10, (18+88+2),(10+10+3), 0);
+	display_draw_rect    (18,10, (18+88+2),(10+10+3), 1);
+	display_print("game paused", 19, 12);
+#ifdef GAME_STATS
+	pong_draw_stats();
+#endif
+	display_update();
+}
+
+#ifdef GAME_STATS
+/* Brief  : Draws the game loop statistics of the last second played above
+ *			and below the pause splash, interrupts per second and the
+ *			least core timer interrupt entry in cycles on top, "-" if none
+ *			ran, frames dropped and idle time at the bottom
+ * Author : Rasmus Kallqvist */
+static void pong_draw_stats(void)
+{
+	const char *none = " lat -";
+	char line[24];
+	char *s;
+
+	s = pong_stat_text(line, "irq ", game_interrupt_rate());
+	if(game_isr_latency() != SCHED_NO_LATENCY)
+		s = pong_stat_text(s, " lat ", game_isr_latency());
+	else
+		while(*none)
+			*s++ = *none++;
+	*s = 0;
+	display_draw_rectfill(0, 0, DISPLAY_WIDTH, 8, 0);
+	display_print(line, 0, 0);
+
+	s = pong_stat_text(line, "drop ", game_frames_dropped());
+	s = pong_stat_text(s, " idle ", game_idle_percent());
+	*s++ = '%';
+	*s = 0;
+	display_draw_rectfill(0, 24, DISPLAY_WIDTH, DISPLAY_HEIGHT, 0);
+	display_print(line, 0, 24);
+}
+
+/* Brief  : Writes label and then n in decimal at s, and returns the end of
+ *			what was written
+ * Author : Rasmus Kallqvist */
+static char *pong_stat_text(char *s, const char *label, uint32_t n)
+{
+	char digits[10];
+	uint8_t i = 0;
+
+	while(*label)
+		*s++ = *label++;
+	do
+	{
+		digits[i++] = '0' + n % 10;
+		n /= 10;
+	} while(n);
+	while(i)
+		*s++ = digits[--i];
+	return s;
+}
+#endif
+
+/* Brief  : Carries out one iteration of the pong game state with the sequence;
+ * 			draw game state, read inputs, and update game state. For running
+ *			drawing and updates in lockstep, see pong_draw() and pong_step()
+ *			for running them at different rates.
+ * Author : Michel Bitar and Rasmus Kallqvist */
+void pong_work(struct pong_ctx *ctx, struct pong_ai *ai)
+{
+	pong_draw(ctx);
+	pong_step(ctx, ai);
+}
+
+/* Brief  : Draws the current game state and starts sending it to the display.
+ *			The display must not be busy with the previous frame.
+ * Author : Michel Bitar and Rasmus Kallqvist */
+void pong_draw(struct pong_ctx *ctx)
+{
+	enum game_state current_state = ctx->state;
+	uint32_t c; // ascii values
+	uint8_t back = display_get_back();
+
+	/* Static parts of the screen change with state and scores */
+	if(ctx->redraw)
+	{
+		/* Actors are drawn as solid block sprites */
+		display_make_block(&g_racket_sprite, g_racket_bitmap,
+						   ctx->left_racket.w, ctx->left_racket.h);
+		display_make_block(&g_ball_sprite, g_ball_bitmap,
+						   ctx->ball.w, ctx->ball.h);
+		ctx->left_racket.sprite = &g_racket_sprite;
+		ctx->right_racket.sprite = &g_racket_sprite;
+		ctx->ball.sprite = &g_ball_sprite;
+
+		display_layer_invalidate();
+		ctx->round_drawn[0] = ctx->round_drawn[1] = 0;
+		ctx->redraw = 0;
+	}
+
+	// developer test 
+	if(FIX_ABS(ctx->ball.dx) == ctx->params.ball_maxspeed)
+		led_write(0xFF);
+	else
+		led_write(0x00);
+
+	/* Draw step, previous frame may still be sending from front buffer.
+	   During a round only the actors move, so if the back buffer holds a
+	   round frame they are erased where they were drawn into it. Otherwise
+	   the frame starts from the static parts of the current state. */
+	if(current_state == round_playing && ctx->round_drawn[back] &&
+	   display_layer_valid())
+	{
+		display_erase_actor(&ctx->left_racket);
+		display_erase_actor(&ctx->right_racket);
+		display_erase_actor(&ctx->ball);
+	}
+	else
+	{
+		if(!display_layer_valid())
+			pong_draw_background(ctx);
+		display_restore_layer();
+	}
+	ctx->round_drawn[back] = current_state == round_playing;
+
+	switch(current_state)
+	{
+		/* Draw match begin message */
+		case(match_begin) :
+			/* "Get ready" at first */
+			if(ctx->state_us < MATCH_READY_MS * 1000)
+			{
+				display_print("Get ready", 28, 12);
+			}
+			/* "Playing to N" for the rest of the state */
+			else
+			{
+				display_print("Playing to ", 16, 12);
+				c = 0x30 + MATCH_SCORE;
+				display_print((char*)&c, 104, 12);
+			}
+			break;
+
+		/* Player won message is in background */
+		case(match_end) : 
+			break;
+
+		/* Draw pong round */
+		default : 
+			/* Draw actors */
+			display_draw_actor(&ctx->left_racket);
+			display_draw_actor(&ctx->right_racket);
+			display_draw_actor(&ctx->ball);
+			/* Draw scores */
+			c = 0x30 + ctx->pl1_score;
+			display_print((char*)&c, 8, 10);
+			c  = 0x30 + ctx->pl2_score;
+			display_print((char*)&c, 128-16, 10);
+			break;
+	}
+ 	display_flush_begin(); // frame is sent while the update step runs
+}
+
+/* Brief  : Reads inputs and advances the game state by one fixed time step
+ *			of PONG_STEP_US. Player 2 is the computer player ai unless it
+ *			is null.
+ * Author : Michel Bitar and Rasmus Kallqvist */
+void pong_step(struct pong_ctx *ctx, struct pong_ai *ai)
+{
+	uint16_t analog_values[2];
+	uint16_t scan[ADC_SCAN_COUNT];
+
+	/* Input step, both potentiometers from the same ADC scan */
+	input_get_analogs(scan);
+	analog_values[0] = 1023 - scan[1];				/* Player 1 */
+	if(ai)
+		analog_values[1] = ai_work(ai, ctx);		/* Computer player 2 */
+	else
+		analog_values[1] = 1023 - scan[2]; 			/* Player 2 */
+
+	/* Update step and state machine */
+	pong_update_step(ctx, analog_values);
+}
+
+
+/* Brief  : Draws the parts of the screen that stay the same during the
+ *			current state to the background layer. Called when the layer is
+ *			invalidated, which happens on each state change.
+ * Author : Rasmus Kallqvist */
+void pong_draw_background(struct pong_ctx *ctx)
+{
+	display_layer_begin();
+	switch(ctx->state)
+	{
+		/* Match begin messages change during the state, nothing static */
+		case(match_begin) :
+			break;
+
+		/* Draw player won message */
+		case(match_end) : 
+			if(ctx->winning_player == player_1)
+				display_print("Player 1", 32, 8);
+			if(ctx->winning_player == player_2)
+				display_print("Player 2", 32, 8);
+			display_print("wins!", 48, 16);
+			break;
+
+		/* Draw playing field and score labels */
+		default : 
+			display_draw_dotline(LEFT_EDGE - 1, 3);
+			display_draw_dotline(RIGHT_EDGE - 1, 3);
+			display_print("pl1", 0, 0);
+			display_print("pl2", 128-24, 0);
+			break;
+	}
+	display_layer_end();
+}
@@ -0,0 +1,177 @@
+/*
+********************************************************************************
+* name   :  schedule.c
+* author :  Rasmus Kallqvist, 2017
+* brief  :  Tickless timer scheduler. Deadlines are kept in a list sorted by
+*           time and the core timer compare interrupt is set for the first
+*           one, so interrupts only happen when something is due.
+********************************************************************************
+*/
+
+/* Includes ------------------------------------------------------------------*/
+#include "schedule.h"
+
+/* Local variables -----------------------------------------------------------*/
+static struct sched_timer *sched_head;		/* Queued timers, soonest first */
+static volatile uint32_t sched_count;		/* Core timer interrupts so far */
+static uint32_t sched_compare;				/* Count the interrupt is set for */
+static uint32_t sched_latency = SCHED_NO_LATENCY;	/* Least ticks from compare match
+											   to sched_isr(), see below */
+
+/* Function definitions ------------------------------------------------------*/
+/* Brief  : Sets up the core timer interrupt. Timers can be added before
+ *          interrupts are enabled.
+ * Author : Rasmus Kallqvist */
+void init_sched(void)
+{
+	sched_head = 0;
+
+	IPCCLR(0) = 0x1F;			// clear core timer priorities
+	IPCSET(0) = 0x7 << 2;		// set interrupt priority to 7, shadow set
+	IFSCLR(0) = 0x1;			// clear core timer interrupt flag
+	IECSET(0) = 0x1;			// core timer interrupt enable
+}
+
+/* Brief  : Returns the core timer count, SCHED_TICKS_PER_US per us. Wraps
+ *          around after about 107 s, so only compare differences.
+ * Author : Rasmus Kallqvist */
+uint32_t sched_now(void)
+{
+	return core_timer_read();
+}
+
+/* Brief  : Links timer into the list by deadline, after timers with the
+ *          same deadline. Interrupts must be disabled.
+ * Author : Rasmus Kallqvist */
+void sched_insert(struct sched_timer *timer)
+{
+	struct sched_timer **link = &sched_head;
+
+	while(*link && (int32_t)((*link)->deadline - timer->deadline) <= 0)
+		link = &(*link)->next;
+	timer->next = *link;
+	*link = timer;
+	timer->queued = 1;
+}
+
+/* Brief  : Unlinks timer from the list if it is queued. Interrupts must be
+ *          disabled.
+ * Author : Rasmus Kallqvist */
+void sched_remove(struct sched_timer *timer)
+{
+	struct sched_timer **link = &sched_head;
+
+	if(!timer->queued)
+		return;
+	while(*link != timer)
+		link = &(*link)->next;
+	*link = timer->next;
+	timer->queued = 0;
+}
+
+/* Brief  : Runs timer->run delay ticks from now, and then every period
+ *          ticks unless period is 0. A queued timer is moved. Can be called
+ *          from timer callbacks.
+ * Author : Rasmus Kallqvist */
+void sched_add(struct sched_timer *timer, uint32_t delay, uint32_t period)
+{
+	uint32_t status = disable_interrupt();
+
+	sched_remove(timer);
+	timer->deadline = core_timer_read() + delay;
+	timer->period = period;
+	sched_insert(timer);
+
+	/* New first deadline, move the compare interrupt. If it is due already
+	   the interrupt is raised by hand, the count may have passed it. */
+	if(sched_head == timer)
+	{
+		sched_compare = timer->deadline;
+		core_timer_compare(sched_compare);
+		if((int32_t)(timer->deadline - core_timer_read()) < SCHED_MARGIN)
+			IFSSET(0) = 0x1;
+	}
+	restore_interrupt(status);
+}
+
+/* Brief  : Stops timer, it is not run again until added
+ * Author : Rasmus Kallqvist */
+void sched_cancel(struct sched_timer *timer)
+{
+	uint32_t status = disable_interrupt();
+
+	sched_remove(timer);
+	restore_interrupt(status);
+}
+
+/* Brief  : Runs the timers that are due and sets the compare interrupt for
+ *          the next one. Called from the interrupt handler when the core
+ *          timer interrupt flag is set. Periodic timers keep their phase,
+ *          but runs that were missed completely are skipped.
+ * Author : Rasmus Kallqvist */
+void sched_isr(void)
+{
+	struct sched_timer *timer;
+	uint32_t now = core_timer_read();
+
+	/* Interrupt entry time, from the count reaching compare to here. The
+	   least seen is the entry path itself, more means interrupts were
+	   disabled or the interrupt was raised by sched_add(). */
+	if(now - sched_compare < sched_latency)
+		sched_latency = now - sched_compare;
+
+	sched_count++;
+	IFSCLR(0) = 0x1; // reset interrupt flag
+
+	while(sched_head)
+	{
+		/* Run everything due, or due too soon to wait for */
+		now = core_timer_read();
+		while(sched_head && (int32_t)(sched_head->deadline - now) < SCHED_MARGIN)
+		{
+			timer = sched_head;
+			sched_head = timer->next;
+			timer->queued = 0;
+			if(timer->period)
+			{
+				timer->deadline += timer->period;
+				if((int32_t)(timer->deadline - now) < 0)
+					timer->deadline = now + timer->period;
+				sched_insert(timer);
+			}
+			timer->run(timer);
+		}
+
+		/* Wait for the next one, unless the count got there meanwhile */
+		if(sched_head)
+		{
+			sched_compare = sched_head->deadline;
+			core_timer_compare(sched_compare);
+			IFSCLR(0) = 0x1;
+			if((int32_t)(sched_head->deadline - core_timer_read()) >= SCHED_MARGIN)
+				break;
+		}
+	}
+}
+
+/* Brief  : Returns the number of core timer interrupts so far
+ * Author : Rasmus Kallqvist */
+uint32_t sched_interrupts(void)
+{
+	return sched_count;
+}
+
+/* Brief  : Returns the least core timer ticks from a compare match to the
+ *          start of sched_isr() since the last call, twice that in CPU
+ *          cycles. Measures the interrupt entry path. Returns
+ *          SCHED_NO_LATENCY if no core timer interrupt ran.
+ * Author : Rasmus Kallqvist */
+uint32_t sched_entry_latency(void)
+{
+	uint32_t status = disable_interrupt();
+	uint32_t latency = sched_latency;
+
+	sched_latency = SCHED_NO_LATENCY;
+	restore_interrupt(status);
+	return latency;
+}
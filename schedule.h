@@ -0,0 +1,51 @@
+/*
+********************************************************************************
+* name   :  schedule.h
+* author :  Rasmus Kallqvist, 2017
+* brief  :  Header for schedule.c
+********************************************************************************
+*/
+
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <pic32mx.h>	/* Declarations of hardware-specific addresses etc */
+#include <stdint.h>  	/* Declarations of uint_32 and the like */
+#include "isr.h"		/* Interrupt control */
+
+/* Defines -------------------------------------------------------------------*/
+#define		SCHED_TICKS_PER_US	40	/* Core timer runs at half of 80 MHz */
+#define		SCHED_US(us)		((uint32_t)(us) * SCHED_TICKS_PER_US)
+#define		SCHED_MARGIN		((int32_t)SCHED_US(2))	/* Run timers due this soon now */
+#define		SCHED_NO_LATENCY	0xFFFFFFFF	/* No interrupt to measure, see
+											   sched_entry_latency() */
+
+/* Structs -------------------------------------------------------------------*/
+/* Brief  : A deadline in the scheduler. Owned by the caller and linked into
+ *          the scheduler's list while queued, so it must stay allocated.
+ * Author : Rasmus Kallqvist */
+struct sched_timer
+{
+	struct sched_timer *next;	/* Timer with the next later deadline */
+	uint32_t deadline;			/* Core timer count to run at */
+	uint32_t period;			/* Ticks between runs, 0 runs once */
+	void (*run)(struct sched_timer *timer);	/* Called from the interrupt */
+	uint8_t queued;
+};
+
+/* Function prototypes -------------------------------------------------------*/
+void init_sched(void);
+uint32_t sched_now(void);
+void sched_insert(struct sched_timer *timer);
+void sched_remove(struct sched_timer *timer);
+void sched_add(struct sched_timer *timer, uint32_t delay, uint32_t period);
+void sched_cancel(struct sched_timer *timer);
+void sched_isr(void);
+uint32_t sched_interrupts(void);
+uint32_t sched_entry_latency(void);
+/* Core timer, init.S */
+uint32_t core_timer_read(void);
+void core_timer_compare(uint32_t count);
+
+#endif /* SCHEDULE_H */
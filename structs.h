@@ -9,17 +9,45 @@
 #ifndef STRUCTS_H
 #define	STRUCTS_H
 
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
 /* Structs -------------------------------------------------------------------*/
-/* Brief  : Struct for all moving objects
+/* Brief  : Bitmap drawn with display_draw_sprite(). Columns are packed into
+ *          pages like the display, (h + 7) / 8 pages of w bytes each, with
+ *          bit 0 as the top row. Bits below row h must be zero. The optional
+ *          mask has the same layout, pixels set in it are cleared before
+ *          data is drawn, without a mask zero bits are transparent.
+ * Author : Rasmus Kallqvist */
+struct sprite
+{
+    uint8_t w;
+    uint8_t h;
+    const uint8_t *data;
+    const uint8_t *mask;
+};
+
+/* Brief  : Screen rectangle from (x0, y0) up to but not including (x1, y1)
+ * Author : Rasmus Kallqvist */
+struct rect
+{
+    int16_t x0, y0;
+    int16_t x1, y1;
+};
+
+/* Brief  : Struct for all moving objects. Position and speed are in Q16.16
+ *          fixed point pixels, see fixed.h, size is in whole pixels.
  * Author : Michel Bitar */
 struct actor
 {
-    float x;
-    float y;
+    int32_t x;
+    int32_t y;
     int w;
     int h;
-    float dx;
-    float dy;
-}	actor;
+    int32_t dx;
+    int32_t dy;
+    const struct sprite *sprite;    /* Drawn as filled rectangle if null */
+    struct rect drawn[2];           /* Last drawn in each screen buffer  */
+};
 
 #endif /* STRUCTS_H */
\ No newline at end of file
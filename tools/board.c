@@ -0,0 +1,402 @@
+/*
+********************************************************************************
+* name   :  board.c
+* author :  Rasmus Kallqvist, 2017
+* brief  :  Host model of the registers the firmware uses on the chipkit
+*           uno32 and of the SSD1306 display controller on the basic i/o
+*           shield, for the host tests in tools/. The display model decodes
+*           every byte sent over spi2 with the D/C pin level it is sampled
+*           at, keeps the controller's graphic ram and ram pointer, and
+*           counts what was sent.
+*
+*           Register writes go through pointers handed out by
+*           tools/pic32mx.h, so each write is taken in at the next register
+*           access, or at board_sync(). A spi2 byte is decoded then too, so
+*           toggling D/C before the previous byte was waited for shows up
+*           as a wrongly decoded byte, like on the hardware.
+********************************************************************************
+*/
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "board.h"
+
+/* Defines -------------------------------------------------------------------*/
+#define SPI_EMPTY           0x1000  /* No byte written to the spi2 buffer */
+#define PIN_DC              0x10    /* PORTF, high for data               */
+#define PIN_VBAT            0x20    /* PORTF, low to power                */
+#define PIN_VDD             0x40    /* PORTF, low to power                */
+#define PIN_RESET           0x200   /* PORTG, low to reset                */
+
+/* Variables -----------------------------------------------------------------*/
+volatile unsigned int board_regs[BOARD_REGS];
+struct oled oled;
+uint32_t board_time;
+
+/* Local variables -----------------------------------------------------------*/
+static volatile unsigned int op_latch;          /* Pending CLR/SET/INV */
+static int op_reg = -1;
+static int op_kind;
+static volatile unsigned int spi_latch = SPI_EMPTY;
+static volatile unsigned int spi_stat;
+static uint32_t pins_f;                         /* PORTF at last write */
+/* Command being decoded */
+static uint8_t cmd;
+static uint8_t cmd_args[8];
+static uint8_t cmd_argc;
+static uint8_t cmd_left;
+static int failures;                            /* Failed checks       */
+
+/* Drawing of display.c, there in the tests that include it. Weak, so the
+   tests of other modules link without it. */
+#pragma weak display_cls
+#pragma weak display_copy_front
+#pragma weak display_draw_rectfill
+#pragma weak display_draw_logo
+#pragma weak display_print
+void display_cls(void);
+void display_copy_front(void);
+void display_draw_rectfill(int x0, int y0, int x1, int y1, uint8_t col);
+void display_draw_logo(int x0, int y0);
+void display_print(char *s, int x, int y);
+
+/* Local function prototypes -------------------------------------------------*/
+static void board_pins(void);
+static void oled_command(uint8_t byte);
+static void oled_data(uint8_t byte);
+
+/* Function definitions ------------------------------------------------------*/
+/* Brief  : Puts the registers and the display controller in their power on
+ *          state, with the display unpowered and the board time at 0.
+ * Author : Rasmus Kallqvist */
+void board_reset(void)
+{
+    memset((void *) board_regs, 0, sizeof(board_regs));
+    memset(&oled, 0, sizeof(oled));
+    board_regs[BOARD_PORTF] = PIN_VDD | PIN_VBAT;
+    board_regs[BOARD_PORTG] = PIN_RESET;
+    oled.mode = 2;
+    oled.col_end = OLED_COLS - 1;
+    oled.page_end = OLED_PAGES - 1;
+    oled.contrast = 0x7F;
+    pins_f = PIN_VDD | PIN_VBAT;
+    op_reg = -1;
+    spi_latch = SPI_EMPTY;
+    cmd_left = 0;
+    board_time = 0;
+}
+
+
+/* Brief  : Takes in the last register write, if not done yet. Call before
+ *          looking at board_regs or the display model.
+ * Author : Rasmus Kallqvist */
+void board_sync(void)
+{
+    unsigned int byte;
+
+    if(op_reg >= 0)
+    {
+        if(op_kind == BOARD_CLR)
+            board_regs[op_reg] &= ~op_latch;
+        else if(op_kind == BOARD_SET)
+            board_regs[op_reg] |= op_latch;
+        else
+            board_regs[op_reg] ^= op_latch;
+        op_reg = -1;
+        board_pins();
+    }
+
+    if(spi_latch != SPI_EMPTY)
+    {
+        byte = spi_latch & 0xFF;
+        spi_latch = SPI_EMPTY;
+        if(!oled.vdd || oled.reset)
+            oled.unpowered_bytes++;
+        else if(board_regs[BOARD_PORTF] & PIN_DC)
+            oled_data(byte);
+        else
+            oled_command(byte);
+    }
+}
+
+
+/* Brief  : Returns register reg, for plain reads and writes
+ * Author : Rasmus Kallqvist */
+volatile unsigned int *board_reg(int reg)
+{
+    board_sync();
+    return &board_regs[reg];
+}
+
+
+/* Brief  : Returns where to write the bits to clear, set or invert in reg
+ * Author : Rasmus Kallqvist */
+volatile unsigned int *board_reg_op(int reg, int op)
+{
+    board_sync();
+    op_reg = reg;
+    op_kind = op;
+    op_latch = 0;
+    return &op_latch;
+}
+
+
+/* Brief  : Returns the spi2 buffer. A byte written to it is sent to the
+ *          display, reads give 0.
+ * Author : Rasmus Kallqvist */
+volatile unsigned int *board_spi_buf(void)
+{
+    board_sync();
+    spi_latch = SPI_EMPTY;
+    return &spi_latch;
+}
+
+
+/* Brief  : Returns the spi2 status, which always reads transmit buffer
+ *          empty and receive buffer full. Bytes are sent instantly.
+ * Author : Rasmus Kallqvist */
+volatile unsigned int *board_spi_stat(void)
+{
+    board_sync();
+    spi_stat = 0x09;
+    return &spi_stat;
+}
+
+
+/* Brief  : Returns pixel (x, y) of the display graphic ram, as shown on the
+ *          128x32 panel.
+ * Author : Rasmus Kallqvist */
+uint8_t oled_pixel(int x, int y)
+{
+    return (oled.ram[y >> 3][x] >> (y & 0x7)) & 0x1;
+}
+
+
+/* Brief  : Returns a hash of the graphic ram shown on the 128x32 panel
+ * Author : Rasmus Kallqvist */
+uint32_t oled_hash(void)
+{
+    uint32_t h = 2166136261u;
+    int page, col;
+
+    board_sync();
+    for(page = 0; page < 4; page++)
+        for(col = 0; col < OLED_COLS; col++)
+            h = (h ^ oled.ram[page][col]) * 16777619u;
+    return h;
+}
+
+
+/* Brief  : Returns non-zero if the shown pages of graphic ram equal front,
+ *          the front buffer of display.c
+ * Author : Rasmus Kallqvist */
+int board_ram_matches(uint8_t (*front)[OLED_COLS])
+{
+    int page;
+
+    board_sync();
+    for(page = 0; page < 4; page++)
+        if(memcmp(oled.ram[page], front[page], OLED_COLS))
+            return 0;
+    return 1;
+}
+
+
+/* Brief  : Draws a random frame with display.c, the same mix of clears,
+ *          rectangles, sprites and text the game draws. With on_front, one
+ *          frame in five is drawn on top of the last one instead of on a
+ *          cleared back buffer, which waits for the flush.
+ * Author : Rasmus Kallqvist */
+void board_random_frame(int on_front)
+{
+    int i, x, y;
+
+    if(on_front && rand() % 5 == 0)
+        display_copy_front();
+    else
+        display_cls();
+    for(i = rand() % 4; i > 0; i--)
+    {
+        x = rand() % 140 - 6;
+        y = rand() % 40 - 4;
+        display_draw_rectfill(x, y, x + rand() % 20, y + rand() % 20,
+                              rand() % 2);
+    }
+    if(rand() % 4 == 0)
+        display_draw_logo(rand() % 160 - 30, rand() % 50 - 20);
+    if(rand() % 3 == 0)
+        display_print("pl1 xyz", rand() % 150 - 20, rand() % 44 - 10);
+}
+
+
+/* Brief  : Counts and prints a failed check, see CHECK(). Returns ok.
+ * Author : Rasmus Kallqvist */
+int board_check(int ok, const char *what, const char *file, int line)
+{
+    if(!ok && ++failures <= 10)
+        printf("%s:%d: check failed: %s\n", file, line, what);
+    return ok;
+}
+
+
+/* Brief  : Prints the outcome of a test and returns its exit status
+ * Author : Rasmus Kallqvist */
+int board_result(const char *name)
+{
+    if(failures)
+        printf("%s: %d checks failed\n", name, failures);
+    else
+        printf("%s: ok\n", name);
+    return failures != 0;
+}
+
+
+/* Brief  : Returns a monotonic time in seconds, for benchmarks
+ * Author : Rasmus Kallqvist */
+double board_seconds(void)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+
+/* Brief  : Follows the display pins after a write to PORTF or PORTG
+ * Author : Rasmus Kallqvist */
+static void board_pins(void)
+{
+    uint32_t f = board_regs[BOARD_PORTF];
+    uint8_t vdd = !(f & PIN_VDD);
+    uint8_t vbat = !(f & PIN_VBAT);
+    uint8_t reset = !(board_regs[BOARD_PORTG] & PIN_RESET);
+
+    if((f ^ pins_f) & PIN_DC)
+        oled.dc_switches++;
+    pins_f = f;
+
+    if(vdd != oled.vdd)
+        oled.vdd_time = board_time;
+    if(vbat != oled.vbat)
+        oled.vbat_time = board_time;
+    if(reset && !oled.reset)
+        oled.reset_time = board_time;
+    if(!reset && oled.reset)
+        oled.reset_end_time = board_time;
+    oled.vdd = vdd;
+    oled.vbat = vbat;
+    oled.reset = reset;
+}
+
+
+/* Brief  : Decodes a command byte, or an argument of the command before it
+ * Author : Rasmus Kallqvist */
+static void oled_command(uint8_t byte)
+{
+    oled.cmd_bytes++;
+
+    if(cmd_left)
+    {
+        cmd_args[cmd_argc++] = byte;
+        if(--cmd_left)
+            return;
+
+        switch(cmd)
+        {
+            case 0x20 :
+                oled.mode = cmd_args[0] & 0x3;
+                break;
+            case 0x21 :
+                oled.col_start = cmd_args[0] & 0x7F;
+                oled.col_end = cmd_args[1] & 0x7F;
+                oled.col = oled.col_start;
+                break;
+            case 0x22 :
+                oled.page_start = cmd_args[0] & 0x7;
+                oled.page_end = cmd_args[1] & 0x7;
+                oled.page = oled.page_start;
+                break;
+            case 0x81 :
+                oled.contrast = cmd_args[0];
+                break;
+            case 0x8D :
+                oled.charge_pump = (cmd_args[0] & 0x04) != 0;
+                break;
+            case 0xD3 :
+                oled.offset = cmd_args[0] & 0x3F;
+                break;
+        }
+        return;
+    }
+
+    cmd = byte;
+    cmd_argc = 0;
+    if(byte < 0x10)
+    {
+        if(oled.mode == 2)
+            oled.col = (oled.col & 0xF0) | byte;
+    }
+    else if(byte < 0x20)
+    {
+        if(oled.mode == 2)
+            oled.col = (oled.col & 0x0F) | ((byte & 0x7) << 4);
+    }
+    else if(byte == 0x20 || byte == 0x81 || byte == 0x8D || byte == 0xA8 ||
+            byte == 0xD3 || byte == 0xD5 || byte == 0xD9 || byte == 0xDA ||
+            byte == 0xDB)
+        cmd_left = 1;
+    else if(byte == 0x21 || byte == 0x22 || byte == 0xA3)
+        cmd_left = 2;
+    else if(byte == 0x29 || byte == 0x2A)
+        cmd_left = 5;
+    else if(byte == 0x26 || byte == 0x27)
+        cmd_left = 6;
+    else if(byte == 0x2E)
+        oled.scroll = 0;
+    else if(byte == 0x2F)
+        oled.scroll = 1;
+    else if(byte >= 0x40 && byte < 0x80)
+        oled.start_line = byte & 0x3F;
+    else if(byte == 0xA6 || byte == 0xA7)
+        oled.invert = byte & 0x1;
+    else if(byte == 0xAE)
+        oled.on = 0;
+    else if(byte == 0xAF)
+    {
+        oled.on = 1;
+        oled.on_time = board_time;
+    }
+    else if(byte >= 0xB0 && byte <= 0xB7)
+    {
+        if(oled.mode == 2)
+            oled.page = byte & 0x7;
+    }
+}
+
+
+/* Brief  : Writes a data byte at the ram pointer and moves the pointer on,
+ *          wrapping within the addressing window
+ * Author : Rasmus Kallqvist */
+static void oled_data(uint8_t byte)
+{
+    oled.data_bytes++;
+    if(oled.scroll)
+        oled.scroll_writes++;
+    oled.ram[oled.page][oled.col] = byte;
+
+    if(oled.mode == 2)
+    {
+        oled.col = (oled.col + 1) & 0x7F;
+        return;
+    }
+    if(oled.col != oled.col_end)
+    {
+        oled.col++;
+        return;
+    }
+    oled.col = oled.col_start;
+    oled.page = (oled.page == oled.page_end) ? oled.page_start : oled.page + 1;
+}
@@ -0,0 +1,67 @@
+/*
+********************************************************************************
+* name   :  board.h
+* author :  Rasmus Kallqvist, 2017
+* brief  :  Header file for board.c
+********************************************************************************
+*/
+
+#ifndef BOARD_H
+#define BOARD_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <pic32mx.h>    /* Host stand-in, tools/pic32mx.h */
+
+/* Defines -------------------------------------------------------------------*/
+#define OLED_PAGES          8       /* Graphic ram of the controller */
+#define OLED_COLS           128
+/* Counts a failed check and prints where it was, evaluates to cond */
+#define CHECK(cond)         board_check((cond) != 0, #cond, __FILE__, __LINE__)
+
+/* Structs -------------------------------------------------------------------*/
+/* Brief  : State of the SSD1306 display controller on the i/o shield, as
+ *          far as the firmware uses it, and counters of what was sent.
+ * Author : Rasmus Kallqvist */
+struct oled
+{
+    uint8_t ram[OLED_PAGES][OLED_COLS];
+    uint8_t mode;               /* 0 horizontal, 2 page addressing        */
+    uint8_t col, page;          /* Ram pointer                            */
+    uint8_t col_start, col_end; /* Horizontal addressing window           */
+    uint8_t page_start, page_end;
+    uint8_t contrast;
+    uint8_t scroll;             /* Hardware scroll running                */
+    uint8_t invert;
+    uint8_t start_line;
+    uint8_t offset;
+    uint8_t on;                 /* Display turned on                      */
+    uint8_t charge_pump;        /* Charge pump enabled                    */
+    /* Power pins, and the board time they last changed, see board_time */
+    uint8_t vdd, vbat, reset;
+    uint32_t vdd_time, vbat_time, reset_time, reset_end_time, on_time;
+    /* Counters */
+    uint32_t cmd_bytes;
+    uint32_t data_bytes;
+    uint32_t dc_switches;
+    uint32_t unpowered_bytes;   /* Sent without VDD, or during reset      */
+    uint32_t scroll_writes;     /* Data written while scrolling, an error */
+};
+
+/* Variables -----------------------------------------------------------------*/
+extern volatile unsigned int board_regs[BOARD_REGS];
+extern struct oled oled;
+extern uint32_t board_time;     /* Microseconds, advanced by the tests */
+
+/* Function prototypes -------------------------------------------------------*/
+void board_reset(void);
+void board_sync(void);
+int board_ram_matches(uint8_t (*front)[OLED_COLS]);
+void board_random_frame(int on_front);
+uint8_t oled_pixel(int x, int y);
+uint32_t oled_hash(void);
+int board_check(int ok, const char *what, const char *file, int line);
+int board_result(const char *name);
+double board_seconds(void);
+
+#endif /* BOARD_H */
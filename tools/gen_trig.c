@@ -0,0 +1,39 @@
+/*
+********************************************************************************
+* name   :  gen_trig.c
+* author :  Rasmus Kallqvist, 2017
+* brief  :  Host program run at build time, prints the Q1.15 sine table used
+*           by trig.c as a C header on stdout. Built with the host compiler,
+*           see the trig_table.h rule in the Makefile.
+********************************************************************************
+*/
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <math.h>
+
+/* Defines -------------------------------------------------------------------*/
+#define TRIG_ENTRIES    256     /* Must match TRIG_ANGLES in trig.h */
+#define Q15_ONE         32767   /* Largest value representable in Q1.15 */
+
+/* Function definitions ------------------------------------------------------*/
+/* Brief  : Prints one full period of sine, rounded to nearest Q1.15 value
+ * Author : Rasmus Kallqvist */
+int main(void)
+{
+    int i;
+    double s;
+
+    printf("/* Generated by tools/gen_trig.c, do not edit */\n");
+    printf("#ifndef TRIG_TABLE_H\n#define TRIG_TABLE_H\n");
+    printf("static const int16_t trig_sin_table[%d] =\n{", TRIG_ENTRIES);
+    for(i = 0; i < TRIG_ENTRIES; i++)
+    {
+        s = sin(2.0 * M_PI * i / TRIG_ENTRIES);
+        if(i % 8 == 0)
+            printf("\n\t");
+        printf("%6ld,", lround(s * Q15_ONE));
+    }
+    printf("\n};\n#endif /* TRIG_TABLE_H */\n");
+    return 0;
+}
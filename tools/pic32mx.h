@@ -0,0 +1,126 @@
+/*
+********************************************************************************
+* name   :  pic32mx.h
+* author :  Rasmus Kallqvist, 2017
+* brief  :  Host stand-in for the mcb32 <pic32mx.h>, used by the host tests
+*           in tools/. Each register is a word in board_regs. Writes to the
+*           CLR/SET/INV registers, the spi2 buffer and the ports are taken
+*           in by the board model in tools/board.c at the next register
+*           access, the way the hardware would see them.
+********************************************************************************
+*/
+
+#ifndef PIC32MX_H
+#define PIC32MX_H
+
+/* Defines -------------------------------------------------------------------*/
+/* Register numbers in board_regs */
+#define BOARD_PORTB         0
+#define BOARD_PORTD         1
+#define BOARD_PORTE         2
+#define BOARD_PORTF         3
+#define BOARD_PORTG         4
+#define BOARD_TRISB         5
+#define BOARD_TRISD         6
+#define BOARD_TRISE         7
+#define BOARD_TRISF         8
+#define BOARD_TRISG         9
+#define BOARD_ODCF          10
+#define BOARD_ODCG          11
+#define BOARD_SPI2CON       12
+#define BOARD_SPI2STAT      13
+#define BOARD_SPI2BRG       14
+#define BOARD_OSCCON        15
+#define BOARD_T2CON         16
+#define BOARD_PR2           17
+#define BOARD_TMR2          18
+#define BOARD_AD1CON1       19
+#define BOARD_AD1CON2       20
+#define BOARD_AD1CON3       21
+#define BOARD_AD1CHS        22
+#define BOARD_AD1CSSL       23
+#define BOARD_AD1PCFG       24
+#define BOARD_INTCON        25
+#define BOARD_IFS(n)        (32 + (n))
+#define BOARD_IEC(n)        (36 + (n))
+#define BOARD_IPC(n)        (40 + (n))
+#define BOARD_ADC1BUF(n)    (64 + 4 * (n)) /* 16 bytes apart, as on the pic32 */
+#define BOARD_REGS          128
+
+/* Kinds of register writes */
+#define BOARD_WRITE         0
+#define BOARD_CLR           1
+#define BOARD_SET           2
+#define BOARD_INV           3
+
+#define BOARD_REG(n)        (*board_reg(n))
+#define BOARD_OP(n, op)     (*board_reg_op(n, op))
+
+/* Ports */
+#define PORTB               BOARD_REG(BOARD_PORTB)
+#define PORTD               BOARD_REG(BOARD_PORTD)
+#define PORTE               BOARD_REG(BOARD_PORTE)
+#define PORTECLR            BOARD_OP(BOARD_PORTE, BOARD_CLR)
+#define PORTESET            BOARD_OP(BOARD_PORTE, BOARD_SET)
+#define PORTF               BOARD_REG(BOARD_PORTF)
+#define PORTFCLR            BOARD_OP(BOARD_PORTF, BOARD_CLR)
+#define PORTFSET            BOARD_OP(BOARD_PORTF, BOARD_SET)
+#define PORTG               BOARD_REG(BOARD_PORTG)
+#define PORTGCLR            BOARD_OP(BOARD_PORTG, BOARD_CLR)
+#define PORTGSET            BOARD_OP(BOARD_PORTG, BOARD_SET)
+#define TRISB               BOARD_REG(BOARD_TRISB)
+#define TRISBSET            BOARD_OP(BOARD_TRISB, BOARD_SET)
+#define TRISDSET            BOARD_OP(BOARD_TRISD, BOARD_SET)
+#define TRISECLR            BOARD_OP(BOARD_TRISE, BOARD_CLR)
+#define TRISFSET            BOARD_OP(BOARD_TRISF, BOARD_SET)
+#define TRISFCLR            BOARD_OP(BOARD_TRISF, BOARD_CLR)
+#define TRISGCLR            BOARD_OP(BOARD_TRISG, BOARD_CLR)
+#define ODCF                BOARD_REG(BOARD_ODCF)
+#define ODCG                BOARD_REG(BOARD_ODCG)
+/* Spi2, the display */
+#define SPI2CON             BOARD_REG(BOARD_SPI2CON)
+#define SPI2CONSET          BOARD_OP(BOARD_SPI2CON, BOARD_SET)
+#define SPI2STAT            (*board_spi_stat())
+#define SPI2STATCLR         BOARD_OP(BOARD_SPI2STAT, BOARD_CLR)
+#define SPI2BRG             BOARD_REG(BOARD_SPI2BRG)
+#define SPI2BUF             (*board_spi_buf())
+/* Clock and timer 2 */
+#define OSCCONCLR           BOARD_OP(BOARD_OSCCON, BOARD_CLR)
+#define OSCCONSET           BOARD_OP(BOARD_OSCCON, BOARD_SET)
+#define T2CON               BOARD_REG(BOARD_T2CON)
+#define T2CONSET            BOARD_OP(BOARD_T2CON, BOARD_SET)
+#define T2CONCLR            BOARD_OP(BOARD_T2CON, BOARD_CLR)
+#define PR2                 BOARD_REG(BOARD_PR2)
+#define TMR2                BOARD_REG(BOARD_TMR2)
+/* ADC */
+#define AD1CON1             BOARD_REG(BOARD_AD1CON1)
+#define AD1CON1SET          BOARD_OP(BOARD_AD1CON1, BOARD_SET)
+#define AD1CON1CLR          BOARD_OP(BOARD_AD1CON1, BOARD_CLR)
+#define AD1CON2             BOARD_REG(BOARD_AD1CON2)
+#define AD1CON3             BOARD_REG(BOARD_AD1CON3)
+#define AD1CHS              BOARD_REG(BOARD_AD1CHS)
+#define AD1CSSL             BOARD_REG(BOARD_AD1CSSL)
+#define AD1PCFG             BOARD_REG(BOARD_AD1PCFG)
+#define AD1PCFGCLR          BOARD_OP(BOARD_AD1PCFG, BOARD_CLR)
+#define ADC1BUF0            BOARD_REG(BOARD_ADC1BUF(0))
+/* Interrupt controller */
+#define INTCON              BOARD_REG(BOARD_INTCON)
+#define INTCONSET           BOARD_OP(BOARD_INTCON, BOARD_SET)
+#define INTCONCLR           BOARD_OP(BOARD_INTCON, BOARD_CLR)
+#define IFS(n)              BOARD_REG(BOARD_IFS(n))
+#define IFSCLR(n)           BOARD_OP(BOARD_IFS(n), BOARD_CLR)
+#define IFSSET(n)           BOARD_OP(BOARD_IFS(n), BOARD_SET)
+#define IEC(n)              BOARD_REG(BOARD_IEC(n))
+#define IECCLR(n)           BOARD_OP(BOARD_IEC(n), BOARD_CLR)
+#define IECSET(n)           BOARD_OP(BOARD_IEC(n), BOARD_SET)
+#define IPC(n)              BOARD_REG(BOARD_IPC(n))
+#define IPCCLR(n)           BOARD_OP(BOARD_IPC(n), BOARD_CLR)
+#define IPCSET(n)           BOARD_OP(BOARD_IPC(n), BOARD_SET)
+
+/* Function prototypes -------------------------------------------------------*/
+volatile unsigned int *board_reg(int reg);
+volatile unsigned int *board_reg_op(int reg, int op);
+volatile unsigned int *board_spi_buf(void);
+volatile unsigned int *board_spi_stat(void);
+
+#endif /* PIC32MX_H */
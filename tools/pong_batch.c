@@ -0,0 +1,404 @@
+/*
+********************************************************************************
+* name   :  pong_batch.c
+* author :  Rasmus Kallqvist, 2017
+* brief  :  Steps many pong games at once for bots and training on the host.
+*           Games are kept as columns, struct-of-arrays, so the common steps,
+*           a ball flying freely or a timed state ticking on, run as one
+*           branch free loop over all games that the compiler can
+*           vectorise. The few games that hit something, score or change
+*           state in a step go through pong_update_step() itself, so results
+*           are bit for bit those of the scalar game.
+********************************************************************************
+*/
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdlib.h>
+#include <string.h>
+#include "pong_batch.h"
+#include "font.h"       /* Same font as the display */
+
+/* Defines -------------------------------------------------------------------*/
+#define BATCH_ALIGN     64      /* Column alignment, a cache line */
+
+/* Declarations --------------------------------------------------------------*/
+/* batch_step_mul() needs the ball to move less than its speed per step,
+   that is BALL_STEP < FIX_ONE. BALL_STEP comes from a double, so compare
+   the integer rates it is made of. */
+typedef char batch_step_check[PONG_SPEED_HZ < PONG_UPDATE_HZ ? 1 : -1];
+
+/* Function definitions ------------------------------------------------------*/
+/* Brief  : FIX_MUL(a, BALL_STEP) in 32 bit integers, which vectorise where
+ *          64 bit products do not. Exact, the product of the low half of a
+ *          and BALL_STEP fits in 32 bits and the rest wraps like the cast.
+ * Author : Rasmus Kallqvist */
+static inline int32_t batch_step_mul(int32_t a)
+{
+    return (int32_t)((uint32_t)(a >> FIX_SHIFT) * BALL_STEP +
+                     (((uint32_t)a & 0xFFFF) * BALL_STEP >> FIX_SHIFT));
+}
+
+/* Brief  : Allocates an aligned column of n entries of size bytes
+ * Author : Rasmus Kallqvist */
+static void *batch_column(uint32_t n, size_t size)
+{
+    size_t bytes = ((n * size + BATCH_ALIGN - 1) / BATCH_ALIGN) * BATCH_ALIGN;
+    void *p = aligned_alloc(BATCH_ALIGN, bytes ? bytes : BATCH_ALIGN);
+
+    if(p)
+        memset(p, 0, bytes);
+    return p;
+}
+
+/* Brief  : Creates n games with the gameplay constants in params, or the
+ *          board's constants if params is null. Returns null if out of
+ *          memory. Games start as after pong_batch_reset() with seed 0.
+ * Author : Rasmus Kallqvist */
+struct pong_batch *pong_batch_create(uint32_t n,
+                                     const struct pong_params *params)
+{
+    struct pong_batch *b = calloc(1, sizeof(*b));
+
+    if(!b)
+        return 0;
+    b->n = n;
+    pong_setup_params(&b->proto, params ? params : &pong_default_params);
+    b->ball_x = batch_column(n, sizeof(*b->ball_x));
+    b->ball_y = batch_column(n, sizeof(*b->ball_y));
+    b->ball_dx = batch_column(n, sizeof(*b->ball_dx));
+    b->ball_dy = batch_column(n, sizeof(*b->ball_dy));
+    b->left_y = batch_column(n, sizeof(*b->left_y));
+    b->right_y = batch_column(n, sizeof(*b->right_y));
+    b->pl1_score = batch_column(n, sizeof(*b->pl1_score));
+    b->pl2_score = batch_column(n, sizeof(*b->pl2_score));
+    b->state = batch_column(n, sizeof(*b->state));
+    b->winner = batch_column(n, sizeof(*b->winner));
+    b->state_us = batch_column(n, sizeof(*b->state_us));
+    b->rally = batch_column(n, sizeof(*b->rally));
+    b->reward = batch_column(n, sizeof(*b->reward));
+    b->done = batch_column(n, sizeof(*b->done));
+    b->slow = batch_column(n, sizeof(*b->slow));
+    if(!b->ball_x || !b->ball_y || !b->ball_dx || !b->ball_dy ||
+       !b->left_y || !b->right_y || !b->pl1_score || !b->pl2_score ||
+       !b->state || !b->winner || !b->state_us || !b->rally ||
+       !b->reward || !b->done || !b->slow)
+    {
+        pong_batch_destroy(b);
+        return 0;
+    }
+    pong_batch_reset(b, 0);
+    return b;
+}
+
+/* Brief  : Frees the games
+ * Author : Rasmus Kallqvist */
+void pong_batch_destroy(struct pong_batch *b)
+{
+    if(!b)
+        return;
+    free(b->ball_x);
+    free(b->ball_y);
+    free(b->ball_dx);
+    free(b->ball_dy);
+    free(b->left_y);
+    free(b->right_y);
+    free(b->pl1_score);
+    free(b->pl2_score);
+    free(b->state);
+    free(b->winner);
+    free(b->state_us);
+    free(b->rally);
+    free(b->reward);
+    free(b->done);
+    free(b->slow);
+    free(b);
+}
+
+/* Brief  : Copies game i into ctx, which can then be run with the scalar
+ *          pong functions
+ * Author : Rasmus Kallqvist */
+void pong_batch_get(const struct pong_batch *b, uint32_t i,
+                    struct pong_ctx *ctx)
+{
+    *ctx = b->proto;
+    ctx->ball.x = b->ball_x[i];
+    ctx->ball.y = b->ball_y[i];
+    ctx->ball.dx = b->ball_dx[i];
+    ctx->ball.dy = b->ball_dy[i];
+    ctx->left_racket.y = b->left_y[i];
+    ctx->right_racket.y = b->right_y[i];
+    ctx->pl1_score = b->pl1_score[i];
+    ctx->pl2_score = b->pl2_score[i];
+    ctx->state = b->state[i];
+    ctx->winning_player = b->winner[i];
+    ctx->state_us = b->state_us[i];
+    ctx->rally = b->rally[i];
+}
+
+/* Brief  : Copies ctx into game i. Sizes and constants are those of the
+ *          batch, whatever ctx holds.
+ * Author : Rasmus Kallqvist */
+void pong_batch_set(struct pong_batch *b, uint32_t i,
+                    const struct pong_ctx *ctx)
+{
+    b->ball_x[i] = ctx->ball.x;
+    b->ball_y[i] = ctx->ball.y;
+    b->ball_dx[i] = ctx->ball.dx;
+    b->ball_dy[i] = ctx->ball.dy;
+    b->left_y[i] = ctx->left_racket.y;
+    b->right_y[i] = ctx->right_racket.y;
+    b->pl1_score[i] = ctx->pl1_score;
+    b->pl2_score[i] = ctx->pl2_score;
+    b->state[i] = ctx->state;
+    b->winner[i] = ctx->winning_player;
+    b->state_us[i] = ctx->state_us;
+    b->rally[i] = ctx->rally;
+}
+
+/* Brief  : Starts a new match in every game. Seed 0 starts them all like
+ *          pong_setup(), other seeds give each game its own serve, a random
+ *          row and direction for the ball.
+ * Author : Rasmus Kallqvist */
+void pong_batch_reset(struct pong_batch *b, uint64_t seed)
+{
+    struct pong_ctx ctx;
+    uint64_t z;
+    uint32_t i;
+    int rows = FIELD_BOTTOM - FIELD_TOP - b->proto.ball.h + 1;
+
+    for(i = 0; i < b->n; i++)
+    {
+        ctx = b->proto;
+        if(seed)
+        {
+            /* splitmix64 of seed and game number */
+            z = seed + (i + 1) * 0x9E3779B97F4A7C15ULL;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            z ^= z >> 31;
+            ctx.ball.y = FIX_FROM_INT(FIELD_TOP + (int)(z % rows));
+            if(z & (1ULL << 32))
+                ctx.ball.dx = -ctx.ball.dx;
+            if(z & (1ULL << 33))
+                ctx.ball.dy = -ctx.ball.dy;
+        }
+        pong_batch_set(b, i, &ctx);
+        b->reward[i] = 0;
+        b->done[i] = 0;
+        b->slow[i] = 0;
+    }
+}
+
+/* Brief  : Advances every game by one update step of PONG_STEP_US with the
+ *          same results as pong_update_step(). Actions are potentiometer
+ *          values like the analog values of pong_update_step(), two per
+ *          game, actions[2 * i] for player 1 and actions[2 * i + 1] for
+ *          player 2. Sets reward and done of every game, and returns the
+ *          number of games that needed the full rules.
+ *          Games carry on into the next match as on the board, done only
+ *          marks the step in which a match was won.
+ * Author : Rasmus Kallqvist */
+uint32_t pong_batch_step(struct pong_batch *b, const uint16_t *actions)
+{
+    const struct pong_ctx *p = &b->proto;
+    const int32_t bw = FIX_FROM_INT(p->ball.w), bh = FIX_FROM_INT(p->ball.h);
+    const int32_t rw = FIX_FROM_INT(p->left_racket.w);
+    const int32_t rh = FIX_FROM_INT(p->left_racket.h);
+    const int32_t lx = p->left_racket.x, rx = p->right_racket.x;
+    const int range = 32 - p->left_racket.h;
+    const uint32_t n = b->n;
+    const uint16_t *act = actions;
+    int32_t *ball_x = b->ball_x;
+    int32_t *ball_y = b->ball_y;
+    const int32_t *ball_dx = b->ball_dx;
+    const int32_t *ball_dy = b->ball_dy;
+    int32_t *left_y = b->left_y;
+    int32_t *right_y = b->right_y;
+    const uint8_t *state = b->state;
+    uint32_t *state_us = b->state_us;
+    int8_t *reward = b->reward;
+    uint8_t *done = b->done;
+    uint8_t *slow_games = b->slow;
+    struct pong_ctx ctx;
+    enum game_state prev_state;
+    int32_t prev_score;
+    uint32_t slow = 0;
+    size_t i;                   /* Not wrapping, for the vectoriser */
+
+    /* Common steps for all games at once. For a ball in play this is the
+       first motion of pong_update_ball() when it rules out the roof, the
+       floor and both rackets and no one scores, with the exact same
+       tests in integers. Columns never overlap, telling the compiler lets
+       it vectorise. */
+#pragma GCC ivdep
+    for(i = 0; i < n; i++)
+    {
+        int32_t ly = FIX_FROM_INT(act[2 * i] * range / 1024);
+        int32_t ry = FIX_FROM_INT(act[2 * i + 1] * range / 1024);
+        uint32_t us = state_us[i] + PONG_STEP_US;
+        int32_t st = state[i];
+        int32_t x = ball_x[i], y = ball_y[i];
+        int32_t mx = batch_step_mul(ball_dx[i]);
+        int32_t my = batch_step_mul(ball_dy[i]);
+        int32_t x0 = x + (mx < 0 ? mx : 0), x1 = x + bw + (mx > 0 ? mx : 0);
+        int32_t y0 = y + (my < 0 ? my : 0), y1 = y + bh + (my > 0 ? my : 0);
+        int32_t m = my < 0 ? -my : my;
+        int32_t d = my < 0 ? y - FIX_FROM_INT(FIELD_TOP) :
+                             FIX_FROM_INT(FIELD_BOTTOM) - y - bh;
+        int32_t wait, moves;
+
+        /* Timed states that do not end in this step */
+        wait = ((st == match_begin) & (us < MATCH_BEGIN_MS * 1000)) |
+               ((st == round_begin) & (us < ROUND_BEGIN_MS * 1000)) |
+               ((st == match_end) & (us < MATCH_END_MS * 1000));
+
+        /* Roof or floor further away than the motion, sweep_time() above
+           FIX_ONE is d * FIX_ONE >= (FIX_ONE + 1) * m. Rackets outside the
+           swept box, and the ball still in the field. */
+        moves = (st == round_playing) &
+                ((m == 0) | (d - m > ((m - 1) >> FIX_SHIFT))) &
+                ((x0 >= lx + rw) | (x1 <= lx) | (y0 >= ly + rh) | (y1 <= ly)) &
+                ((x0 >= rx + rw) | (x1 <= rx) | (y0 >= ry + rh) | (y1 <= ry)) &
+                (x + mx <= FIX_FROM_INT(RIGHT_EDGE)) &
+                (x + mx >= FIX_FROM_INT(LEFT_EDGE));
+
+        left_y[i] = ly;
+        right_y[i] = ry;
+        state_us[i] = (wait | moves) ? us : state_us[i];
+        ball_x[i] = moves ? x + mx : x;
+        ball_y[i] = moves ? y + my : y;
+        reward[i] = 0;
+        done[i] = 0;
+        slow_games[i] = !(wait | moves);
+        slow += !(wait | moves);
+    }
+
+    /* The rest through the game rules */
+    for(i = 0; slow && i < b->n; i++)
+    {
+        if(!b->slow[i])
+            continue;
+        pong_batch_get(b, i, &ctx);
+        prev_state = ctx.state;
+        prev_score = ctx.pl1_score;
+        pong_update_step(&ctx, &actions[2 * i]);
+        pong_batch_set(b, i, &ctx);
+
+        /* Point scored, scores are reset when the match is won */
+        if(prev_state == round_playing && ctx.state != round_playing)
+        {
+            if(ctx.state == match_end)
+                b->reward[i] = ctx.winning_player == player_1 ? 1 : -1;
+            else
+                b->reward[i] = ctx.pl1_score != prev_score ? 1 : -1;
+            b->done[i] = ctx.state == match_end;
+        }
+    }
+    return slow;
+}
+
+/* Brief  : Fills a w by h block at (x, y) in a page packed bitmap, clipped
+ *          to the screen
+ * Author : Rasmus Kallqvist */
+static void batch_fill(uint8_t *bm, int x, int y, int w, int h)
+{
+    int col, row;
+
+    for(col = x < 0 ? 0 : x; col < x + w && col < 128; col++)
+        for(row = y < 0 ? 0 : y; row < y + h && row < 32; row++)
+            bm[(row >> 3) * 128 + col] |= 1 << (row & 7);
+}
+
+/* Brief  : Prints a string like display_print()
+ * Author : Rasmus Kallqvist */
+static void batch_print(uint8_t *bm, const char *s, int x, int y)
+{
+    int n, col, col_x;
+    int page = y >> 3;
+    uint8_t shift = y & 0x7;
+    const uint8_t *glyph;
+
+    for(n = 0; n < 16 && s[n]; n++)
+    {
+        glyph = &font[(s[n] & 0x7F) * 8];
+        for(col = 0; col < 8; col++)
+        {
+            col_x = x + 8 * n + col;
+            if(col_x < 0)
+                continue;
+            if(col_x > 127)
+                break;
+            if(page >= 0 && page < 4)
+                bm[page * 128 + col_x] |= glyph[col] << shift;
+            if(shift && page + 1 >= 0 && page + 1 < 4)
+                bm[(page + 1) * 128 + col_x] |= glyph[col] >> (8 - shift);
+        }
+    }
+}
+
+/* Brief  : Renders every game into bitmaps, PONG_BATCH_BITMAP bytes per
+ *          game, as pong_draw() draws it on the display. Each bitmap is four
+ *          pages of 128 columns with bit 0 as the top row of a page, the
+ *          same layout as the display buffer.
+ * Author : Rasmus Kallqvist */
+void pong_batch_render(const struct pong_batch *b, uint8_t *bitmaps)
+{
+    const struct pong_ctx *p = &b->proto;
+    uint8_t *bm;
+    char c[2] = {0, 0};
+    uint32_t i;
+    int row;
+
+    for(i = 0; i < b->n; i++)
+    {
+        bm = bitmaps + (size_t)i * PONG_BATCH_BITMAP;
+        memset(bm, 0, PONG_BATCH_BITMAP);
+        switch(b->state[i])
+        {
+            case(match_begin) :
+                if(b->state_us[i] < MATCH_READY_MS * 1000)
+                    batch_print(bm, "Get ready", 28, 12);
+                else
+                {
+                    batch_print(bm, "Playing to ", 16, 12);
+                    c[0] = '0' + MATCH_SCORE;
+                    batch_print(bm, c, 104, 12);
+                }
+                break;
+
+            case(match_end) :
+                if(b->winner[i] == player_1)
+                    batch_print(bm, "Player 1", 32, 8);
+                if(b->winner[i] == player_2)
+                    batch_print(bm, "Player 2", 32, 8);
+                batch_print(bm, "wins!", 48, 16);
+                break;
+
+            default :
+                /* Field lines, dots of three pixels */
+                for(row = 0; row < 32; row++)
+                {
+                    if((row / 3) % 2)
+                        continue;
+                    batch_fill(bm, LEFT_EDGE - 1, row, 1, 1);
+                    batch_fill(bm, RIGHT_EDGE - 1, row, 1, 1);
+                }
+                batch_print(bm, "pl1", 0, 0);
+                batch_print(bm, "pl2", 128-24, 0);
+                batch_fill(bm, FIX_ROUND(p->left_racket.x),
+                           FIX_ROUND(b->left_y[i]),
+                           p->left_racket.w, p->left_racket.h);
+                batch_fill(bm, FIX_ROUND(p->right_racket.x),
+                           FIX_ROUND(b->right_y[i]),
+                           p->right_racket.w, p->right_racket.h);
+                batch_fill(bm, FIX_ROUND(b->ball_x[i]),
+                           FIX_ROUND(b->ball_y[i]),
+                           p->ball.w, p->ball.h);
+                c[0] = '0' + b->pl1_score[i];
+                batch_print(bm, c, 8, 10);
+                c[0] = '0' + b->pl2_score[i];
+                batch_print(bm, c, 128-16, 10);
+                break;
+        }
+    }
+}
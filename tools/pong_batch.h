@@ -0,0 +1,60 @@
+/*
+********************************************************************************
+* name   :  pong_batch.h
+* author :  Rasmus Kallqvist, 2017
+* brief  :  Header for pong_batch.c, many pong games stepped at once for bots
+*           and training on the host
+********************************************************************************
+*/
+
+#ifndef PONG_BATCH_H
+#define PONG_BATCH_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include "pong.h"       /* Game rules and struct pong_ctx */
+
+/* Defines -------------------------------------------------------------------*/
+#define PONG_BATCH_BITMAP   (4 * 128)   /* Bytes per rendered game */
+
+/* Structs -------------------------------------------------------------------*/
+/* Brief  : N pong games laid out as columns, entry i of every column belongs
+ *          to game i. The columns are the observations, read them directly.
+ *          All games share the constants of the prototype game.
+ * Author : Rasmus Kallqvist */
+struct pong_batch
+{
+    uint32_t n;                 /* Number of games */
+    struct pong_ctx proto;      /* New game, holds sizes and constants */
+    /* Game state, same units as struct pong_ctx */
+    int32_t *ball_x;
+    int32_t *ball_y;
+    int32_t *ball_dx;
+    int32_t *ball_dy;
+    int32_t *left_y;
+    int32_t *right_y;
+    int32_t *pl1_score;
+    int32_t *pl2_score;
+    uint8_t *state;             /* enum game_state */
+    uint8_t *winner;            /* enum player, of the last match */
+    uint32_t *state_us;
+    uint16_t *rally;
+    /* Results of the last step */
+    int8_t *reward;             /* 1 if player 1 scored, -1 if player 2 did */
+    uint8_t *done;              /* Match was won */
+    uint8_t *slow;              /* Game went through pong_update_step() */
+};
+
+/* Function prototypes -------------------------------------------------------*/
+struct pong_batch *pong_batch_create(uint32_t n,
+                                     const struct pong_params *params);
+void pong_batch_destroy(struct pong_batch *b);
+void pong_batch_reset(struct pong_batch *b, uint64_t seed);
+uint32_t pong_batch_step(struct pong_batch *b, const uint16_t *actions);
+void pong_batch_render(const struct pong_batch *b, uint8_t *bitmaps);
+void pong_batch_get(const struct pong_batch *b, uint32_t i,
+                    struct pong_ctx *ctx);
+void pong_batch_set(struct pong_batch *b, uint32_t i,
+                    const struct pong_ctx *ctx);
+
+#endif /* PONG_BATCH_H */
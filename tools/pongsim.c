@@ -0,0 +1,648 @@
+/*
+********************************************************************************
+* name   :  pongsim.c
+* author :  Rasmus Kallqvist, 2017
+* brief  :  Headless match simulator, runs the game rules in pong.c on the
+*           host with bots in place of the potentiometers. Plays a number of
+*           matches for each point of a grid of gameplay constants, spread
+*           over all cores, and reports rally lengths, final scores and
+*           speed per constant set. Built with the host compiler, see the
+*           pongsim rule in the Makefile.
+*
+*           Each match is seeded from the seed and its number only, so a
+*           match plays out the same whatever thread runs it, and every
+*           constant set plays the same bot randomness.
+********************************************************************************
+*/
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include "pong.h"
+#include "ai.h"
+
+/* Defines -------------------------------------------------------------------*/
+#define SIM_CHUNK       64      /* Matches per task */
+#define SIM_MAX_THREADS 256
+#define SIM_MAX_AXIS    64      /* Values per grid axis */
+#define SIM_MAX_STEPS   (PONG_UPDATE_HZ * 60 * 30) /* 30 min of game time */
+#define RALLY_BINS      17      /* 0, 1, 2-3, 4-7, ... 32768- hits */
+#define SCRIPT_MAX      65536   /* Values in a script file */
+
+/* Enums ---------------------------------------------------------------------*/
+enum bot_kind {bot_track, bot_random, bot_script, bot_ai};
+
+/* Structs -------------------------------------------------------------------*/
+/* Brief  : How a bot moves its racket. Trackers follow the ball when it comes
+ *          their way, aiming off by up to error pixels drawn anew for every
+ *          hit. Random bots wander, scripts replay potentiometer values
+ *          and ai bots are the firmware's computer player, see ai.c.
+ * Author : Rasmus Kallqvist */
+struct bot
+{
+    enum bot_kind kind;
+    int32_t error;              /* Q16.16 pixels */
+    int32_t speed;              /* Q16.16 pixels per update step */
+    const uint16_t *script;
+    uint32_t script_len;
+    uint8_t level;              /* Computer player difficulty */
+};
+
+/* Brief  : Running state of a bot during one match
+ * Author : Rasmus Kallqvist */
+struct bot_state
+{
+    uint64_t rng;
+    int32_t y;                  /* Q16.16 racket top */
+    int32_t aim;                /* Q16.16 offset from ball centre */
+    int32_t target;             /* Q16.16, random bots */
+    uint32_t pos;               /* Script position */
+    struct pong_ai ai;
+};
+
+/* Brief  : Results of one constant set, summed over matches
+ * Author : Rasmus Kallqvist */
+struct sim_stats
+{
+    uint64_t matches;
+    uint64_t timeouts;
+    uint64_t rallies;
+    uint64_t hits;
+    uint64_t steps;
+    uint64_t rally_max;
+    uint64_t rally_hist[RALLY_BINS];
+    uint64_t scores[2][MATCH_SCORE];    /* [winner - 1][loser points] */
+    double seconds;                     /* Thread time spent */
+};
+
+/* Brief  : Matches first to first + count - 1 of one constant set
+ * Author : Rasmus Kallqvist */
+struct sim_task
+{
+    uint32_t set;
+    uint32_t first;
+    uint32_t count;
+};
+
+/* Brief  : Task queue of one worker. The owner takes tasks from the tail,
+ *          idle workers steal from the head of other queues.
+ * Author : Rasmus Kallqvist */
+struct sim_deque
+{
+    pthread_mutex_t lock;
+    struct sim_task *tasks;
+    uint32_t head;
+    uint32_t tail;
+};
+
+/* Brief  : One simulation worker
+ * Author : Rasmus Kallqvist */
+struct sim_worker
+{
+    pthread_t thread;
+    uint32_t id;
+    struct sim_deque deque;
+    struct sim_stats *stats;    /* One per constant set */
+    uint64_t steals;
+};
+
+/* Brief  : Values of one grid axis
+ * Author : Rasmus Kallqvist */
+struct sim_axis
+{
+    double values[SIM_MAX_AXIS];
+    uint32_t count;
+};
+
+/* Local variables -----------------------------------------------------------*/
+static struct pong_params *sim_sets;
+static uint32_t sim_num_sets;
+static struct bot sim_bots[2];
+static uint64_t sim_seed = 1;
+static struct sim_worker *sim_workers;
+static uint32_t sim_num_workers;
+
+/* Function definitions ------------------------------------------------------*/
+/* Brief  : Next value of a splitmix64 generator
+ * Author : Rasmus Kallqvist */
+static uint64_t rng_next(uint64_t *state)
+{
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/* Brief  : Uniform Q16.16 value from -range to range
+ * Author : Rasmus Kallqvist */
+static int32_t rng_range(uint64_t *state, int32_t range)
+{
+    if(range <= 0)
+        return 0;
+    return (int32_t)(rng_next(state) % (2 * (uint64_t)range + 1)) - range;
+}
+
+/* Brief  : Wall clock in seconds
+ * Author : Rasmus Kallqvist */
+static double sim_time(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Brief  : Potentiometer value that puts a racket of height h at pixel row y,
+ *          the inverse of the racket update in pong_update_step()
+ * Author : Rasmus Kallqvist */
+static uint16_t bot_analog(int32_t y, int h)
+{
+    int32_t row = FIX_ROUND(y);
+    int32_t range = 32 - h;
+    int32_t a;
+
+    if(row < 0)
+        row = 0;
+    a = (row * 1024 + range - 1) / range;
+    return a > 1023 ? 1023 : a;
+}
+
+/* Brief  : Moves a bot racket and returns its potentiometer value for the
+ *          next update step of player (0 or 1)
+ * Author : Rasmus Kallqvist */
+static uint16_t bot_input(const struct bot *bot, struct bot_state *bs,
+                          const struct pong_ctx *ctx, int player,
+                          int new_hit)
+{
+    const struct actor *racket = player ? &ctx->right_racket :
+                                          &ctx->left_racket;
+    int32_t half = FIX_FROM_INT(racket->h) / 2;
+    int32_t target;
+    int incoming;
+
+    switch(bot->kind)
+    {
+        case bot_script:
+            return bot->script[bs->pos++ % bot->script_len];
+
+        case bot_ai:
+            return ai_work(&bs->ai, ctx);
+
+        case bot_random:
+            if(FIX_ABS(bs->target - bs->y) < bot->speed)
+                bs->target = rng_next(&bs->rng) %
+                             (uint64_t)FIX_FROM_INT(32 - racket->h + 1);
+            target = bs->target;
+            break;
+
+        default:
+            /* New aim for every ball coming this way */
+            if(new_hit)
+                bs->aim = rng_range(&bs->rng, bot->error);
+            incoming = player ? ctx->ball.dx > 0 : ctx->ball.dx < 0;
+            if(incoming && ctx->state == round_playing)
+                target = ctx->ball.y + FIX_FROM_INT(ctx->ball.h) / 2 +
+                         bs->aim - half;
+            else
+                target = FIX_FROM_INT(16) - half;
+            break;
+    }
+
+    /* Racket moves at most speed per step */
+    if(target > bs->y + bot->speed)
+        bs->y += bot->speed;
+    else if(target < bs->y - bot->speed)
+        bs->y -= bot->speed;
+    else
+        bs->y = target;
+    bs->y = FIX_CLAMP(bs->y, 0, FIX_FROM_INT(32 - racket->h));
+    return bot_analog(bs->y, racket->h);
+}
+
+/* Brief  : Plays one match from setup to its end and adds it to st
+ * Author : Rasmus Kallqvist */
+static void sim_match(const struct pong_params *params, uint32_t match,
+                      struct sim_stats *st)
+{
+    struct pong_ctx ctx;
+    struct bot_state bs[2];
+    uint16_t analog[2];
+    uint64_t seed = sim_seed ^ ((uint64_t)match * 0xD1B54A32D192ED03ULL);
+    enum game_state prev_state;
+    uint16_t prev_rally;
+    int prev_score[2];
+    uint32_t step, bin;
+    int i;
+
+    pong_setup_params(&ctx, params);
+    for(i = 0; i < 2; i++)
+    {
+        memset(&bs[i], 0, sizeof(bs[i]));
+        bs[i].rng = rng_next(&seed);
+        bs[i].y = FIX_FROM_INT(16) - FIX_FROM_INT(params->racket_h) / 2;
+        bs[i].target = bs[i].y;
+        ai_setup(&bs[i].ai, &ctx, sim_bots[i].level, (uint32_t)bs[i].rng);
+    }
+
+    prev_state = ctx.state;
+    prev_rally = 0xFFFF;
+    for(step = 0; step < SIM_MAX_STEPS; step++)
+    {
+        /* Bots aim anew after every hit and serve */
+        for(i = 0; i < 2; i++)
+            analog[i] = bot_input(&sim_bots[i], &bs[i], &ctx, i,
+                                  ctx.rally != prev_rally ||
+                                  ctx.state != prev_state);
+        prev_state = ctx.state;
+        prev_rally = ctx.rally;
+        prev_score[0] = ctx.pl1_score;
+        prev_score[1] = ctx.pl2_score;
+
+        pong_update_step(&ctx, analog);
+
+        /* Rally ends with a point */
+        if(prev_state == round_playing && ctx.state != round_playing)
+        {
+            bin = 0;
+            while(bin < RALLY_BINS - 1 && (1u << bin) <= ctx.rally)
+                bin++;
+            st->rally_hist[bin]++;
+            st->rallies++;
+            st->hits += ctx.rally;
+            if(ctx.rally > st->rally_max)
+                st->rally_max = ctx.rally;
+        }
+
+        /* Scores are reset as the match ends */
+        if(ctx.state == match_end)
+        {
+            i = ctx.winning_player == player_1 ? 0 : 1;
+            st->scores[i][prev_score[!i]]++;
+            break;
+        }
+    }
+    if(step == SIM_MAX_STEPS)
+        st->timeouts++;
+    st->steps += step;
+    st->matches++;
+}
+
+/* Brief  : Takes a task from the tail of the worker's own queue
+ * Author : Rasmus Kallqvist */
+static int sim_pop(struct sim_deque *dq, struct sim_task *task)
+{
+    int found = 0;
+
+    pthread_mutex_lock(&dq->lock);
+    if(dq->tail > dq->head)
+    {
+        *task = dq->tasks[--dq->tail];
+        found = 1;
+    }
+    pthread_mutex_unlock(&dq->lock);
+    return found;
+}
+
+/* Brief  : Takes a task from the head of another worker's queue
+ * Author : Rasmus Kallqvist */
+static int sim_steal(struct sim_deque *dq, struct sim_task *task)
+{
+    int found = 0;
+
+    pthread_mutex_lock(&dq->lock);
+    if(dq->tail > dq->head)
+    {
+        *task = dq->tasks[dq->head++];
+        found = 1;
+    }
+    pthread_mutex_unlock(&dq->lock);
+    return found;
+}
+
+/* Brief  : Worker thread, runs its own tasks and then steals from the others
+ *          until every queue is empty. No tasks are added once started.
+ * Author : Rasmus Kallqvist */
+static void *sim_work(void *arg)
+{
+    struct sim_worker *w = arg;
+    struct sim_task task;
+    struct sim_stats *st;
+    uint64_t rng = sim_seed + w->id;
+    uint32_t i, victim;
+    double t0;
+    int found;
+
+    for(;;)
+    {
+        found = sim_pop(&w->deque, &task);
+
+        /* Steal, starting from a random victim */
+        victim = rng_next(&rng) % sim_num_workers;
+        for(i = 0; !found && i < sim_num_workers; i++)
+        {
+            if((victim + i) % sim_num_workers == w->id)
+                continue;
+            found = sim_steal(&sim_workers[(victim + i) % sim_num_workers].deque,
+                              &task);
+            w->steals += found;
+        }
+        if(!found)
+            break;
+
+        st = &w->stats[task.set];
+        t0 = sim_time();
+        for(i = 0; i < task.count; i++)
+            sim_match(&sim_sets[task.set], task.first + i, st);
+        st->seconds += sim_time() - t0;
+    }
+    return 0;
+}
+
+/* Brief  : Parses a bot given as track[:error[:speed]], random[:speed],
+ *          script:file or ai[:level]. Error and speed are in pixels.
+ * Author : Rasmus Kallqvist */
+static int parse_bot(const char *spec, struct bot *bot)
+{
+    static uint16_t scripts[2][SCRIPT_MAX];
+    static int num_scripts;
+    double error = 9.0, speed = 1.0;
+    unsigned value;
+    FILE *f;
+
+    memset(bot, 0, sizeof(*bot));
+    if(!strncmp(spec, "script:", 7))
+    {
+        if(num_scripts == 2 || !(f = fopen(spec + 7, "r")))
+            return -1;
+        bot->kind = bot_script;
+        bot->script = scripts[num_scripts];
+        while(bot->script_len < SCRIPT_MAX && fscanf(f, "%u", &value) == 1)
+            scripts[num_scripts][bot->script_len++] = value > 1023 ? 1023 :
+                                                                     value;
+        fclose(f);
+        num_scripts++;
+        return bot->script_len ? 0 : -1;
+    }
+    if(!strncmp(spec, "ai", 2))
+    {
+        bot->kind = bot_ai;
+        bot->level = AI_LEVELS - 1;
+        if(sscanf(spec + 2, ":%u", &value) == 1)
+            bot->level = value;
+        return bot->level < AI_LEVELS ? 0 : -1;
+    }
+    if(!strncmp(spec, "random", 6))
+    {
+        bot->kind = bot_random;
+        sscanf(spec + 6, ":%lf", &speed);
+    }
+    else if(!strncmp(spec, "track", 5))
+    {
+        bot->kind = bot_track;
+        sscanf(spec + 5, ":%lf:%lf", &error, &speed);
+    }
+    else
+        return -1;
+    bot->error = FIX_CONST(error);
+    bot->speed = FIX_CONST(speed);
+    return bot->speed > 0 ? 0 : -1;
+}
+
+/* Brief  : Parses a grid axis given as a single value or lo:hi:count
+ * Author : Rasmus Kallqvist */
+static int parse_axis(const char *spec, struct sim_axis *axis)
+{
+    double lo, hi;
+    unsigned count, i;
+    int n = sscanf(spec, "%lf:%lf:%u", &lo, &hi, &count);
+
+    if(n == 1)
+    {
+        hi = lo;
+        count = 1;
+    }
+    else if(n != 3 || count < 1 || count > SIM_MAX_AXIS)
+        return -1;
+    for(i = 0; i < count; i++)
+        axis->values[i] = count > 1 ? lo + (hi - lo) * i / (count - 1) : lo;
+    axis->count = count;
+    return 0;
+}
+
+/* Brief  : Prints a summary of one constant set
+ * Author : Rasmus Kallqvist */
+static void print_set(uint32_t set, const struct pong_params *p,
+                      const struct sim_stats *st)
+{
+    uint32_t i, j;
+    uint64_t wins = 0;
+
+    for(j = 0; j < MATCH_SCORE; j++)
+        wins += st->scores[0][j];
+
+    printf("set %u: speedup %.3f maxspeed %.2f racket %ux%u edge %u\n",
+           set, p->ball_speedup / (double)FIX_ONE,
+           p->ball_maxspeed / (double)FIX_ONE, p->racket_w, p->racket_h,
+           p->edge_offset);
+    printf("  matches %llu  %.0f/s  p1 wins %.1f%%  timeouts %llu"
+           "  game time %.1f s/match\n",
+           (unsigned long long)st->matches,
+           st->seconds > 0 ? st->matches / st->seconds : 0.0,
+           st->matches ? 100.0 * wins / st->matches : 0.0,
+           (unsigned long long)st->timeouts,
+           st->matches ? (double)st->steps / st->matches / PONG_UPDATE_HZ : 0);
+    printf("  rally   mean %.2f  max %llu  |",
+           st->rallies ? (double)st->hits / st->rallies : 0.0,
+           (unsigned long long)st->rally_max);
+    for(i = 0; i < RALLY_BINS; i++)
+    {
+        if(!st->rally_hist[i])
+            continue;
+        if(i < 2)
+            printf(" %u:%llu", i, (unsigned long long)st->rally_hist[i]);
+        else
+            printf(" %u-%u:%llu", 1u << (i - 1), (1u << i) - 1,
+                   (unsigned long long)st->rally_hist[i]);
+    }
+    printf("\n  scores |");
+    for(i = 0; i < 2; i++)
+        for(j = 0; j < MATCH_SCORE; j++)
+            if(st->scores[i][j])
+                printf(" %u-%u:%llu", i ? j : MATCH_SCORE, i ? MATCH_SCORE : j,
+                       (unsigned long long)st->scores[i][j]);
+    printf("\n");
+}
+
+/* Brief  : Prints command line usage
+ * Author : Rasmus Kallqvist */
+static void usage(const char *name)
+{
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  -n matches   matches per constant set (10000), a core plays\n"
+        "               some 1700 a second\n"
+        "  -j threads   worker threads (all cores)\n"
+        "  -s seed      seed of the bots (1)\n"
+        "  -S speedup   ball speedup per racket hit (1.1)\n"
+        "  -M speed     max ball speed, pixels per 1/%d s (4)\n"
+        "  -W width     racket width, 1 to 8 (%d)\n"
+        "  -H height    racket height, 1 to 31 (%d)\n"
+        "  -E offset    racket distance from screen edge (%d)\n"
+        "  -1 bot, -2 bot\n"
+        "               player bots: track[:error[:speed]] (track:9:1),\n"
+        "               random[:speed], script:file of values 0-1023\n"
+        "               or ai[:level], levels 0-%d, player 2 only\n"
+        "Constants are a value or lo:hi:count, every combination is played.\n",
+        name, PONG_SPEED_HZ, RACKET_W, RACKET_H, RACKET_EDGE_OFFSET,
+        AI_LEVELS - 1);
+}
+
+/* Brief  : Parses options, builds the constant grid, runs the workers and
+ *          prints the results
+ * Author : Rasmus Kallqvist */
+int main(int argc, char **argv)
+{
+    struct sim_axis speedup, maxspeed, width, height, edge;
+    struct sim_axis *axes[5] = {&speedup, &maxspeed, &width, &height, &edge};
+    struct sim_stats *total, *a, *b;
+    struct sim_worker *w;
+    struct pong_params *p;
+    uint32_t matches = 10000, chunks, num_tasks, t, i, j, k;
+    uint64_t all_matches = 0, steals = 0;
+    double t0, wall;
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int opt, err = 0;
+
+    for(i = 0; i < 5; i++)
+        axes[i]->count = 1;
+    speedup.values[0] = BALL_SPEEDUP / (double)FIX_ONE;
+    maxspeed.values[0] = BALL_MAXSPEED / (double)FIX_ONE;
+    width.values[0] = RACKET_W;
+    height.values[0] = RACKET_H;
+    edge.values[0] = RACKET_EDGE_OFFSET;
+    parse_bot("track", &sim_bots[0]);
+    parse_bot("track", &sim_bots[1]);
+    sim_num_workers = cores > 0 ? cores : 1;
+
+    while((opt = getopt(argc, argv, "n:j:s:S:M:W:H:E:1:2:h")) != -1)
+    {
+        switch(opt)
+        {
+            case 'n': matches = strtoul(optarg, 0, 0); break;
+            case 'j': sim_num_workers = strtoul(optarg, 0, 0); break;
+            case 's': sim_seed = strtoull(optarg, 0, 0); break;
+            case 'S': err |= parse_axis(optarg, &speedup); break;
+            case 'M': err |= parse_axis(optarg, &maxspeed); break;
+            case 'W': err |= parse_axis(optarg, &width); break;
+            case 'H': err |= parse_axis(optarg, &height); break;
+            case 'E': err |= parse_axis(optarg, &edge); break;
+            case '1': err |= parse_bot(optarg, &sim_bots[0]); break;
+            case '2': err |= parse_bot(optarg, &sim_bots[1]); break;
+            default: err = -1; break;
+        }
+    }
+    if(err || optind != argc || !matches || !sim_num_workers ||
+       sim_bots[0].kind == bot_ai ||
+       sim_num_workers > SIM_MAX_THREADS)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    /* Every combination of the axes */
+    sim_num_sets = 1;
+    for(i = 0; i < 5; i++)
+        sim_num_sets *= axes[i]->count;
+    sim_sets = calloc(sim_num_sets, sizeof(*sim_sets));
+    for(i = 0; i < sim_num_sets; i++)
+    {
+        p = &sim_sets[i];
+        k = i;
+        p->ball_speedup = FIX_CONST(speedup.values[k % speedup.count]);
+        k /= speedup.count;
+        p->ball_maxspeed = FIX_CONST(maxspeed.values[k % maxspeed.count]);
+        k /= maxspeed.count;
+        p->racket_w = width.values[k % width.count] + 0.5;
+        k /= width.count;
+        p->racket_h = height.values[k % height.count] + 0.5;
+        k /= height.count;
+        p->edge_offset = edge.values[k % edge.count] + 0.5;
+        if(p->racket_w < 1 || p->racket_w > 8 || p->racket_h < 1 ||
+           p->racket_h > 31 || 2 * (p->edge_offset + p->racket_w) >= 127 ||
+           p->ball_maxspeed <= 0)
+        {
+            fprintf(stderr, "set %u: constants out of range\n", i);
+            return 1;
+        }
+    }
+
+    /* Tasks are handed out in blocks, stealing evens out sets that take
+       longer to play */
+    chunks = (matches + SIM_CHUNK - 1) / SIM_CHUNK;
+    num_tasks = sim_num_sets * chunks;
+    sim_workers = calloc(sim_num_workers, sizeof(*sim_workers));
+    t = 0;
+    for(i = 0; i < sim_num_workers; i++)
+    {
+        w = &sim_workers[i];
+        w->id = i;
+        w->stats = calloc(sim_num_sets, sizeof(*w->stats));
+        w->deque.tasks = calloc(num_tasks / sim_num_workers + 1,
+                                sizeof(struct sim_task));
+        pthread_mutex_init(&w->deque.lock, 0);
+        for(; t < (uint64_t)num_tasks * (i + 1) / sim_num_workers; t++)
+        {
+            j = t % chunks;
+            w->deque.tasks[w->deque.tail].set = t / chunks;
+            w->deque.tasks[w->deque.tail].first = j * SIM_CHUNK;
+            w->deque.tasks[w->deque.tail].count =
+                j == chunks - 1 ? matches - j * SIM_CHUNK : SIM_CHUNK;
+            w->deque.tail++;
+        }
+    }
+
+    t0 = sim_time();
+    for(i = 0; i < sim_num_workers; i++)
+        pthread_create(&sim_workers[i].thread, 0, sim_work, &sim_workers[i]);
+    for(i = 0; i < sim_num_workers; i++)
+        pthread_join(sim_workers[i].thread, 0);
+    wall = sim_time() - t0;
+
+    /* Sum up the workers' results per set */
+    total = calloc(sim_num_sets, sizeof(*total));
+    for(i = 0; i < sim_num_workers; i++)
+    {
+        steals += sim_workers[i].steals;
+        for(j = 0; j < sim_num_sets; j++)
+        {
+            a = &total[j];
+            b = &sim_workers[i].stats[j];
+            a->matches += b->matches;
+            a->timeouts += b->timeouts;
+            a->rallies += b->rallies;
+            a->hits += b->hits;
+            a->steps += b->steps;
+            a->seconds += b->seconds;
+            if(b->rally_max > a->rally_max)
+                a->rally_max = b->rally_max;
+            for(k = 0; k < RALLY_BINS; k++)
+                a->rally_hist[k] += b->rally_hist[k];
+            for(k = 0; k < 2 * MATCH_SCORE; k++)
+                a->scores[k / MATCH_SCORE][k % MATCH_SCORE] +=
+                    b->scores[k / MATCH_SCORE][k % MATCH_SCORE];
+        }
+    }
+    for(i = 0; i < sim_num_sets; i++)
+    {
+        print_set(i, &sim_sets[i], &total[i]);
+        all_matches += total[i].matches;
+    }
+    printf("%llu matches in %.2f s, %.0f matches/s on %u threads, "
+           "%llu steals\n", (unsigned long long)all_matches, wall,
+           all_matches / wall, sim_num_workers, (unsigned long long)steals);
+    return 0;
+}
@@ -0,0 +1,156 @@
+/*
+********************************************************************************
+* name   :  test_adc.c
+* author :  Rasmus Kallqvist, 2017
+* brief  :  Host test of the ADC scan in input.c. Checks the registers set
+*           by init_adc() against the PIC32 reference manual, then runs a
+*           model of the scan: the channels in AD1CSSL are converted in
+*           rising order into one half of the result buffers, 16 bytes
+*           apart, until the SMPI count is reached and the interrupt is
+*           raised. The ADC then goes on converting into the other half,
+*           which holds the next results when the interrupt handler runs.
+*           Checks that each analog input reads its own pin, that unused
+*           pins and channels and the half being filled are ignored, and
+*           that input_get_analogs() counts the latched values. Built and run by make check, see the Makefile.
+********************************************************************************
+*/
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "board.h"
+#include "input.c"
+
+/* Defines -------------------------------------------------------------------*/
+#define ADC_IRQ         (0x1 << 1)      /* IFS(1) and IEC(1) bit */
+#define BUFM            (0x1 << 1)      /* AD1CON2 split buffers */
+#define BUFS            (0x1 << 7)      /* AD1CON2 upper half being filled */
+#define SCAN_PINS       ((0x1 << 2) | (0x1 << 4) | (0x1 << 8)) /* A0 to A2 */
+#define INTERRUPTS      4000
+#define MOVE_EVERY      100     /* Interrupts between moves of a pin */
+
+/* Local variables -----------------------------------------------------------*/
+static uint16_t pin_level[16];          /* Voltage on AN0 to AN15, 0 - 1023 */
+static int upper;                       /* Half of the buffers being filled */
+
+/* Function definitions ------------------------------------------------------*/
+/* Brief  : Converts the scanned channels into the result buffers like the
+ *          ADC, until SMPI + 1 results are done, and runs the interrupt
+ *          handler. With split buffers the ADC has gone on converting into
+ *          the other half by then, with values of its own. Returns the
+ *          number of results.
+ * Author : Rasmus Kallqvist */
+static int adc_interrupt(void)
+{
+    uint32_t results = ((AD1CON2 >> 2) & 0xF) + 1;
+    uint32_t scan = AD1CSSL;
+    uint32_t first = AD1CON2 & BUFM ? 8 * upper : 0;
+    uint32_t k = 0;
+    int ch = 0;
+
+    while(k < results)
+    {
+        if(scan >> ch & 0x1)
+            board_regs[BOARD_ADC1BUF(first + k++)] = pin_level[ch];
+        ch = (ch + 1) & 0xF;
+    }
+    if(AD1CON2 & BUFM)
+    {
+        upper = !upper;
+        if(upper)
+            AD1CON2 |= BUFS;
+        else
+            AD1CON2 &= ~BUFS;
+        for(ch = 0; ch < 8; ch++)
+            board_regs[BOARD_ADC1BUF(8 * upper + ch)] = rand() % 1024;
+    }
+    IFSSET(1) = ADC_IRQ;
+    if(IEC(1) & ADC_IRQ)
+        input_adc_isr();
+    CHECK(!(IFS(1) & ADC_IRQ));
+    return k;
+}
+
+/* Brief  : Returns non-zero if every analog input is within the deadband
+ *          of the level on its pin
+ * Author : Rasmus Kallqvist */
+static int inputs_follow_pins(void)
+{
+    uint8_t i;
+
+    for(i = 0; i < ADC_SCAN_COUNT; i++)
+        if(abs(input_get_analog(i) - pin_level[analog_pin_nr[i]]) >
+           INPUT_DEADBAND)
+            return 0;
+    return 1;
+}
+
+int main(void)
+{
+    uint16_t values[ADC_SCAN_COUNT];
+    uint32_t latched;
+    int i, ch, results = 0;
+
+    board_reset();
+    AD1PCFG = 0xFFFF;                   /* All pins digital at reset */
+    init_adc();
+
+    /* Scan A0 to A2, the AN2, AN4 and AN8 pins, as analog inputs */
+    CHECK(AD1CSSL == SCAN_PINS);
+    CHECK((AD1PCFG & SCAN_PINS) == 0 && (AD1PCFG | SCAN_PINS) == 0xFFFF);
+    CHECK((TRISB & SCAN_PINS) == SCAN_PINS);
+
+    /* Integer format, auto convert, auto sample, turned on last */
+    CHECK(((AD1CON1 >> 8) & 0x7) == 0x4);
+    CHECK(((AD1CON1 >> 5) & 0x7) == 0x7);
+    CHECK(AD1CON1 & (0x1 << 2));
+    CHECK(AD1CON1 & (0x1 << 15));
+
+    /* Scan mode, two 8 word buffers, interrupt after the scans of one,
+       which latch a value every INPUT_OVERSAMPLE scans */
+    CHECK(AD1CON2 & (0x1 << 10));
+    CHECK(AD1CON2 & BUFM);
+    CHECK(((AD1CON2 >> 2) & 0xF) == ADC_SCAN_COUNT * ADC_IRQ_SCANS - 1);
+    CHECK(ADC_SCAN_COUNT * ADC_IRQ_SCANS <= 8);
+    CHECK(INPUT_OVERSAMPLE % ADC_IRQ_SCANS == 0);
+
+    /* Interrupt enabled at priority 7, flag clear */
+    CHECK(IEC(1) & ADC_IRQ);
+    CHECK(((IPC(6) >> 26) & 0x7) == 7);
+    CHECK(!(IFS(1) & ADC_IRQ));
+
+    /* Nothing latched before the first interrupt */
+    CHECK(input_get_analogs(values) == 0 && values[0] == 0);
+
+    /* Distinct levels on each pin, and on pins that are not scanned */
+    srand(21);
+    for(ch = 0; ch < 16; ch++)
+        pin_level[ch] = rand() % 1024;
+    for(i = 1; i <= INTERRUPTS; i++)
+    {
+        /* Move one pin now and then, and let the filter settle */
+        if(i % MOVE_EVERY == 0)
+            pin_level[analog_pin_nr[rand() % ADC_SCAN_COUNT]] = rand() % 1024;
+        if(i % MOVE_EVERY == MOVE_EVERY / 5)
+            pin_level[rand() % 16] = rand() % 1024;
+        results += adc_interrupt();
+
+        latched = input_get_analogs(values);
+        CHECK(latched == (uint32_t) i / (INPUT_OVERSAMPLE / ADC_IRQ_SCANS));
+        for(ch = 0; ch < ADC_SCAN_COUNT; ch++)
+            CHECK(values[ch] == input_get_analog(ch));
+        CHECK(input_get_analog(ADC_SCAN_COUNT) == 0);
+        if(i % MOVE_EVERY >= MOVE_EVERY * 4 / 5 && !CHECK(inputs_follow_pins()))
+        {
+            printf("interrupt %d: %d %d %d, pins %d %d %d\n", i, values[0],
+                   values[1], values[2], pin_level[2], pin_level[4],
+                   pin_level[8]);
+            break;
+        }
+    }
+    printf("%d interrupts of %d results, each input follows its own pin\n",
+           INTERRUPTS, results / INTERRUPTS);
+
+    return board_result("test_adc");
+}
@@ -0,0 +1,228 @@
+/*
+********************************************************************************
+* name   :  test_ai.c
+* author :  Rasmus Kallqvist, 2017
+* brief  :  Host test and benchmark of the computer player in ai.c. Checks
+*           ai_intercept() against the ball moved on with pong_update_ball()
+*           until it reaches the right racket, for random shots bouncing
+*           off the roof and floor any number of times. Then times
+*           ai_work() per update step of a game against a player that
+*           simulates the ball forward every step, and ai_intercept()
+*           against that simulation for short and long shots. Built and run
+*           by make check, see the Makefile.
+********************************************************************************
+*/
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "board.h"
+#include "pong.c"
+#include "ai.c"
+
+/* Defines -------------------------------------------------------------------*/
+#define SHOTS           100000
+#define TIMED_SHOTS     20000
+#define GAME_STEPS      500000
+
+/* Local variables -----------------------------------------------------------*/
+static uint32_t lcg = 1;    /* Own generator, the same with any libc */
+static volatile int32_t sink;
+
+/* Function definitions ------------------------------------------------------*/
+/* Brief  : Returns the next 16 bit pseudo random number
+ * Author : Rasmus Kallqvist */
+static uint32_t next_rand(void)
+{
+    lcg = lcg * 1103515245u + 12345u;
+    return lcg >> 16;
+}
+
+/* Brief  : Sets up a random shot towards the right racket in ctx, from
+ *          between the rackets, at most max_run pixels from it
+ * Author : Rasmus Kallqvist */
+static void random_shot(struct pong_ctx *ctx, int max_run)
+{
+    int32_t plane;
+
+    pong_setup(ctx);
+    ctx->state = round_playing;
+    plane = ctx->right_racket.x - FIX_FROM_INT(ctx->ball.w);
+    ctx->ball.x = plane - (int32_t) ((next_rand() << 16 | next_rand()) %
+                                     (uint32_t) FIX_FROM_INT(max_run));
+    ctx->ball.y = FIX_FROM_INT(FIELD_TOP) +
+                  (int32_t) ((next_rand() << 16 | next_rand()) %
+                             (uint32_t) FIX_FROM_INT(FIELD_BOTTOM -
+                                                     FIELD_TOP -
+                                                     ctx->ball.h));
+    ctx->ball.dx = FIX_ONE / 2 +
+                   (int32_t) ((next_rand() << 16 | next_rand()) %
+                              (uint32_t) (BALL_MAXSPEED - FIX_ONE / 2));
+    ctx->ball.dy = (int32_t) ((next_rand() << 16 | next_rand()) %
+                              (uint32_t) (2 * BALL_MAXSPEED + 1)) -
+                   BALL_MAXSPEED;
+}
+
+/* Brief  : Moves the ball of ctx on with pong_update_ball(), the rackets out
+ *          of its way, until it reaches the right racket. Returns the row it
+ *          is at there, between the positions of the steps before and after,
+ *          and counts the steps in steps.
+ * Author : Rasmus Kallqvist */
+static int32_t simulate(struct pong_ctx *ctx, uint32_t *steps)
+{
+    int32_t plane = ctx->right_racket.x - FIX_FROM_INT(ctx->ball.w);
+    int32_t top = FIX_FROM_INT(FIELD_TOP);
+    int32_t bottom = FIX_FROM_INT(FIELD_BOTTOM - ctx->ball.h);
+    int32_t x, y, dy;
+    int64_t run;
+
+    if(ctx->ball.dx <= 0 || ctx->ball.x >= plane)
+        return ctx->ball.y;
+    ctx->left_racket.y = FIX_FROM_INT(100);
+    ctx->right_racket.y = FIX_FROM_INT(100);
+    for(;;)
+    {
+        x = ctx->ball.x;
+        y = ctx->ball.y;
+        dy = ctx->ball.dy;
+        pong_update_ball(ctx);
+        (*steps)++;
+        if(ctx->ball.x >= plane)
+            break;
+    }
+
+    /* Along the step's motion up to the racket, mirrored at a wall if it
+       crossed one on the way */
+    run = (int64_t) (plane - x) * FIX_MUL(dy, BALL_STEP) /
+          FIX_MUL(ctx->ball.dx, BALL_STEP);
+    y += (int32_t) run;
+    if(y < top)
+        y = 2 * top - y;
+    if(y > bottom)
+        y = 2 * bottom - y;
+    return y;
+}
+
+/* Brief  : Plan of a player that simulates the ball forward, as ai_plan()
+ *          would without ai_intercept()
+ * Author : Rasmus Kallqvist */
+static int32_t simulate_plan(const struct pong_ctx *ctx)
+{
+    struct pong_ctx c = *ctx;
+    uint32_t steps = 0;
+
+    return simulate(&c, &steps);
+}
+
+/* Brief  : Returns the nanoseconds per shot of planning TIMED_SHOTS random
+ *          shots of at most max_run pixels, with ai_intercept() or by
+ *          simulating forward
+ * Author : Rasmus Kallqvist */
+static double time_plans(int max_run, int simulated)
+{
+    static struct pong_ctx shots[TIMED_SHOTS];
+    double t;
+    int i;
+
+    lcg = 2;
+    for(i = 0; i < TIMED_SHOTS; i++)
+        random_shot(&shots[i], max_run);
+    t = board_seconds();
+    for(i = 0; i < TIMED_SHOTS; i++)
+        sink = simulated ? simulate_plan(&shots[i]) : ai_intercept(&shots[i]);
+    return (board_seconds() - t) * 1e9 / TIMED_SHOTS;
+}
+
+int main(void)
+{
+    struct pong_ctx ctx, sim;
+    struct pong_ai ai;
+    uint16_t analogs[2];
+    uint32_t steps = 0, plans = 0, turns = 0, bounced = 0, n, i;
+    int32_t err, max_err = 0, allowed, a, b;
+    uint8_t planned, moving_right;
+    double t, t_work, t_sim, near[2], far[2];
+
+    /* Random shots, row at the racket as the game plays it */
+    for(i = 0; i < SHOTS; i++)
+    {
+        random_shot(&ctx, 50);
+        sim = ctx;
+        n = steps;
+        a = ai_intercept(&ctx);
+        b = simulate(&sim, &steps);
+        n = steps - n;
+        err = FIX_ABS(a - b);
+        max_err = err > max_err ? err : max_err;
+
+        /* The game rounds the motion of each step down, by up to 1/65536
+           pixel in x and in y. Rounding in x moves where the ball meets
+           the racket along its path, as much more in y as it is steep. */
+        allowed = (int32_t) ((int64_t) (n + 1) *
+                             (ctx.ball.dx + FIX_ABS(ctx.ball.dy)) /
+                             ctx.ball.dx) + 1;
+        bounced += FIX_ABS((int64_t) (sim.right_racket.x - ctx.ball.x) *
+                           ctx.ball.dy / ctx.ball.dx) >
+                   FIX_FROM_INT(FIELD_BOTTOM - FIELD_TOP);
+        if(!CHECK(err <= allowed))
+        {
+            printf("shot %u: intercept %.4f, simulated %.4f\n", (unsigned) i,
+                   a / 65536.0, b / 65536.0);
+            break;
+        }
+    }
+    CHECK(bounced > SHOTS / 4);
+    printf("%d shots, %.1f steps each, %u off a wall at least once: "
+           "intercept off by %.5f pixels at most\n", SHOTS,
+           (double) steps / SHOTS, (unsigned) bounced, max_err / 65536.0);
+
+    /* Balls moving away or past the racket stay where they are */
+    random_shot(&ctx, 50);
+    ctx.ball.dx = -ctx.ball.dx;
+    CHECK(ai_intercept(&ctx) == ctx.ball.y);
+    ctx.ball.dx = -ctx.ball.dx;
+    ctx.ball.x = ctx.right_racket.x;
+    CHECK(ai_intercept(&ctx) == ctx.ball.y);
+
+    /* A game against the hardest level. ai_work() plans once per turn of
+       the ball or change of state, the rest of the steps only move the
+       knob. The simulating player plans every step. */
+    pong_setup(&ctx);
+    ai_setup(&ai, &ctx, AI_LEVELS - 1, 20);
+    moving_right = ai.moving_right;
+    t_work = t_sim = 0;
+    for(i = 0; i < GAME_STEPS; i++)
+    {
+        analogs[0] = (uint16_t) (FIX_ROUND(ctx.ball.y) * 1023 / 31);
+        planned = ai.planned;
+        turns += (ctx.ball.dx > 0) != moving_right || ctx.state != ai.state;
+        moving_right = ctx.ball.dx > 0;
+        t = board_seconds();
+        analogs[1] = ai_work(&ai, &ctx);
+        t_work += board_seconds() - t;
+        plans += ai.planned && !planned;
+        t = board_seconds();
+        sink = simulate_plan(&ctx);
+        t_sim += board_seconds() - t;
+        pong_update_step(&ctx, analogs);
+    }
+    CHECK(plans > 0 && plans <= turns);
+    printf("game of %d steps, %u plans: ai_work() %.1f ns per step, "
+           "simulating forward %.1f ns per step\n", GAME_STEPS,
+           (unsigned) plans, t_work * 1e9 / GAME_STEPS,
+           t_sim * 1e9 / GAME_STEPS);
+
+    /* The intercept costs the same however far the ball has to go, after
+       a run to warm up */
+    time_plans(50, 0);
+    near[0] = time_plans(5, 0);
+    near[1] = time_plans(5, 1);
+    far[0] = time_plans(50, 0);
+    far[1] = time_plans(50, 1);
+    printf("plan of a shot over 5 and 50 pixels: ai_intercept() %.1f and "
+           "%.1f ns, simulating forward %.1f and %.1f ns\n", near[0], far[0],
+           near[1], far[1]);
+
+    return board_result("test_ai");
+}
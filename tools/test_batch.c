@@ -0,0 +1,183 @@
+/*
+********************************************************************************
+* name   :  test_batch.c
+* author :  Rasmus Kallqvist, 2017
+* brief  :  Host test and benchmark of the batched games in pong_batch.c.
+*           Plays the same games with pong_batch_step() and one by one with
+*           pong_update_step(), with bots that track the ball and miss now
+*           and then, and bots that jerk their rackets about. Every game must
+*           be bit for bit the same after every step, with the rewards and
+*           match ends the scalar games show. Prints the games stepped per
+*           second both ways. Built and run by make check, see the Makefile.
+********************************************************************************
+*/
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "board.h"
+#include "pong.c"
+#include "pong_batch.c"
+
+/* Defines -------------------------------------------------------------------*/
+#define GAMES           4096
+#define STEPS           20000
+#define OTHER_GAMES     512     /* Games with other constants */
+#define JERKY_EVERY     8       /* One game in this many jerks its rackets */
+
+/* Local variables -----------------------------------------------------------*/
+static struct pong_ctx games[GAMES];
+static uint16_t actions[2 * GAMES];
+static uint32_t lcg[GAMES];     /* Own generator per game, for the bots */
+static uint8_t prev_state[GAMES];
+static int32_t prev_score[GAMES];
+
+/* Function definitions ------------------------------------------------------*/
+/* Brief  : Returns the next 16 bit pseudo random number of game i
+ * Author : Rasmus Kallqvist */
+static uint32_t next_rand(uint32_t i)
+{
+    lcg[i] = lcg[i] * 1103515245u + 12345u;
+    return lcg[i] >> 16;
+}
+
+/* Brief  : Returns the analog value that centres a racket on the ball,
+ *          missed by error pixels
+ * Author : Rasmus Kallqvist */
+static uint16_t track(const struct pong_ctx *ctx, const struct actor *racket,
+                      int error)
+{
+    int y = FIX_ROUND(ctx->ball.y) + 1 - racket->h / 2 + error;
+    int range = 32 - racket->h;
+
+    y = FIX_CLAMP(y, 0, range);
+    return (uint16_t) ((y * 1024 + range - 1) / range);
+}
+
+/* Brief  : Sets the actions of the n games from the scalar ones
+ * Author : Rasmus Kallqvist */
+static void bots(uint32_t n)
+{
+    uint32_t i;
+
+    for(i = 0; i < n; i++)
+    {
+        if(i % JERKY_EVERY == 0)
+        {
+            actions[2 * i] = next_rand(i) & 0x3FF;
+            actions[2 * i + 1] = next_rand(i) & 0x3FF;
+            continue;
+        }
+        actions[2 * i] = track(&games[i], &games[i].left_racket,
+                               (int) (next_rand(i) % 25) - 12);
+        actions[2 * i + 1] = track(&games[i], &games[i].right_racket,
+                                   (int) (next_rand(i) % 19) - 9);
+    }
+}
+
+/* Brief  : Returns non-zero if game i of the batch is ctx
+ * Author : Rasmus Kallqvist */
+static int same_game(const struct pong_batch *b, uint32_t i,
+                     const struct pong_ctx *ctx)
+{
+    return b->ball_x[i] == ctx->ball.x && b->ball_y[i] == ctx->ball.y &&
+           b->ball_dx[i] == ctx->ball.dx && b->ball_dy[i] == ctx->ball.dy &&
+           b->left_y[i] == ctx->left_racket.y &&
+           b->right_y[i] == ctx->right_racket.y &&
+           b->pl1_score[i] == ctx->pl1_score &&
+           b->pl2_score[i] == ctx->pl2_score &&
+           b->state[i] == ctx->state &&
+           b->winner[i] == ctx->winning_player &&
+           b->state_us[i] == ctx->state_us && b->rally[i] == ctx->rally;
+}
+
+/* Brief  : Plays n games steps steps both ways with the constants in params
+ *          and checks that they stay the same. Adds the time each way took
+ *          to t. Returns the matches won.
+ * Author : Rasmus Kallqvist */
+static uint32_t play(uint32_t n, uint32_t steps,
+                     const struct pong_params *params, double *t)
+{
+    struct pong_batch *b = pong_batch_create(n, params);
+    int8_t reward;
+    uint32_t i, s, slow = 0, matches = 0, bad = 0;
+    double t0;
+
+    if(!CHECK(b))
+        return 0;
+    pong_batch_reset(b, 19);
+    for(i = 0; i < n; i++)
+    {
+        pong_batch_get(b, i, &games[i]);
+        lcg[i] = i + 1;
+    }
+
+    for(s = 0; s < steps && !bad; s++)
+    {
+        bots(n);
+        t0 = board_seconds();
+        slow += pong_batch_step(b, actions);
+        t[0] += board_seconds() - t0;
+
+        for(i = 0; i < n; i++)
+        {
+            prev_state[i] = games[i].state;
+            prev_score[i] = games[i].pl1_score;
+        }
+        t0 = board_seconds();
+        for(i = 0; i < n; i++)
+            pong_update_step(&games[i], &actions[2 * i]);
+        t[1] += board_seconds() - t0;
+
+        for(i = 0; i < n; i++)
+        {
+            /* A point ends the round, the winner of a match is rewarded */
+            reward = 0;
+            if(prev_state[i] == round_playing &&
+               games[i].state != round_playing)
+            {
+                if(games[i].state == match_end)
+                    reward = games[i].winning_player == player_1 ? 1 : -1;
+                else
+                    reward = games[i].pl1_score != prev_score[i] ? 1 : -1;
+            }
+            if(!same_game(b, i, &games[i]) || b->reward[i] != reward ||
+               b->done[i] != (reward && games[i].state == match_end))
+            {
+                if(bad++ < 5)
+                    printf("step %u, game %u differs\n", (unsigned) s,
+                           (unsigned) i);
+            }
+            matches += b->done[i];
+        }
+    }
+    CHECK(bad == 0);
+    CHECK(slow < (uint64_t) n * steps / 4);
+    pong_batch_destroy(b);
+    return matches;
+}
+
+int main(void)
+{
+    static const struct pong_params other =
+    {
+        FIX_CONST(1.45), FIX_CONST(6.5), 2, 8, 20
+    };
+    double t[2] = {0, 0}, u[2] = {0, 0};
+    uint32_t matches;
+
+    matches = play(GAMES, STEPS, 0, t);
+    CHECK(matches > GAMES / 8);
+    printf("%d games of %d steps, %u matches won, the same stepped one by "
+           "one\n", GAMES, STEPS, (unsigned) matches);
+    printf("games stepped per second: %.3g batched, %.3g one by one\n",
+           GAMES * (double) STEPS / t[0], GAMES * (double) STEPS / t[1]);
+
+    matches = play(OTHER_GAMES, STEPS, &other, u);
+    CHECK(matches > OTHER_GAMES);
+    printf("%d games with other constants, %u matches won, the same\n",
+           OTHER_GAMES, (unsigned) matches);
+
+    return board_result("test_batch");
+}
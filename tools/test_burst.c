@@ -0,0 +1,124 @@
+/*
+********************************************************************************
+* name   :  test_burst.c
+* author :  Rasmus Kallqvist, 2017
+* brief  :  Host test of the paged and burst flush modes in display.c.
+*           Random frames are sent with display_update() or the interrupt
+*           driven flush in each mode, with a draw list frame in between now
+*           and then. Checks that graphic ram matches the front buffer after
+*           every frame, that the command bytes counted by display.c are the
+*           ones the display received, and that burst mode sends each
+*           changed frame as 512 data bytes without commands. Prints the
+*           bytes, command bytes and D/C switches per frame of each mode.
+*           Built and run by make check, see the Makefile.
+********************************************************************************
+*/
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "board.h"
+#include "display.c"
+#include "drawlist.c"
+#include "trig.c"
+
+/* Defines -------------------------------------------------------------------*/
+#define FRAMES          3000
+#define LIST_EVERY      500
+
+/* Function definitions ------------------------------------------------------*/
+/* Brief  : Runs the spi2 interrupt until the flush is done
+ * Author : Rasmus Kallqvist */
+static void run_flush(void)
+{
+    while(display_flush_busy())
+        display_flush_isr();
+}
+
+/* Brief  : Sends a draw list frame and then a cleared game frame
+ * Author : Rasmus Kallqvist */
+static void send_list_frame(void)
+{
+    drawlist_begin();
+    drawlist_text("hello", 3, 5);
+    drawlist_send();
+    run_flush();
+    CHECK(board_ram_matches(screen_front));
+
+    display_cls();
+    display_flush_begin();
+    run_flush();
+}
+
+int main(void)
+{
+    static const char *names[] = {"paged", "burst"};
+    uint32_t bytes, data, cmds, counted, dcs;
+    uint64_t total_bytes, total_cmds, total_dcs;
+    int mode, f;
+
+    board_reset();
+    init_display();
+    CHECK(board_ram_matches(screen_front));
+
+    srand(10);
+    for(mode = display_flush_paged; mode <= display_flush_burst; mode++)
+    {
+        display_set_flush_mode(mode);
+        display_update();
+        board_sync();
+        total_bytes = total_cmds = total_dcs = 0;
+
+        for(f = 0; f < FRAMES; f++)
+        {
+            board_random_frame(1);
+            data = oled.data_bytes;
+            cmds = oled.cmd_bytes;
+            dcs = oled.dc_switches;
+            counted = display_get_cmd_bytes();
+
+            if(rand() % 2)
+            {
+                display_flush_begin();
+                run_flush();
+            }
+            else
+                display_update();
+
+            if(!CHECK(board_ram_matches(screen_front)))
+            {
+                printf("%s mode, frame %d\n", names[mode], f);
+                break;
+            }
+            data = oled.data_bytes - data;
+            cmds = oled.cmd_bytes - cmds;
+            bytes = data + cmds;
+            CHECK(display_get_cmd_bytes() - counted == cmds);
+            if(mode == display_flush_burst &&
+               (!CHECK(data == 0 || data == 4 * DISPLAY_WIDTH) ||
+                !CHECK(cmds == 0)))
+            {
+                printf("burst frame %d: %u data and %u command bytes\n", f,
+                       (unsigned) data, (unsigned) cmds);
+                break;
+            }
+            total_bytes += bytes;
+            total_cmds += cmds;
+            total_dcs += oled.dc_switches - dcs;
+
+            if(f % LIST_EVERY == LIST_EVERY / 2)
+            {
+                send_list_frame();
+                CHECK(board_ram_matches(screen_front));
+            }
+        }
+        printf("%s mode: %.1f bytes, %.2f command bytes and %.2f D/C "
+               "switches per frame\n", names[mode],
+               (double) total_bytes / FRAMES, (double) total_cmds / FRAMES,
+               (double) total_dcs / FRAMES);
+    }
+    CHECK(oled.unpowered_bytes == 0);
+
+    return board_result("test_burst");
+}
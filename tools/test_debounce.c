@@ -0,0 +1,168 @@
+/*
+********************************************************************************
+* name   :  test_debounce.c
+* author :  Rasmus Kallqvist, 2017
+* brief  :  Host test of the button debouncing and the event queue in
+*           input.c. A model of PORTD chatters for 3 ms around each edge of
+*           a button press and is sampled by input_debounce_isr() every
+*           INPUT_SAMPLE_US. Each press and release, and a tap shorter
+*           than a frame, must give exactly one event with the time of its
+*           edge, and a glitch shorter than the debounce time none. Then a
+*           producer thread fills the queue as fast as it can while the
+*           main thread empties it, and every event must come out whole and
+*           in order, or be counted as dropped. Built and run by make check,
+*           see the Makefile.
+********************************************************************************
+*/
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include "board.h"
+#include "input.c"
+
+/* Defines -------------------------------------------------------------------*/
+#define BTN3_PIN        (0x1 << 7)      /* PORTD */
+#define SW0_PIN         (0x1 << 8)
+#define BOUNCE_US       3000
+#define CHATTER_US      50      /* Pin level changes this often in a bounce */
+#define STRESS_EVENTS   1000000
+
+/* Structs -------------------------------------------------------------------*/
+/* Brief  : An event expected from the debouncing, and when its edge was
+ * Author : Rasmus Kallqvist */
+struct expected
+{
+    uint8_t input;
+    uint8_t pressed;
+    uint32_t edge;
+};
+
+/* Local variables -----------------------------------------------------------*/
+static uint32_t now_us;
+static uint32_t next_sample;
+static volatile int producer_done;
+
+/* Function definitions ------------------------------------------------------*/
+/* Brief  : Sets a PORTD pin to level until the time until, chattering for
+ *          bounce microseconds first. Runs the debouncing every
+ *          INPUT_SAMPLE_US meanwhile.
+ * Author : Rasmus Kallqvist */
+static void hold_pin(uint32_t pin, int level, uint32_t until, uint32_t bounce)
+{
+    uint32_t start = now_us;
+    int v;
+
+    for(; now_us < until; now_us += CHATTER_US)
+    {
+        v = now_us - start < bounce ? rand() & 0x1 : level;
+        if(v)
+            board_regs[BOARD_PORTD] |= pin;
+        else
+            board_regs[BOARD_PORTD] &= ~pin;
+        if(now_us >= next_sample)
+        {
+            input_debounce_isr(now_us);
+            next_sample += INPUT_SAMPLE_US;
+        }
+    }
+}
+
+/* Brief  : Puts STRESS_EVENTS numbered events on the queue, as fast as it
+ *          takes them
+ * Author : Rasmus Kallqvist */
+static void *producer(void *arg)
+{
+    struct input_event event;
+    uint32_t i;
+
+    (void) arg;
+    for(i = 0; i < STRESS_EVENTS; i++)
+    {
+        if((i & 0xF) == 0xF)
+            sched_yield();
+        event.time = i;
+        event.input = i * 7 & 0x7;
+        event.pressed = i >> 3 & 0x1;
+        input_event_put(&event);
+    }
+    producer_done = 1;
+    return 0;
+}
+
+int main(void)
+{
+    static const struct expected expect[] =
+    {
+        {INPUT_BTN(3), 1, 20000},       /* Press, bouncing            */
+        {INPUT_BTN(3), 0, 80000},       /* Release, bouncing          */
+        {INPUT_BTN(3), 1, 200000},      /* Tap, shorter than a frame  */
+        {INPUT_BTN(3), 0, 207000},
+        {INPUT_SW(0), 1, 260000},       /* Switch on                  */
+    };
+    struct input_event event;
+    pthread_t thread;
+    uint32_t got = 0, bad = 0, last = 0;
+    int n = 0, first = 1, done;
+
+    board_reset();
+    init_btn();
+    srand(23);
+
+    hold_pin(BTN3_PIN, 0, 20000, 0);
+    hold_pin(BTN3_PIN, 1, 80000, BOUNCE_US);
+    hold_pin(BTN3_PIN, 0, 140000, BOUNCE_US);
+    hold_pin(BTN3_PIN, 1, 143000, 0);       /* Glitch, ignored */
+    hold_pin(BTN3_PIN, 0, 200000, 0);
+    hold_pin(BTN3_PIN, 1, 207000, 0);
+    hold_pin(BTN3_PIN, 0, 260000, 0);
+    hold_pin(SW0_PIN, 1, 300000, 0);
+
+    while(input_event_get(&event))
+    {
+        printf("%6u us: input %u %s\n", (unsigned) event.time, event.input,
+               event.pressed ? "pressed" : "released");
+        if(!CHECK(n < (int) (sizeof(expect) / sizeof(expect[0]))))
+            break;
+        CHECK(event.input == expect[n].input);
+        CHECK(event.pressed == expect[n].pressed);
+        CHECK(event.time >= expect[n].edge &&
+              event.time <= expect[n].edge + BOUNCE_US);
+        n++;
+    }
+    CHECK(n == sizeof(expect) / sizeof(expect[0]));
+    CHECK(input_events_dropped() == 0);
+
+    /* Queue under stress, the main thread is the main loop */
+    pthread_create(&thread, 0, producer, 0);
+    for(;;)
+    {
+        /* Read before taking, so the last events are not left behind */
+        done = producer_done;
+        if(input_event_get(&event))
+        {
+            if(event.input != (event.time * 7 & 0x7) ||
+               event.pressed != (event.time >> 3 & 0x1) ||
+               (!first && event.time <= last))
+                bad++;
+            last = event.time;
+            first = 0;
+            got++;
+        }
+        else if(done)
+            break;
+        else
+            sched_yield();
+    }
+    pthread_join(thread, 0);
+    CHECK(bad == 0);
+    CHECK(got + input_events_dropped() == STRESS_EVENTS);
+    printf("%d events through the queue: %u taken, %u dropped, %u torn or "
+           "out of order\n", STRESS_EVENTS, (unsigned) got,
+           (unsigned) input_events_dropped(), (unsigned) bad);
+
+    return board_result("test_debounce");
+}
@@ -0,0 +1,88 @@
+/*
+********************************************************************************
+* name   :  test_dirty.c
+* author :  Rasmus Kallqvist, 2017
+* brief  :  Host test of the dirty column tracking in display.c. Checks that
+*           display_update() sends exactly the changed column span of each
+*           changed page, nothing for an unchanged frame, and that the
+*           display graphic ram always ends up equal to the front buffer
+*           over random frames. Prints the bytes sent per frame. Built and
+*           run by make check, see the Makefile.
+********************************************************************************
+*/
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "board.h"
+#include "display.c"
+#include "trig.c"
+
+/* Defines -------------------------------------------------------------------*/
+#define FRAMES          3000
+#define PAGE_CMD_BYTES  5       /* Page address and column, see flush_plan() */
+
+/* Function definitions ------------------------------------------------------*/
+/* Brief  : Sends the back buffer with display_update() and returns the
+ *          command and data bytes it took
+ * Author : Rasmus Kallqvist */
+static uint32_t update_bytes(void)
+{
+    uint32_t before;
+
+    board_sync();
+    before = oled.cmd_bytes + oled.data_bytes;
+    display_update();
+    board_sync();
+    return oled.cmd_bytes + oled.data_bytes - before;
+}
+
+int main(void)
+{
+    uint64_t total = 0;
+    uint32_t bytes;
+    int f;
+
+    board_reset();
+    init_display();
+    CHECK(board_ram_matches(screen_front));
+
+    /* A 3 column racket rows 3 to 14, pages 0 and 1 */
+    display_cls();
+    display_draw_rectfill(10, 3, 13, 15, 1);
+    bytes = update_bytes();
+    CHECK(bytes == 2 * (PAGE_CMD_BYTES + 3));
+    CHECK(board_ram_matches(screen_front));
+
+    /* Moved right by one column, column 10 clears and column 13 sets */
+    display_cls();
+    display_draw_rectfill(11, 3, 14, 15, 1);
+    bytes = update_bytes();
+    CHECK(bytes == 2 * (PAGE_CMD_BYTES + 4));
+    CHECK(board_ram_matches(screen_front));
+
+    /* Same frame again, nothing to send */
+    display_cls();
+    display_draw_rectfill(11, 3, 14, 15, 1);
+    CHECK(update_bytes() == 0);
+
+    /* Drawing the same pixels over again changes nothing either */
+    display_copy_front();
+    display_draw_rectfill(11, 3, 14, 15, 1);
+    CHECK(update_bytes() == 0);
+
+    /* Random frames */
+    srand(1);
+    for(f = 0; f < FRAMES; f++)
+    {
+        board_random_frame(1);
+        total += update_bytes();
+        if(!CHECK(board_ram_matches(screen_front)))
+            break;
+    }
+    printf("random frames: %.1f bytes per frame, a whole frame is %d\n",
+           (double) total / FRAMES, 4 * (PAGE_CMD_BYTES + DISPLAY_WIDTH));
+
+    return board_result("test_dirty");
+}
@@ -0,0 +1,242 @@
+/*
+********************************************************************************
+* name   :  test_drawlist.c
+* author :  Rasmus Kallqvist, 2017
+* brief  :  Host test of the draw list in drawlist.c and the page streaming
+*           in display.c it is sent with. Sends random lists that change a
+*           little from frame to frame, and checks graphic ram against the
+*           same commands drawn with display.c into a buffer of its own.
+*           Checks that a repeated frame sends nothing, that changing a text
+*           sends only the columns it changed, and that a page is sent while
+*           the next one is still being drawn. Built and run by make check,
+*           see the Makefile.
+********************************************************************************
+*/
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "board.h"
+#include "display.c"
+#include "drawlist.c"
+#include "trig.c"
+
+/* Defines -------------------------------------------------------------------*/
+#define FRAMES          3000
+#define MAX_CMDS        6
+#define PAGE_CMD_BYTES  5       /* Page address and column, see flush_plan() */
+
+/* Structs -------------------------------------------------------------------*/
+/* Brief  : A command of a test frame, drawn both ways
+ * Author : Rasmus Kallqvist */
+struct test_cmd
+{
+    uint8_t type;
+    uint8_t col;
+    int x0, y0, x1, y1;
+    const char *text;
+};
+
+/* Local variables -----------------------------------------------------------*/
+static const char *texts[] = {"pong", "press btn4", "pl1 3", "pl2 10", ""};
+static uint32_t ref_words[4][DISPLAY_WIDTH / 4];   /* Immediate drawing */
+static uint8_t (*ref)[128] = (uint8_t (*)[128]) ref_words;
+
+/* Function definitions ------------------------------------------------------*/
+/* Brief  : Runs the spi2 interrupt until the flush is done
+ * Author : Rasmus Kallqvist */
+static void run_flush(void)
+{
+    while(display_flush_busy())
+        display_flush_isr();
+}
+
+/* Brief  : Sends the commands as a draw list and returns the bytes it took.
+ *          Draws them into ref with display.c too.
+ * Author : Rasmus Kallqvist */
+static uint32_t send(const struct test_cmd *cmds, int n)
+{
+    uint32_t before;
+    int i;
+
+    drawlist_begin();
+    for(i = 0; i < n; i++)
+    {
+        switch(cmds[i].type)
+        {
+            case(draw_rect) :
+                drawlist_rect(cmds[i].x0, cmds[i].y0, cmds[i].x1, cmds[i].y1,
+                              cmds[i].col);
+                break;
+            case(draw_rectfill) :
+                drawlist_rectfill(cmds[i].x0, cmds[i].y0, cmds[i].x1,
+                                  cmds[i].y1, cmds[i].col);
+                break;
+            case(draw_text) :
+                drawlist_text((char *) cmds[i].text, cmds[i].x0, cmds[i].y0);
+                break;
+            case(draw_sprite) :
+                drawlist_sprite(&logo_sprite, cmds[i].x0, cmds[i].y0);
+                break;
+            case(draw_dotline) :
+                drawlist_dotline(cmds[i].x0, cmds[i].x1);
+                break;
+        }
+    }
+
+    display_draw_to(ref, 0, 4);
+    display_draw_rectfill(0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT, 0);
+    for(i = 0; i < n; i++)
+    {
+        switch(cmds[i].type)
+        {
+            case(draw_rect) :
+                display_draw_rect(cmds[i].x0, cmds[i].y0, cmds[i].x1,
+                                  cmds[i].y1, cmds[i].col);
+                break;
+            case(draw_rectfill) :
+                display_draw_rectfill(cmds[i].x0, cmds[i].y0, cmds[i].x1,
+                                      cmds[i].y1, cmds[i].col);
+                break;
+            case(draw_text) :
+                display_print((char *) cmds[i].text, cmds[i].x0, cmds[i].y0);
+                break;
+            case(draw_sprite) :
+                display_draw_sprite(&logo_sprite, cmds[i].x0, cmds[i].y0);
+                break;
+            case(draw_dotline) :
+                display_draw_dotline(cmds[i].x0, cmds[i].x1);
+                break;
+        }
+    }
+    display_draw_to(0, 0, 4);
+
+    board_sync();
+    before = oled.cmd_bytes + oled.data_bytes;
+    drawlist_send();
+    run_flush();
+    board_sync();
+    return oled.cmd_bytes + oled.data_bytes - before;
+}
+
+/* Brief  : Returns non-zero if the shown pages of graphic ram equal ref, and
+ *          both screen buffers hold the frame
+ * Author : Rasmus Kallqvist */
+static int ram_matches_ref(void)
+{
+    return board_ram_matches(ref) && board_ram_matches(screen_front) &&
+           !memcmp(screen_back, screen_front, 4 * DISPLAY_WIDTH);
+}
+
+/* Brief  : Makes a random command
+ * Author : Rasmus Kallqvist */
+static void random_cmd(struct test_cmd *c)
+{
+    c->type = rand() % 5;
+    c->col = rand() % 2;
+    c->x0 = rand() % 150 - 10;
+    c->y0 = rand() % 44 - 6;
+    c->x1 = c->type == draw_dotline ? 1 + rand() % 4 : c->x0 + rand() % 40;
+    c->y1 = c->y0 + rand() % 20;
+    c->text = texts[rand() % 5];
+}
+
+int main(void)
+{
+    static const struct test_cmd title[] =
+    {
+        {draw_sprite, 0, 45, 2, 0, 0, 0},
+        {draw_text, 0, 20, 24, 0, 0, "press btn4"},
+    };
+    struct test_cmd cmds[MAX_CMDS], changed[2];
+    uint8_t shown[4][DISPLAY_WIDTH];
+    uint32_t bytes, total = 0, repeats = 0;
+    int f, n = 0, page;
+
+    board_reset();
+    init_display();
+
+    /* The first list frame is sent whole, the same one again not at all */
+    bytes = send(title, 2);
+    CHECK(ram_matches_ref());
+    printf("title screen: %u bytes", (unsigned) bytes);
+    bytes = send(title, 2);
+    CHECK(ram_matches_ref());
+    CHECK(bytes == 0);
+    printf(", %u bytes repeated", (unsigned) bytes);
+
+    /* Changing the text sends only the columns of page 3 it changed */
+    memcpy(changed, title, sizeof(changed));
+    changed[1].text = "press btn3";
+    bytes = send(changed, 2);
+    CHECK(ram_matches_ref());
+    CHECK(bytes > 0 && bytes <= 8 + PAGE_CMD_BYTES);
+    printf(", %u bytes with its text changed\n", (unsigned) bytes);
+
+    /* A frame sent from the screen buffers in between is drawn over */
+    display_cls();
+    display_draw_rectfill(10, 10, 50, 20, 1);
+    display_flush_begin();
+    run_flush();
+    CHECK(send(changed, 2) > 0);
+    CHECK(ram_matches_ref());
+
+    /* A page is sent while the next one is drawn, and the flush starts
+       again when it caught up with the drawing. Pages not drawn yet still
+       show the last frame. */
+    board_sync();
+    memcpy(shown, oled.ram, sizeof(shown));
+    display_stream_begin();
+    for(page = 0; page < 4; page++)
+    {
+        display_draw_to(0, page, 1);
+        display_draw_rectfill(0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT, page & 0x1);
+        display_stream_page(page);
+        CHECK(display_flush_busy());
+        run_flush();
+        board_sync();
+        CHECK(!memcmp(oled.ram[page], screen_back[page], DISPLAY_WIDTH));
+        if(page < 3)
+            CHECK(!memcmp(oled.ram[page + 1], shown[page + 1], DISPLAY_WIDTH));
+    }
+    display_draw_to(0, 0, 4);
+    display_stream_end();
+    CHECK(board_ram_matches(screen_front));
+
+    /* Random lists, most of them only a little different from the last */
+    srand(9);
+    for(f = 0; f < FRAMES; f++)
+    {
+        switch(rand() % 4)
+        {
+            case(0) :
+                if(n < MAX_CMDS)
+                    random_cmd(&cmds[n++]);
+                else
+                    n = rand() % MAX_CMDS;
+                break;
+            case(1) :
+                if(n)
+                    random_cmd(&cmds[rand() % n]);
+                break;
+            case(2) :
+                if(n)
+                    cmds[rand() % n].text = texts[rand() % 5];
+                break;
+        }
+        bytes = send(cmds, n);
+        if(!CHECK(ram_matches_ref()))
+        {
+            printf("frame %d\n", f);
+            break;
+        }
+        total += bytes;
+        if(bytes == 0)
+            repeats++;
+    }
+    printf("random lists: %.1f bytes per frame, %u of %d frames sent "
+           "nothing\n", (double) total / FRAMES, (unsigned) repeats, FRAMES);
+
+    return board_result("test_drawlist");
+}
@@ -0,0 +1,143 @@
+/*
+********************************************************************************
+* name   :  test_effects.c
+* author :  Rasmus Kallqvist, 2017
+* brief  :  Host test of effects.c and the display controller effects in
+*           display.c. Runs the contrast pulse of the menu and a fade frame
+*           by frame against the display model, and checks that each step
+*           only sends a contrast command. Starts hardware scrolls and then
+*           sends frames, with display_update() and with the draw list,
+*           which must stop the scroll before writing graphic ram. Checks
+*           that invert, start line and offset reach the controller. Built
+*           and run by make check, see the Makefile.
+********************************************************************************
+*/
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "board.h"
+#include "display.c"
+#include "drawlist.c"
+#include "effects.c"
+#include "trig.c"
+
+/* Defines -------------------------------------------------------------------*/
+#define PULSE_LOW       0x10    /* Menu pulse, see main.c */
+#define PULSE_HIGH      0xFF
+#define PULSE_FRAMES    30
+#define PULSES          4
+
+/* Function definitions ------------------------------------------------------*/
+/* Brief  : Runs the spi2 interrupt until the flush is done
+ * Author : Rasmus Kallqvist */
+static void run_flush(void)
+{
+    while(display_flush_busy())
+        display_flush_isr();
+    board_sync();
+}
+
+/* Brief  : Steps the running effect by one frame, checks that at most one
+ *          contrast command and no data were sent, and returns the contrast
+ *          of the display
+ * Author : Rasmus Kallqvist */
+static uint8_t step_effect(void)
+{
+    uint32_t cmds = oled.cmd_bytes, data = oled.data_bytes;
+
+    effects_work();
+    board_sync();
+    CHECK(oled.cmd_bytes - cmds == 0 || oled.cmd_bytes - cmds == 2);
+    CHECK(oled.data_bytes == data);
+    return oled.contrast;
+}
+
+int main(void)
+{
+    uint32_t data, hash;
+    uint8_t level, prev;
+    int f, half;
+
+    board_reset();
+    init_display();
+    board_sync();
+    CHECK(oled.contrast == DISPLAY_CONTRAST_DEFAULT);
+
+    /* Pulse rises to high, then falls to low and back, landing exactly on
+       each level at the end of each half */
+    effects_pulse(PULSE_LOW, PULSE_HIGH, PULSE_FRAMES);
+    prev = oled.contrast;
+    for(half = 0; half < 2 * PULSES; half++)
+    {
+        for(f = 0; f < PULSE_FRAMES; f++)
+        {
+            level = step_effect();
+            CHECK(half % 2 ? level <= prev : level >= prev);
+            prev = level;
+        }
+        CHECK(level == (half % 2 ? PULSE_LOW : PULSE_HIGH));
+        CHECK(effects_busy());
+    }
+    effects_stop();
+    board_sync();
+    CHECK(!effects_busy());
+    CHECK(oled.contrast == DISPLAY_CONTRAST_DEFAULT);
+
+    /* Fade ends on its target and stops */
+    effects_fade(0, 10);
+    for(f = 0; f < 10; f++)
+        level = step_effect();
+    CHECK(level == 0 && !effects_busy());
+    step_effect();
+    effects_stop();
+
+    /* Scrolls start in the controller */
+    display_print("scroll", 0, 0);
+    display_update();
+    display_scroll_horizontal(0, 0, 3, CMD_SCROLL_INTERVAL_2);
+    board_sync();
+    CHECK(oled.scroll);
+    display_scroll_diagonal(1, 0, 3, CMD_SCROLL_INTERVAL_2, 1);
+    board_sync();
+    CHECK(oled.scroll);
+
+    /* Sending a frame stops the scroll before writing graphic ram */
+    display_cls();
+    display_print("moved", 10, 10);
+    data = oled.data_bytes;
+    display_update();
+    board_sync();
+    CHECK(!oled.scroll);
+    CHECK(oled.data_bytes > data);
+    CHECK(!memcmp(oled.ram, screen_front, 4 * DISPLAY_WIDTH));
+
+    /* So does sending the draw list */
+    display_scroll_horizontal(0, 0, 3, CMD_SCROLL_INTERVAL_2);
+    drawlist_begin();
+    drawlist_text("x", 0, 0);
+    drawlist_send();
+    run_flush();
+    CHECK(!oled.scroll);
+    CHECK(!memcmp(oled.ram, screen_front, 4 * DISPLAY_WIDTH));
+    CHECK(oled.scroll_writes == 0);
+
+    /* Invert, start line and offset change how ram is shown, not ram */
+    hash = oled_hash();
+    display_set_invert(1);
+    display_set_start_line(5);
+    display_set_offset(3);
+    board_sync();
+    CHECK(oled.invert == 1 && oled.start_line == 5 && oled.offset == 3);
+    CHECK(oled_hash() == hash);
+    display_set_invert(0);
+    display_set_start_line(0);
+    display_set_offset(0);
+    board_sync();
+    CHECK(oled.invert == 0 && oled.start_line == 0 && oled.offset == 0);
+    printf("pulse of %d frames each way, %u command bytes in all\n",
+           PULSE_FRAMES, (unsigned) oled.cmd_bytes);
+
+    return board_result("test_effects");
+}
@@ -0,0 +1,172 @@
+/*
+********************************************************************************
+* name   :  test_fill.c
+* author :  Rasmus Kallqvist, 2017
+* brief  :  Host test and benchmark of the page-major fills in display.c.
+*           Filled and outlined rectangles, anywhere on or off the screen,
+*           and dotted lines are checked pixel by pixel against a plain
+*           reference drawing, and the result is sent to the display model.
+*           The benchmark times the racket, pause box and dotline draws of
+*           the game against drawing the same pixels one at a time with
+*           display_set_pixel(). Built and run by make check, see the
+*           Makefile.
+********************************************************************************
+*/
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "board.h"
+#include "display.c"
+#include "trig.c"
+
+/* Defines -------------------------------------------------------------------*/
+#define SHAPES          200000
+#define BENCH_LOOPS     200000
+
+/* Local variables -----------------------------------------------------------*/
+static uint8_t ref[DISPLAY_HEIGHT][DISPLAY_WIDTH];  /* One byte per pixel */
+
+/* Function definitions ------------------------------------------------------*/
+/* Brief  : Fills the reference from (x0, y0) up to but not including
+ *          (x1, y1), one pixel at a time
+ * Author : Rasmus Kallqvist */
+static void ref_fill(int x0, int y0, int x1, int y1, uint8_t col)
+{
+    int x, y;
+
+    for(y = y0; y < y1; y++)
+        for(x = x0; x < x1; x++)
+            if(x >= 0 && x < DISPLAY_WIDTH && y >= 0 && y < DISPLAY_HEIGHT)
+                ref[y][x] = col;
+}
+
+/* Brief  : Returns non-zero if the back buffer holds the reference
+ * Author : Rasmus Kallqvist */
+static int back_matches_ref(void)
+{
+    int x, y;
+
+    for(y = 0; y < DISPLAY_HEIGHT; y++)
+        for(x = 0; x < DISPLAY_WIDTH; x++)
+            if(((screen_back[y >> 3][x] >> (y & 0x7)) & 0x1) != ref[y][x])
+                return 0;
+    return 1;
+}
+
+/* Brief  : Draws the game's racket, pause box and dotline
+ * Author : Rasmus Kallqvist */
+static void bench_fills(int i)
+{
+    display_draw_rectfill(34, i & 15, 37, (i & 15) + 12, 1);
+    display_draw_rectfill(18, 10, 108, 23, 0);
+    display_draw_rect(18, 10, 108, 23, 1);
+    display_draw_dotline(31, 3);
+}
+
+/* Brief  : Draws the same pixels as bench_fills() one at a time
+ * Author : Rasmus Kallqvist */
+static void bench_pixels(int i)
+{
+    int x, y;
+
+    for(x = 34; x < 37; x++)
+        for(y = i & 15; y < (i & 15) + 12; y++)
+            display_set_pixel(x, y);
+    for(x = 18; x < 108; x++)
+        for(y = 10; y < 23; y++)
+            display_unset_pixel(x, y);
+    for(x = 18; x < 108; x++)
+    {
+        display_set_pixel(x, 10);
+        display_set_pixel(x, 22);
+    }
+    for(y = 10; y < 23; y++)
+    {
+        display_set_pixel(18, y);
+        display_set_pixel(107, y);
+    }
+    for(y = 0; y < DISPLAY_HEIGHT; y++)
+        if((y / 3) % 2 == 0)
+            display_set_pixel(31, y);
+}
+
+int main(void)
+{
+    int i, kind, x0, y0, x1, y1, len, y;
+    uint8_t col;
+    double t, fills, pixels;
+
+    board_reset();
+    init_display();
+
+    /* Random shapes, corners up to a screen width off the screen */
+    srand(4);
+    display_cls();
+    memset(ref, 0, sizeof(ref));
+    for(i = 0; i < SHAPES; i++)
+    {
+        kind = rand() % 3;
+        x0 = rand() % 384 - 128;
+        y0 = rand() % 96 - 32;
+        x1 = x0 + rand() % 40;
+        y1 = y0 + rand() % 24;
+        col = rand() % 2;
+        if(kind == 0)
+        {
+            display_draw_rectfill(x0, y0, x1, y1, col);
+            ref_fill(x0, y0, x1, y1, col);
+        }
+        else if(kind == 1 && x1 > x0 && y1 > y0)
+        {
+            display_draw_rect(x0, y0, x1, y1, col);
+            ref_fill(x0, y0, x1, y0 + 1, col);
+            ref_fill(x0, y1 - 1, x1, y1, col);
+            ref_fill(x0, y0, x0 + 1, y1, col);
+            ref_fill(x1 - 1, y0, x1, y1, col);
+        }
+        else if(kind == 2)
+        {
+            x0 = rand() % 136 - 4;
+            len = 1 + rand() % 8;
+            display_draw_dotline(x0, len);
+            for(y = 0; y < DISPLAY_HEIGHT; y++)
+                if((y / len) % 2 == 0)
+                    ref_fill(x0, y, x0 + 1, y + 1, 1);
+        }
+        if(!CHECK(back_matches_ref()))
+        {
+            printf("shape %d: kind %d (%d,%d)-(%d,%d) col %d\n",
+                   i, kind, x0, y0, x1, y1, col);
+            break;
+        }
+        if(i % 1000 == 999)
+        {
+            display_update();
+            board_sync();
+            CHECK(!memcmp(oled.ram, screen_front, 4 * DISPLAY_WIDTH));
+            display_copy_front();
+        }
+    }
+
+    /* Dotline in the last column */
+    display_cls();
+    display_draw_dotline(127, 1);
+    CHECK(screen_back[0][127] == 0x55 && screen_back[3][127] == 0x55);
+
+    /* Benchmark */
+    t = board_seconds();
+    for(i = 0; i < BENCH_LOOPS; i++)
+        bench_fills(i);
+    fills = board_seconds() - t;
+    t = board_seconds();
+    for(i = 0; i < BENCH_LOOPS; i++)
+        bench_pixels(i);
+    pixels = board_seconds() - t;
+    printf("racket, pause box and dotline: %.0f ns with fills, %.0f ns a "
+           "pixel at a time, %.1fx faster\n", fills * 1e9 / BENCH_LOOPS,
+           pixels * 1e9 / BENCH_LOOPS, pixels / fills);
+
+    return board_result("test_fill");
+}
@@ -0,0 +1,194 @@
+/*
+********************************************************************************
+* name   :  test_filter.c
+* author :  Rasmus Kallqvist, 2017
+* brief  :  Host test of the potentiometer filter in input.c. Feeds noisy
+*           sample streams through the ADC result buffers, one scan every
+*           200 us, and reads the racket row the way pong_update_step()
+*           does, 120 times a second. Holds the potentiometer at positions
+*           across the range, pixel boundaries included, and counts how
+*           often the row flips with raw and with filtered values, for
+*           Gaussian noise and for noise with spikes. Then moves it by
+*           steps and measures the time until the racket settles on its new
+*           row. Built and run by make check, see the Makefile.
+********************************************************************************
+*/
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "board.h"
+#include "input.c"
+
+/* Defines -------------------------------------------------------------------*/
+#define SCAN_US         200     /* One scan of A0 to A2, see init_adc() */
+#define READ_US         (1000000 / 120)     /* PONG_UPDATE_HZ */
+#define RACKET_ROWS     (32 - 12)           /* Rows a racket can be at */
+#define POSITIONS       200
+#define HOLD_US         2000000 /* Time held at each position */
+#define SETTLE_US       100000  /* Not counted after each move */
+#define SPIKE           60      /* Size of a spike, 0 - 1023 units */
+#define MAX_FLIPS       0.1     /* Filtered row flips per second */
+#define MAX_SETTLE_US   (2 * READ_US + 5000)
+
+/* Structs -------------------------------------------------------------------*/
+/* Brief  : Noise on the samples of one test
+ * Author : Rasmus Kallqvist */
+struct noise
+{
+    double sigma;               /* Gaussian, 0 - 1023 units */
+    double spikes;              /* Chance of a spike per sample */
+};
+
+/* Local variables -----------------------------------------------------------*/
+static const struct noise noises[] = {{3, 0}, {6, 0}, {3, 0.01}};
+static struct noise cur_noise;
+static uint32_t now_us;
+static uint16_t last_raw;       /* Last sample of A1, unfiltered */
+
+/* Function definitions ------------------------------------------------------*/
+/* Brief  : Returns a normally distributed random number
+ * Author : Rasmus Kallqvist */
+static double gauss(void)
+{
+    double u = (rand() + 1.0) / (RAND_MAX + 2.0);
+    double v = (rand() + 1.0) / (RAND_MAX + 2.0);
+
+    return sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+}
+
+/* Brief  : Returns one noisy sample of the potentiometer at pos
+ * Author : Rasmus Kallqvist */
+static uint16_t sample(double pos)
+{
+    double x = pos + cur_noise.sigma * gauss();
+
+    if(rand() < cur_noise.spikes * RAND_MAX)
+        x += rand() & 0x1 ? SPIKE : -SPIKE;
+    x = floor(x + 0.5);
+    return x < 0 ? 0 : (x > 1023 ? 1023 : x);
+}
+
+/* Brief  : Fills the half of the result buffers the ADC is done with with
+ *          ADC_IRQ_SCANS scans of all inputs at pos and runs the ADC
+ *          interrupt
+ * Author : Rasmus Kallqvist */
+static void adc_interrupt(double pos)
+{
+    int k, first = AD1CON2 & (0x1 << 7) ? 0 : 8;
+
+    for(k = 0; k < ADC_SCAN_COUNT * ADC_IRQ_SCANS; k++)
+        board_regs[BOARD_ADC1BUF(first + k)] = sample(pos);
+    last_raw = board_regs[BOARD_ADC1BUF(first + 1)];
+    input_adc_isr();
+    AD1CON2 ^= 0x1 << 7;
+    now_us += ADC_IRQ_SCANS * SCAN_US;
+}
+
+/* Brief  : Returns the racket row of an analog value, as pong_update_step()
+ * Author : Rasmus Kallqvist */
+static int row(int value)
+{
+    return value * RACKET_ROWS / 1024;
+}
+
+/* Brief  : Holds the potentiometer at positions across the range and
+ *          counts the row flips per second, raw and filtered
+ * Author : Rasmus Kallqvist */
+static void count_flips(double *raw, double *filtered)
+{
+    uint32_t start, next;
+    long frames = 0, raw_flips = 0, flips = 0;
+    int k, last_row, last_raw_row, r;
+    double pos;
+
+    for(k = 0; k < POSITIONS; k++)
+    {
+        /* Steps of 4.9 units land on and between pixel boundaries */
+        pos = 20 + k * 4.9;
+        start = now_us;
+        next = now_us;
+        last_row = last_raw_row = -1;
+        while(now_us - start < HOLD_US)
+        {
+            adc_interrupt(pos);
+            if(now_us < next)
+                continue;
+            next += READ_US;
+            if(now_us - start < SETTLE_US)
+                continue;
+            frames++;
+            r = row(input_get_analog(1));
+            flips += last_row >= 0 && r != last_row;
+            last_row = r;
+            r = row(last_raw);
+            raw_flips += last_raw_row >= 0 && r != last_raw_row;
+            last_raw_row = r;
+        }
+    }
+    *raw = raw_flips * 120.0 / frames;
+    *filtered = flips * 120.0 / frames;
+}
+
+/* Brief  : Moves the potentiometer from one position to another, and
+ *          returns the time until the racket is on the new row for good
+ * Author : Rasmus Kallqvist */
+static uint32_t settle_time(double from, double to)
+{
+    uint32_t start, settled = 0;
+    int target = row(to), on_target = 0;
+
+    for(start = now_us; now_us - start < 200000; )
+        adc_interrupt(from);
+    for(start = now_us; now_us - start < 600000; )
+    {
+        adc_interrupt(to);
+        if(row(input_get_analog(1)) != target)
+            on_target = 0;
+        else if(!on_target)
+        {
+            on_target = 1;
+            settled = now_us - start;
+        }
+    }
+    return on_target ? settled : UINT32_MAX;
+}
+
+int main(void)
+{
+    static const double from[] = {200, 500, 100, 900, 510};
+    static const double to[] = {800, 560, 950, 90, 530};
+    double raw, filtered;
+    uint32_t t, worst = 0;
+    int i;
+
+    board_reset();
+    init_adc();
+    srand(22);
+
+    printf("noise               raw flips/s   filtered flips/s\n");
+    for(i = 0; i < (int) (sizeof(noises) / sizeof(noises[0])); i++)
+    {
+        cur_noise = noises[i];
+        count_flips(&raw, &filtered);
+        printf("sigma %.0f, %2.0f%% spikes   %8.2f %14.3f\n",
+               cur_noise.sigma, cur_noise.spikes * 100, raw, filtered);
+        CHECK(filtered < MAX_FLIPS && filtered < raw / 50);
+    }
+
+    /* Latency with the noise and spikes of the last test */
+    for(i = 0; i < (int) (sizeof(from) / sizeof(from[0])); i++)
+    {
+        t = settle_time(from[i], to[i]);
+        CHECK(t <= MAX_SETTLE_US);
+        worst = t > worst ? t : worst;
+        printf("step %4.0f to %4.0f, %2d rows: settled in %.1f ms\n", from[i],
+               to[i], abs(row(to[i]) - row(from[i])), t / 1000.0);
+    }
+    printf("worst settling %.1f ms, %.1f update steps\n", worst / 1000.0,
+           (double) worst / READ_US);
+
+    return board_result("test_filter");
+}
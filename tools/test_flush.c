@@ -0,0 +1,95 @@
+/*
+********************************************************************************
+* name   :  test_flush.c
+* author :  Rasmus Kallqvist, 2017
+* brief  :  Host test of the interrupt driven flush in display.c. The spi2
+*           interrupt is run by hand while its enable bit is set. The next
+*           frame is drawn to the back buffer halfway through each flush,
+*           which must not change what is being sent. Checks that graphic
+*           ram matches the front buffer after every frame, that D/C is only
+*           toggled between bytes, and prints the interrupts per frame.
+*           Built and run by make check, see the Makefile.
+********************************************************************************
+*/
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "board.h"
+#include "display.c"
+#include "trig.c"
+
+/* Defines -------------------------------------------------------------------*/
+#define FRAMES          3000
+#define NO_DRAW         0xFFFFFFFF
+
+/* Function definitions ------------------------------------------------------*/
+/* Brief  : Runs the spi2 interrupt while it is enabled, and returns the
+ *          number of times it ran. Draws the next frame after draw_at
+ *          interrupts, or after the flush if it is shorter. Pass
+ *          NO_DRAW to only flush.
+ * Author : Rasmus Kallqvist */
+static uint32_t run_flush(uint32_t draw_at)
+{
+    uint32_t n = 0;
+
+    while(IEC(1) & (0x1 << 7))
+    {
+        if(n == draw_at)
+            board_random_frame(0);
+        display_flush_isr();
+        n++;
+    }
+    if(draw_at != NO_DRAW && n <= draw_at)
+        board_random_frame(0);
+    return n;
+}
+
+int main(void)
+{
+    uint8_t front[4][DISPLAY_WIDTH];
+    uint64_t isrs = 0;
+    uint32_t n, bytes;
+    int f;
+
+    board_reset();
+    init_display();
+
+    /* Empty frame, nothing to send and nothing left running */
+    display_flush_begin();
+    CHECK(!display_flush_busy());
+    CHECK(!(IEC(1) & (0x1 << 7)));
+
+    /* Two rackets. display_flush_begin() sends the first byte, each
+       interrupt the next, and the last interrupt stops the flush */
+    display_cls();
+    display_draw_rectfill(10, 3, 13, 15, 1);
+    display_draw_rectfill(100, 20, 103, 32, 1);
+    bytes = display_get_spi_bytes();
+    display_flush_begin();
+    CHECK(display_flush_busy());
+    n = run_flush(NO_DRAW);
+    CHECK(!display_flush_busy());
+    CHECK(display_get_spi_bytes() - bytes == n);
+    CHECK(board_ram_matches(screen_front));
+
+    /* Random frames, each drawn during the flush of the one before */
+    srand(2);
+    board_random_frame(0);
+    for(f = 0; f < FRAMES; f++)
+    {
+        display_flush_begin();
+        memcpy(front, screen_front, sizeof(front));
+        n = run_flush(rand() % 200);
+        isrs += n;
+        if(!CHECK(board_ram_matches(screen_front)) ||
+           !CHECK(!memcmp(front, screen_front, sizeof(front))))
+            break;
+    }
+    printf("random frames: %.1f spi2 interrupts per frame, "
+           "display_flush_begin() sends 1 byte\n", (double) isrs / FRAMES);
+    CHECK(oled.unpowered_bytes == 0);
+
+    return board_result("test_flush");
+}
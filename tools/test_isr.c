@@ -0,0 +1,186 @@
+/*
+********************************************************************************
+* name   :  test_isr.c
+* author :  Rasmus Kallqvist, 2017
+* brief  :  Host test of the per vector interrupt dispatch in isr.c. The
+*           entry code of vectors.S and the interrupt control of init.S are
+*           modelled in C: a vector stub calls the entry code installed in
+*           _isr_primary_install with its vector number, the fast entry
+*           falls back to the trampoline unless the shadow register set is
+*           in use, and the trampoline calls user_isr() for vectors without
+*           a handler. Checks init_isr() and isr_install() against that
+*           model, with and without a shadow register set. Built and run by
+*           make check, see the Makefile.
+********************************************************************************
+*/
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "board.h"
+#include "isr.c"
+
+/* Defines -------------------------------------------------------------------*/
+#define MVEC            (0x1 << 12)     /* INTCON multi-vector mode */
+
+/* Global variables ----------------------------------------------------------*/
+void (*_isr_primary_install[ISR_VECTORS])(void);
+
+/* Local variables -----------------------------------------------------------*/
+/* Model of the cpu */
+static uint32_t entry_vector;   /* $k1, set by the vector stub           */
+static uint32_t cur_set;        /* SRSCtl CSS, register set in use       */
+static uint32_t shadow_sets;    /* SRSCtl HSS, shadow sets there are     */
+static uint32_t int_enabled;    /* Status IE                             */
+static void *shadow_sp;         /* Shadow set $sp, from shadow_set_init  */
+/* What ran */
+static int trampolines, fasts, disables, restores;
+static int calls[ISR_VECTORS];
+static int user_calls;
+
+/* Function definitions ------------------------------------------------------*/
+/* Brief  : Handlers that count their calls
+ * Author : Rasmus Kallqvist */
+void user_isr(void)
+{
+    user_calls++;
+}
+
+static void handler_0(void)  { calls[0]++; }
+static void handler_27(void) { calls[27]++; }
+static void handler_31(void) { calls[31]++; }
+
+/* Brief  : Model of _isr_trampoline in vectors.S
+ * Author : Rasmus Kallqvist */
+void _isr_trampoline(void)
+{
+    trampolines++;
+    if(isr_handlers[entry_vector])
+        isr_handlers[entry_vector]();
+    else
+        user_isr();
+}
+
+/* Brief  : Model of _isr_fast in vectors.S
+ * Author : Rasmus Kallqvist */
+void _isr_fast(void)
+{
+    if(cur_set == 0)
+    {
+        _isr_trampoline();
+        return;
+    }
+    fasts++;
+    isr_handlers[entry_vector]();
+}
+
+/* Brief  : Models of the interrupt control in init.S
+ * Author : Rasmus Kallqvist */
+void enable_interrupt(void)
+{
+    int_enabled = 1;
+}
+
+uint32_t disable_interrupt(void)
+{
+    uint32_t status = int_enabled;
+
+    disables++;
+    int_enabled = 0;
+    return status;
+}
+
+void restore_interrupt(uint32_t status)
+{
+    restores++;
+    int_enabled = status;
+}
+
+uint32_t shadow_set_init(void *sp)
+{
+    if(shadow_sets)
+        shadow_sp = sp;
+    return shadow_sets;
+}
+
+/* Brief  : Raises the interrupt of vector on register set set, the way the
+ *          vector stub enters it
+ * Author : Rasmus Kallqvist */
+static void raise(uint8_t vector, uint32_t set)
+{
+    entry_vector = vector;
+    cur_set = set;
+    _isr_primary_install[vector]();
+}
+
+/* Brief  : Points every vector at the trampoline, as vectors.S does
+ * Author : Rasmus Kallqvist */
+static void reset_vectors(void)
+{
+    int v;
+
+    for(v = 0; v < ISR_VECTORS; v++)
+    {
+        _isr_primary_install[v] = _isr_trampoline;
+        isr_handlers[v] = 0;
+    }
+}
+
+int main(void)
+{
+    board_reset();
+    reset_vectors();
+
+    /* With a shadow set, its stack is the top of isr_stack */
+    shadow_sets = 1;
+    int_enabled = 1;
+    init_isr();
+    CHECK(INTCON & MVEC);
+    CHECK(shadow_sp == (void *) &isr_stack[ISR_STACK_BYTES / 8]);
+    CHECK(((uintptr_t) shadow_sp & 0x7) == 0);
+
+    /* Installs as main() does, interrupts are restored after each */
+    isr_install(ISR_VECTOR_CORE_TIMER, handler_0, 1);
+    isr_install(ISR_VECTOR_ADC, handler_27, 1);
+    isr_install(ISR_VECTOR_SPI2, handler_31, 0);
+    CHECK(disables == 3 && restores == 3 && int_enabled);
+    CHECK(_isr_primary_install[ISR_VECTOR_CORE_TIMER] == _isr_fast);
+    CHECK(_isr_primary_install[ISR_VECTOR_ADC] == _isr_fast);
+    CHECK(_isr_primary_install[ISR_VECTOR_SPI2] == _isr_trampoline);
+    CHECK(_isr_primary_install[1] == _isr_trampoline);
+
+    /* Each vector reaches its own handler, fast ones without the
+       trampoline when on the shadow set */
+    raise(ISR_VECTOR_CORE_TIMER, 1);
+    raise(ISR_VECTOR_ADC, 1);
+    raise(ISR_VECTOR_SPI2, 0);
+    CHECK(calls[0] == 1 && calls[27] == 1 && calls[31] == 1);
+    CHECK(fasts == 2 && trampolines == 1 && user_calls == 0);
+
+    /* A fast handler at the wrong priority still runs, the slow way */
+    raise(ISR_VECTOR_ADC, 0);
+    CHECK(calls[27] == 2 && fasts == 2 && trampolines == 2);
+
+    /* Vectors without a handler go to user_isr() */
+    raise(5, 0);
+    CHECK(user_calls == 1);
+
+    /* Moving a vector to the trampoline */
+    isr_install(ISR_VECTOR_ADC, handler_27, 0);
+    raise(ISR_VECTOR_ADC, 1);
+    CHECK(calls[27] == 3 && fasts == 2 && trampolines == 4);
+
+    /* Without a shadow set, fast installs fall back to the trampoline */
+    reset_vectors();
+    shadow_sets = 0;
+    shadow_sp = 0;
+    init_isr();
+    CHECK(shadow_sp == 0);
+    isr_install(ISR_VECTOR_CORE_TIMER, handler_0, 1);
+    CHECK(_isr_primary_install[ISR_VECTOR_CORE_TIMER] == _isr_trampoline);
+    raise(ISR_VECTOR_CORE_TIMER, 0);
+    CHECK(calls[0] == 2 && trampolines == 5);
+
+    return board_result("test_isr");
+}
@@ -0,0 +1,299 @@
+/*
+********************************************************************************
+* name   :  test_loop.c
+* author :  Rasmus Kallqvist, 2017
+* brief  :  Host test of the game loop in main.c, game_loop_work(), with the
+*           rest of the firmware. The core timer is a counter the test moves
+*           on, and updates and drawing take time on it. The display takes
+*           a set time to show each frame. Checks that the game is updated
+*           once per PONG_STEP_US of time passed, that a frame is only drawn
+*           when the display is done with the last one and the game moved
+*           on, that updates never drawn are counted, that a long stall is
+*           cut to GAME_MAX_LAG_US, and that the pause screen shows the
+*           statistics. Interrupts come during updates and in between,
+*           taking time too, and the idle time must leave out all of them
+*           and the work of the loop exactly once. Built and run by make
+*           check, with GAME_STATS, see the Makefile.
+********************************************************************************
+*/
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "board.h"
+#include "display.c"
+#include "drawlist.c"
+#include "trig.c"
+#include "pong.c"
+#include "pong_draw.c"
+#include "ai.c"
+#include "input.c"
+#include "menu.c"
+#include "effects.c"
+#include "schedule.c"
+
+/* Defines -------------------------------------------------------------------*/
+#define STEP_TICKS      SCHED_US(PONG_STEP_US)
+#define STEP_COST       SCHED_US(300)   /* Time an update takes */
+#define DRAW_COST       SCHED_US(1500)  /* Time drawing a frame takes */
+#define SPIN            SCHED_US(150)   /* Time of a pass with nothing to do */
+#define INT_COST        SCHED_US(50)    /* Time an interrupt takes */
+#define ENTRY_TICKS     23              /* Of which entering sched_isr() */
+
+/* Local variables -----------------------------------------------------------*/
+static uint32_t count;          /* Core timer */
+static uint32_t flush_done;     /* Core timer count the display is done at */
+static uint32_t flush_ticks;    /* Time the display takes with a frame */
+static uint32_t steps, draws, pauses, undrawn, dropped;
+static uint32_t work, irqs;     /* Time working and interrupts, this second */
+static uint32_t entry;          /* Entry ticks of the interrupts, 0 if none
+                                   are core timer ones */
+
+/* Local function prototypes -------------------------------------------------*/
+static void interrupt(void);
+
+/* Function definitions ------------------------------------------------------*/
+/* Brief  : Core timer and interrupt control of init.S, and the interrupt
+ *          vectors of isr.c, on the host
+ * Author : Rasmus Kallqvist */
+uint32_t core_timer_read(void)
+{
+    return count;
+}
+
+void core_timer_compare(uint32_t compare)
+{
+    (void) compare;
+}
+
+void enable_interrupt(void)
+{
+}
+
+uint32_t disable_interrupt(void)
+{
+    return 1;
+}
+
+void restore_interrupt(uint32_t status)
+{
+    (void) status;
+}
+
+void init_isr(void)
+{
+}
+
+void isr_install(uint8_t vector, void (*handler)(void), uint8_t fast)
+{
+    (void) vector;
+    (void) handler;
+    (void) fast;
+}
+
+/* Brief  : Update and drawing of the game loop, counted and taking time.
+ *          An interrupt comes during each of them.
+ * Author : Rasmus Kallqvist */
+static void test_pong_step(struct pong_ctx *ctx, struct pong_ai *ai)
+{
+    pong_step(ctx, ai);
+    count += STEP_COST;
+    work += STEP_COST;
+    interrupt();
+    steps++;
+    undrawn++;
+}
+
+static void test_pong_draw(struct pong_ctx *ctx)
+{
+    /* Would wait for the display forever */
+    if(!CHECK(!display_flush_busy()))
+        return;
+    CHECK(undrawn > 0);
+    pong_draw(ctx);
+    dropped += undrawn - 1;
+    undrawn = 0;
+    count += DRAW_COST;
+    work += DRAW_COST;
+    interrupt();
+    flush_done = count + flush_ticks;
+    draws++;
+}
+
+static void test_pong_pause(struct pong_ctx *ctx)
+{
+    if(!CHECK(!display_flush_busy()))
+        return;
+    pong_pause(ctx);
+    count += DRAW_COST;
+    work += DRAW_COST;
+    interrupt();
+    pauses++;
+}
+
+/* The game loop, calling the counted functions */
+#define main        firmware_main
+#define pong_step   test_pong_step
+#define pong_draw   test_pong_draw
+#define pong_pause  test_pong_pause
+#include "main.c"
+#undef main
+#undef pong_step
+#undef pong_draw
+#undef pong_pause
+
+/* Brief  : An interrupt handler of main.c taking INT_COST. Core timer ones
+ *          are entered entry ticks after the compare match.
+ * Author : Rasmus Kallqvist */
+static void interrupt(void)
+{
+    if(entry)
+        sched_latency = entry;
+    count += INT_COST;
+    interrupt_ticks += INT_COST;
+    interrupt_count++;
+    work += INT_COST;
+    irqs++;
+}
+
+/* Brief  : Lets the display finish the frame it is showing
+ * Author : Rasmus Kallqvist */
+static void run_flush(void)
+{
+    while(display_flush_busy())
+        display_flush_isr();
+}
+
+/* Brief  : Runs the game loop for us microseconds, with an interrupt and
+ *          nothing else in between. The display finishes each frame
+ *          flush_ticks after it was drawn. Checks the statistics of each
+ *          second played, but for the one after a pause. Returns the
+ *          updates run.
+ * Author : Rasmus Kallqvist */
+static uint32_t run(uint32_t us)
+{
+    static uint8_t toggled;
+    uint32_t end = count + SCHED_US(us), first = steps, stat = loop_stat;
+    uint32_t idle;
+    uint8_t paused;
+
+    while((int32_t) (end - count) > 0)
+    {
+        paused = loop_paused;
+        game_loop_work();
+        toggled |= paused != loop_paused;
+        if(loop_stat != stat)
+        {
+            if(!toggled && !loop_paused)
+            {
+                idle = 100 - work / ((loop_stat - stat) / 100);
+                CHECK(game_frames_dropped() == dropped);
+                CHECK(game_interrupt_rate() == irqs);
+                CHECK(game_idle_percent() == idle);
+                CHECK(game_isr_latency() == (entry ? 2 * entry :
+                                             SCHED_NO_LATENCY));
+            }
+            toggled = paused != loop_paused;
+            dropped = work = irqs = 0;
+            stat = loop_stat;
+        }
+        count += SPIN;
+        interrupt();
+        if((int32_t) (count - flush_done) >= 0)
+            run_flush();
+    }
+    return steps - first;
+}
+
+int main(void)
+{
+    struct input_event press = {0, INPUT_BTN(3), 1};
+    uint32_t start, lag, n, dropped_played, ref_words[4][DISPLAY_WIDTH / 4];
+    uint8_t (*ref)[128] = (uint8_t (*)[128]) ref_words;
+    char top[17], text[17];
+
+    board_reset();
+    init_display();
+    pong_setup(&game);
+    count = 1000;
+    game_loop_begin(0);
+
+    /* A display faster than the game shows every update */
+    flush_ticks = SCHED_US(4000);
+    lag = loop_lag;
+    start = loop_last;
+    n = run(3000000);
+    CHECK(n == (loop_last - start + lag) / STEP_TICKS);
+    CHECK(draws == n && game_frames_dropped() == 0);
+    printf("display of 4 ms: %u updates, %u drawn\n", (unsigned) n,
+           (unsigned) draws);
+
+    /* A slow one is drawn when it is done, updates in between are lost.
+       Frames without changes take it no time. The core timer interrupts
+       from here on. */
+    flush_ticks = SCHED_US(20000);
+    entry = ENTRY_TICKS;
+    interrupt();
+    draws = 0;
+    lag = loop_lag;
+    start = loop_last;
+    n = run(3000000);
+    CHECK(n == (loop_last - start + lag) / STEP_TICKS);
+    CHECK(draws < n && game_frames_dropped() > 0);
+    printf("display of 20 ms: %u updates, %u drawn, %u dropped in the last "
+           "second\n", (unsigned) n, (unsigned) draws,
+           (unsigned) game_frames_dropped());
+
+    /* After a stall the game catches up on GAME_MAX_LAG_US at most */
+    flush_ticks = SCHED_US(4000);
+    run_flush();
+    count += SCHED_US(1000000);
+    n = steps;
+    draws = 0;
+    game_loop_work();
+    CHECK(steps - n == SCHED_US(GAME_MAX_LAG_US) / STEP_TICKS);
+    CHECK(draws == 1);
+    CHECK(game_frames_dropped() == dropped);
+    dropped = work = irqs = 0;
+    printf("stall of 1 s: %u updates to catch up\n", (unsigned) (steps - n));
+    flush_ticks = SCHED_US(20000);
+    run(2000000);
+
+    /* Paused, the game stands still and the pause screen shows the last
+       second played */
+    dropped_played = game_frames_dropped();
+    input_event_put(&press);
+    run(100000);
+    CHECK(pauses > 0);
+    n = steps;
+    run(3000000);
+    CHECK(steps == n);
+    CHECK(game_frames_dropped() == dropped_played);
+    board_sync();
+    snprintf(top, sizeof(top), "irq %u lat %u",
+             (unsigned) game_interrupt_rate(), (unsigned) game_isr_latency());
+    snprintf(text, sizeof(text), "drop %u idle %u%%",
+             (unsigned) game_frames_dropped(),
+             (unsigned) game_idle_percent());
+    display_draw_to(ref, 0, 1);
+    display_draw_rectfill(0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT, 0);
+    display_print(top, 0, 0);
+    display_draw_to(ref + 1, 3, 1);
+    display_draw_rectfill(0, 24, DISPLAY_WIDTH, DISPLAY_HEIGHT, 0);
+    display_print(text, 0, 24);
+    display_draw_to(0, 0, 4);
+    CHECK(dropped_played > 0 && game_interrupt_rate() > 0);
+    CHECK(game_idle_percent() > 0 && game_idle_percent() < 100);
+    CHECK(game_isr_latency() == 2 * ENTRY_TICKS);
+    CHECK(!memcmp(oled.ram[0], ref[0], DISPLAY_WIDTH));
+    CHECK(!memcmp(oled.ram[3], ref[1], DISPLAY_WIDTH));
+    printf("pause screen: \"%s\", \"%s\"\n", top, text);
+
+    /* And goes on from where it was */
+    input_event_put(&press);
+    run(100000);
+    CHECK(steps > n);
+
+    return board_result("test_loop");
+}
@@ -0,0 +1,192 @@
+/*
+********************************************************************************
+* name   :  test_physics.c
+* author :  Rasmus Kallqvist, 2017
+* brief  :  Host test and benchmark of the Q16.16 game physics. Checks the
+*           fixed.h macros against exact 64 bit and double results, runs
+*           long rallies to check that the ball speed saturates at the
+*           maximum, checks that a ball wedged between a racket and the
+*           floor gets out, and locks in the trajectories of a recorded game by
+*           hashing the ball state after every update. The hash only changes
+*           if the game rules do, see TRAJECTORY_HASH. Prints the time of
+*           pong_update_step(). Built and run by make check, see the
+*           Makefile.
+********************************************************************************
+*/
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "board.h"
+#include "pong.c"
+
+/* Defines -------------------------------------------------------------------*/
+#define MUL_PAIRS           1000000
+#define RALLY_STEPS         200000
+#define GAME_STEPS          500000
+#define WEDGE_STEPS         PONG_UPDATE_HZ
+/* Hash of the recorded game. Update it only along with a deliberate change
+   of the game rules, and say so in the commit. */
+#define TRAJECTORY_HASH     0x3c28324bu
+
+/* Local variables -----------------------------------------------------------*/
+static uint32_t lcg = 1;    /* Own generator, the same with any libc */
+
+/* Function definitions ------------------------------------------------------*/
+/* Brief  : Returns the next 16 bit pseudo random number
+ * Author : Rasmus Kallqvist */
+static uint32_t next_rand(void)
+{
+    lcg = lcg * 1103515245u + 12345u;
+    return lcg >> 16;
+}
+
+/* Brief  : Returns a random Q16.16 value of at most bits bits, either sign
+ * Author : Rasmus Kallqvist */
+static int32_t rand_fix(int bits)
+{
+    int32_t a = (int32_t) ((next_rand() << 16 | next_rand()) >> (32 - bits));
+
+    return next_rand() & 0x1 ? -a : a;
+}
+
+/* Brief  : Returns a divided by 2^16, rounded towards minus infinity
+ * Author : Rasmus Kallqvist */
+static int64_t floor_div(int64_t a)
+{
+    int64_t q = a / FIX_ONE;
+
+    return q * FIX_ONE > a ? q - 1 : q;
+}
+
+/* Brief  : Returns the analog value that centres a racket on the ball,
+ *          missed by error pixels
+ * Author : Rasmus Kallqvist */
+static uint16_t track(struct pong_ctx *ctx, struct actor *racket, int error)
+{
+    int y = FIX_ROUND(ctx->ball.y) + 1 - racket->h / 2 + error;
+    int range = 32 - racket->h;
+
+    y = FIX_CLAMP(y, 0, range);
+    return (uint16_t) ((y * 1024 + range - 1) / range);
+}
+
+/* Brief  : Folds the ball and game state into the hash h
+ * Author : Rasmus Kallqvist */
+static uint32_t hash_ctx(uint32_t h, struct pong_ctx *ctx)
+{
+    int32_t v[7];
+    int i;
+
+    v[0] = ctx->ball.x;
+    v[1] = ctx->ball.y;
+    v[2] = ctx->ball.dx;
+    v[3] = ctx->ball.dy;
+    v[4] = ctx->pl1_score;
+    v[5] = ctx->pl2_score;
+    v[6] = ctx->state;
+    for(i = 0; i < 7; i++)
+        h = (h ^ (uint32_t) v[i]) * 16777619u;
+    return h;
+}
+
+int main(void)
+{
+    struct pong_ctx ctx;
+    uint16_t analogs[2];
+    uint32_t hash = 2166136261u;
+    int32_t a, b, max_dx = 0;
+    int i, hits = 0, bad = 0, matches = 0;
+    double t;
+
+    /* Products round towards minus infinity. Positions up to 256 pixels
+       times factors up to 2, as large as the physics uses. */
+    for(i = 0; i < MUL_PAIRS; i++)
+    {
+        a = rand_fix(24);
+        b = rand_fix(17);
+        if(FIX_MUL(a, b) != floor_div((int64_t) a * b))
+            bad++;
+    }
+    CHECK(bad == 0);
+    CHECK(FIX_MUL(-1, 1) == -1 && FIX_MUL(1, 1) == 0);
+
+    /* Rounding, conversions and constants */
+    bad = 0;
+    for(i = 0; i < MUL_PAIRS; i++)
+    {
+        a = rand_fix(30);
+        if(FIX_ROUND(a) != (int32_t) floor(a / 65536.0 + 0.5))
+            bad++;
+    }
+    CHECK(bad == 0);
+    CHECK(FIX_CONST(1.1) == 72090 && FIX_CONST(-0.25) == -16384);
+    CHECK(BALL_STEP == FIX_ONE / 4);
+    CHECK(FIX_CLAMP(FIX_FROM_INT(5), -BALL_MAXSPEED, BALL_MAXSPEED) ==
+          BALL_MAXSPEED);
+    CHECK(FIX_CLAMP(FIX_FROM_INT(-5), -BALL_MAXSPEED, BALL_MAXSPEED) ==
+          -BALL_MAXSPEED);
+    CHECK(FIX_SGN(0) == FIX_ONE && FIX_SGN(-3) == -FIX_ONE);
+
+    /* Rackets that never miss, the speed rises and saturates */
+    pong_setup(&ctx);
+    ctx.state = round_playing;
+    for(i = 0; i < RALLY_STEPS; i++)
+    {
+        analogs[0] = track(&ctx, &ctx.left_racket, 0);
+        analogs[1] = track(&ctx, &ctx.right_racket, 0);
+        pong_update_step(&ctx, analogs);
+        max_dx = FIX_ABS(ctx.ball.dx) > max_dx ? FIX_ABS(ctx.ball.dx) : max_dx;
+        if(!CHECK(FIX_ABS(ctx.ball.dx) <= BALL_MAXSPEED))
+            break;
+    }
+    hits = ctx.rally;
+    CHECK(ctx.state == round_playing && max_dx == BALL_MAXSPEED);
+    printf("rally of %d hits, top speed %.3f pixels per 1/30 s\n", hits,
+           max_dx / 65536.0);
+
+    /* Ball on the floor with the left racket held down on top of it. Both
+       bounces come at once and it would stand still, it slides out. */
+    pong_setup(&ctx);
+    ctx.state = round_playing;
+    analogs[0] = (17 * 1024 + 31 - RACKET_H) / (32 - RACKET_H);
+    analogs[1] = 512;
+    pong_update_step(&ctx, analogs);
+    ctx.ball.x = ctx.left_racket.x + FIX_ONE / 2;
+    ctx.ball.y = ctx.left_racket.y + FIX_FROM_INT(RACKET_H);
+    ctx.ball.dx = FIX_ONE;
+    ctx.ball.dy = FIX_ONE;
+    a = ctx.ball.x;
+    CHECK(ctx.ball.y + FIX_FROM_INT(ctx.ball.h) ==
+          FIX_FROM_INT(FIELD_BOTTOM));
+    for(i = 0; i < WEDGE_STEPS && ctx.ball.x < ctx.left_racket.x +
+        FIX_FROM_INT(RACKET_W); i++)
+        pong_update_step(&ctx, analogs);
+    if(!CHECK(ctx.ball.x >= ctx.left_racket.x + FIX_FROM_INT(RACKET_W)))
+        printf("wedged ball moved %.2f pixels in %d updates\n",
+               (ctx.ball.x - a) / 65536.0, i);
+    CHECK(ctx.state == round_playing);
+
+    /* Recorded game, rackets track the ball with random misses */
+    pong_setup(&ctx);
+    t = board_seconds();
+    for(i = 0; i < GAME_STEPS; i++)
+    {
+        analogs[0] = track(&ctx, &ctx.left_racket, (int) next_rand() % 21 - 10);
+        analogs[1] = track(&ctx, &ctx.right_racket, (int) next_rand() % 17 - 8);
+        pong_update_step(&ctx, analogs);
+        hash = hash_ctx(hash, &ctx);
+        matches += ctx.state == match_end && ctx.state_us == 0;
+    }
+    t = board_seconds() - t;
+    if(!CHECK(hash == TRAJECTORY_HASH))
+        printf("trajectory hash %08x, recorded %08x\n", (unsigned) hash,
+               (unsigned) TRAJECTORY_HASH);
+    CHECK(matches > 0);
+    printf("recorded game of %d matches, pong_update_step(): %.1f ns\n",
+           matches, t * 1e9 / GAME_STEPS);
+
+    return board_result("test_physics");
+}
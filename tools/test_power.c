@@ -0,0 +1,83 @@
+/*
+********************************************************************************
+* name   :  test_power.c
+* author :  Rasmus Kallqvist, 2017
+* brief  :  Host test of the timed power up in display.c. Runs
+*           display_power_begin() and display_power_work() with the delays
+*           they ask for, the way the timer interrupt does, while the title
+*           frame is drawn. Checks the order of the power sequence against
+*           the SSD1306 datasheet minimums, that no byte is sent to an
+*           unpowered or resetting controller, and that the first frame
+*           overwrites all of the unknown graphic ram. Prints the time from
+*           boot until the display is on. Built and run by make check, see the
+*           Makefile.
+********************************************************************************
+*/
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "board.h"
+#include "display.c"
+#include "trig.c"
+
+/* Defines -------------------------------------------------------------------*/
+/* Datasheet minimums, in microseconds */
+#define MIN_RESET_US        3       /* Reset pulse width              */
+#define MIN_VBAT_US         100000  /* VBAT to display on command     */
+
+int main(void)
+{
+    uint32_t wait;
+    int steps = 0, page, col;
+
+    board_reset();
+
+    /* Graphic ram holds garbage at power up */
+    srand(6);
+    for(page = 0; page < OLED_PAGES; page++)
+        for(col = 0; col < OLED_COLS; col++)
+            oled.ram[page][col] = rand();
+
+    /* First step powers VDD and asks for a wait */
+    wait = display_power_begin();
+    board_sync();
+    CHECK(oled.vdd && !oled.vbat);
+    CHECK(wait >= DISPLAY_VDD_DELAY_US);
+    CHECK(!display_power_ready());
+
+    /* The title frame is drawn while the display powers up */
+    display_draw_logo(45, 0);
+    display_print("press start", 20, 21);
+
+    /* Timer interrupt calls the next step when each wait is over */
+    while(wait)
+    {
+        board_time += wait;
+        wait = display_power_work();
+        board_sync();
+        steps++;
+        CHECK(display_power_ready() == (wait == 0));
+    }
+    CHECK(steps == 3);
+
+    /* Order and timing of the sequence */
+    CHECK(oled.vdd && oled.vbat && !oled.reset && oled.on);
+    CHECK(oled.vdd_time == 0);
+    CHECK(oled.reset_time >= oled.vdd_time + DISPLAY_VDD_DELAY_US);
+    CHECK(oled.reset_end_time - oled.reset_time >= MIN_RESET_US);
+    CHECK(oled.charge_pump);
+    CHECK(oled.vbat_time >= oled.reset_end_time);
+    CHECK(oled.on_time - oled.vbat_time >= MIN_VBAT_US);
+    CHECK(oled.unpowered_bytes == 0);
+
+    /* First frame resends all of graphic ram */
+    display_update();
+    board_sync();
+    CHECK(!memcmp(oled.ram, screen_front, 4 * DISPLAY_WIDTH));
+    printf("boot to display on: %.1f ms, then %u bytes in the first frame\n",
+           oled.on_time / 1000.0, (unsigned) oled.data_bytes);
+
+    return board_result("test_power");
+}
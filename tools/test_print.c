@@ -0,0 +1,153 @@
+/*
+********************************************************************************
+* name   :  test_print.c
+* author :  Rasmus Kallqvist, 2017
+* brief  :  Host test and benchmark of display_print(). Random strings at
+*           random positions, on, partly off and wholly off the screen, are
+*           checked pixel by pixel against a plain reference drawing of the
+*           font, and the dirty spans are checked to stay on the screen.
+*           The benchmark prints the match_begin text and compares it with
+*           drawing the same glyphs a pixel at a time. Built and run by
+*           make check, see the Makefile.
+********************************************************************************
+*/
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "board.h"
+#include "display.c"
+#include "trig.c"
+
+/* Defines -------------------------------------------------------------------*/
+#define STRINGS         200000
+#define BENCH_LOOPS     100000
+
+/* Local variables -----------------------------------------------------------*/
+static uint8_t ref[DISPLAY_HEIGHT][DISPLAY_WIDTH];  /* One byte per pixel */
+
+/* Function definitions ------------------------------------------------------*/
+/* Brief  : Draws at most 16 characters of s into the reference, a pixel at
+ *          a time, or into the back buffer with display_set_pixel() if
+ *          to_screen is set
+ * Author : Rasmus Kallqvist */
+static void ref_print(const char *s, int x, int y, uint8_t to_screen)
+{
+    int c, col, row, px, py;
+
+    for(c = 0; c < 16 && s[c]; c++)
+    {
+        for(col = 0; col < 8; col++)
+        {
+            for(row = 0; row < 8; row++)
+            {
+                if(!(font[(s[c] & 0x7F) * 8 + col] >> row & 0x1))
+                    continue;
+                px = x + 8 * c + col;
+                py = y + row;
+                if(px < 0 || px >= DISPLAY_WIDTH ||
+                   py < 0 || py >= DISPLAY_HEIGHT)
+                    continue;
+                if(to_screen)
+                    display_set_pixel(px, py);
+                else
+                    ref[py][px] = 1;
+            }
+        }
+    }
+}
+
+/* Brief  : Returns non-zero if the back buffer holds the reference
+ * Author : Rasmus Kallqvist */
+static int back_matches_ref(void)
+{
+    int x, y;
+
+    for(y = 0; y < DISPLAY_HEIGHT; y++)
+        for(x = 0; x < DISPLAY_WIDTH; x++)
+            if(((screen_back[y >> 3][x] >> (y & 0x7)) & 0x1) != ref[y][x])
+                return 0;
+    return 1;
+}
+
+/* Brief  : Returns non-zero if every dirty span is empty or on the screen
+ * Author : Rasmus Kallqvist */
+static int dirty_on_screen(void)
+{
+    int page;
+
+    for(page = 0; page < 4; page++)
+        if(screen_dirty_lo[page] <= screen_dirty_hi[page] &&
+           screen_dirty_hi[page] >= DISPLAY_WIDTH)
+            return 0;
+    return 1;
+}
+
+int main(void)
+{
+    char s[24];
+    int i, j, len, x, y;
+    double t, blit, pixels;
+
+    board_reset();
+    init_display();
+
+    srand(5);
+    for(i = 0; i < STRINGS; i++)
+    {
+        /* Clear now and then, so text does not pile up */
+        if(i % 8 == 0)
+        {
+            display_cls();
+            memset(ref, 0, sizeof(ref));
+        }
+
+        len = rand() % 20;
+        for(j = 0; j < len; j++)
+            s[j] = 32 + rand() % 95;
+        s[len] = 0;
+        x = rand() % 448 - 320;
+        y = rand() % 52 - 12;
+
+        display_print(s, x, y);
+        ref_print(s, x, y, 0);
+        if(!CHECK(back_matches_ref()) || !CHECK(dirty_on_screen()))
+        {
+            printf("string %d: \"%s\" at (%d,%d)\n", i, s, x, y);
+            break;
+        }
+        if(i % 8 == 7)
+        {
+            display_update();
+            board_sync();
+            CHECK(!memcmp(oled.ram, screen_front, 4 * DISPLAY_WIDTH));
+        }
+    }
+
+    /* Wholly left of the screen, nothing is marked */
+    display_copy_front();
+    display_print("abc", -24, 0);
+    CHECK(screen_dirty_lo[0] == DISPLAY_WIDTH && screen_dirty_hi[0] == 0);
+
+    /* Benchmark, the text of the match_begin screen */
+    t = board_seconds();
+    for(i = 0; i < BENCH_LOOPS; i++)
+    {
+        display_print("Playing to ", 16, 12);
+        display_print("5", 104, 12);
+    }
+    blit = board_seconds() - t;
+    t = board_seconds();
+    for(i = 0; i < BENCH_LOOPS; i++)
+    {
+        ref_print("Playing to ", 16, 12, 1);
+        ref_print("5", 104, 12, 1);
+    }
+    pixels = board_seconds() - t;
+    printf("match_begin text: %.0f glyphs/ms, %.0f glyphs/ms a pixel at a "
+           "time\n", BENCH_LOOPS * 12 / (blit * 1e3),
+           BENCH_LOOPS * 12 / (pixels * 1e3));
+
+    return board_result("test_print");
+}
@@ -0,0 +1,154 @@
+/*
+********************************************************************************
+* name   :  test_redraw.c
+* author :  Rasmus Kallqvist, 2017
+* brief  :  Host test of the incremental drawing in pong_draw.c. Plays the
+*           same games twice, once redrawing every frame from the background
+*           layer and once erasing and redrawing only the actors, with the
+*           game paused now and then. Each frame of both runs must show what
+*           the background layer with the actors and scores drawn over it
+*           shows, and the two runs the same frames. Prints the back buffer
+*           bytes touched per frame by each run, see
+*           display_get_touched_bytes(). Built and run by make check, see the
+*           Makefile.
+********************************************************************************
+*/
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "board.h"
+#include "display.c"
+#include "trig.c"
+#include "pong.c"
+#include "pong_draw.c"
+
+/* Defines -------------------------------------------------------------------*/
+#define FRAMES          20000
+#define PAUSE_EVERY     1500
+
+/* Local variables -----------------------------------------------------------*/
+static uint32_t ref_words[4][DISPLAY_WIDTH / 4];   /* Drawn from scratch */
+static uint8_t (*ref)[128] = (uint8_t (*)[128]) ref_words;
+static uint32_t frame_hash[FRAMES];
+
+/* Function definitions ------------------------------------------------------*/
+/* Brief  : Stand-ins for the board side functions pong_draw.c calls
+ * Author : Rasmus Kallqvist */
+void led_write(uint8_t write_data)
+{
+    (void) write_data;
+}
+
+uint32_t input_get_analogs(uint16_t *values)
+{
+    (void) values;
+    return 0;
+}
+
+uint16_t ai_work(struct pong_ai *ai, const struct pong_ctx *ctx)
+{
+    (void) ai;
+    (void) ctx;
+    return 0;
+}
+
+/* Brief  : Runs the spi2 interrupt until the flush is done
+ * Author : Rasmus Kallqvist */
+static void run_flush(void)
+{
+    while(display_flush_busy())
+        display_flush_isr();
+}
+
+/* Brief  : Draws a round frame into ref from scratch: the background layer,
+ *          then the actors and scores as pong_draw() does
+ * Author : Rasmus Kallqvist */
+static void draw_ref(struct pong_ctx *ctx)
+{
+    char c[2] = {0, 0};
+
+    memcpy(ref_words, layer_words, sizeof(ref_words));
+    display_draw_to(ref, 0, 4);
+    display_draw_actor(&ctx->left_racket);
+    display_draw_actor(&ctx->right_racket);
+    display_draw_actor(&ctx->ball);
+    c[0] = 0x30 + ctx->pl1_score;
+    display_print(c, 8, 10);
+    c[0] = 0x30 + ctx->pl2_score;
+    display_print(c, 128-16, 10);
+    display_draw_to(0, 0, 4);
+}
+
+/* Brief  : Plays FRAMES frames and returns the back buffer bytes touched
+ *          drawing them. Redraws every frame from the layer if full, and
+ *          records the frames shown, or checks them against the recording.
+ * Author : Rasmus Kallqvist */
+static uint32_t play(int full)
+{
+    struct pong_ctx ctx;
+    uint16_t analogs[2] = {512, 512};
+    uint32_t touched = 0, before;
+    int f, checked = 0, round_frames = 0;
+
+    board_reset();
+    init_display();
+    display_layer_invalidate();
+    pong_setup(&ctx);
+    srand(13);
+
+    for(f = 0; f < FRAMES; f++)
+    {
+        /* Player 1 follows the ball, player 2 wanders */
+        analogs[0] = FIX_ROUND(ctx.ball.y) * 1023 / 31;
+        analogs[1] = (analogs[1] + rand() % 201 - 100) & 0x3FF;
+
+        if(f % PAUSE_EVERY == PAUSE_EVERY - 1)
+        {
+            pong_pause(&ctx);
+            run_flush();
+        }
+        if(full)
+            ctx.round_drawn[0] = ctx.round_drawn[1] = 0;
+        before = display_get_touched_bytes();
+        pong_draw(&ctx);
+        touched += display_get_touched_bytes() - before;
+        run_flush();
+
+        /* Rounds are the layer with actors and scores over it */
+        if(ctx.state == round_begin || ctx.state == round_playing)
+        {
+            draw_ref(&ctx);
+            if(!CHECK(board_ram_matches(ref)) && checked++ < 5)
+                printf("%s run, frame %d differs\n", full ? "full" : "actors",
+                       f);
+            round_frames += ctx.state == round_playing;
+        }
+        if(full)
+            frame_hash[f] = oled_hash();
+        else if(!CHECK(oled_hash() == frame_hash[f]) && checked++ < 5)
+            printf("frame %d differs between the runs\n", f);
+
+        pong_update_step(&ctx, analogs);
+        pong_update_step(&ctx, analogs);
+        pong_update_step(&ctx, analogs);
+        pong_update_step(&ctx, analogs);
+    }
+    CHECK(round_frames > FRAMES / 2);
+    return touched;
+}
+
+int main(void)
+{
+    uint32_t full, actors;
+
+    full = play(1);
+    actors = play(0);
+    CHECK(actors < full);
+    printf("%d frames, bytes touched per frame: %.1f redrawing from the "
+           "layer, %.1f erasing and drawing the actors\n", FRAMES,
+           (double) full / FRAMES, (double) actors / FRAMES);
+
+    return board_result("test_redraw");
+}
@@ -0,0 +1,297 @@
+/*
+********************************************************************************
+* name   :  test_sched.c
+* author :  Rasmus Kallqvist, 2017
+* brief  :  Host test of the tickless scheduler in schedule.c. The core
+*           timer of init.S is modelled: Count runs on, the interrupt flag
+*           is raised when it reaches Compare, and sched_isr() is entered
+*           some ticks later unless interrupts are disabled. Timer callbacks
+*           take time. Checks that timers run in deadline order and not
+*           before they are due, that a periodic timer keeps its phase
+*           over many runs and skips the runs it missed, that a cancelled
+*           timer does not run, and that the one-shot chain of the display
+*           power up in display.c runs each step when its wait is over.
+*           Built and run by make check, see the Makefile.
+********************************************************************************
+*/
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "board.h"
+#include "display.c"
+#include "trig.c"
+#include "schedule.c"
+
+/* Defines -------------------------------------------------------------------*/
+#define CT_IRQ          0x1             /* IFS(0) and IEC(0) bit */
+#define ENTRY           30              /* Ticks from flag to sched_isr() */
+#define RUN_COST        SCHED_US(3)     /* Ticks a callback takes */
+#define ORDER_TIMERS    8
+#define PERIOD          SCHED_US(1000)
+#define PERIODIC_RUNS   20000
+
+/* Local variables -----------------------------------------------------------*/
+/* Model of the core timer */
+static uint32_t count;          /* Count register */
+static uint32_t compare;        /* Compare register */
+static uint32_t elapsed;        /* Ticks since the start, not wrapping */
+static uint8_t armed;           /* Count has not reached compare yet */
+static uint32_t int_enabled = 1;
+static uint8_t in_isr;
+static uint32_t entries;        /* Times sched_isr() was entered */
+/* What ran */
+static struct sched_timer timers[ORDER_TIMERS];
+static int order[ORDER_TIMERS], runs;
+static uint32_t ran_at[ORDER_TIMERS], due[ORDER_TIMERS];
+static uint32_t periodic_runs, periodic_late, periodic_drift;
+static uint32_t periodic_first;
+static uint32_t power_steps, power_waits;
+
+/* Function definitions ------------------------------------------------------*/
+/* Brief  : Core timer and interrupt control of init.S
+ * Author : Rasmus Kallqvist */
+uint32_t core_timer_read(void)
+{
+    return count;
+}
+
+void core_timer_compare(uint32_t c)
+{
+    compare = c;
+    armed = (int32_t) (compare - count) > 0;
+}
+
+void enable_interrupt(void)
+{
+    int_enabled = 1;
+}
+
+uint32_t disable_interrupt(void)
+{
+    uint32_t status = int_enabled;
+
+    int_enabled = 0;
+    return status;
+}
+
+void restore_interrupt(uint32_t status)
+{
+    int_enabled = status;
+}
+
+/* Brief  : Moves the count on by ticks, raising the interrupt flag if it
+ *          reaches compare
+ * Author : Rasmus Kallqvist */
+static void tick(uint32_t ticks)
+{
+    if(armed && compare - count <= ticks)
+    {
+        IFSSET(0) = CT_IRQ;
+        armed = 0;
+    }
+    count += ticks;
+    elapsed += ticks;
+}
+
+/* Brief  : Enters sched_isr() while the flag is set and interrupts are
+ *          enabled, the way the interrupt controller does
+ * Author : Rasmus Kallqvist */
+static void dispatch(void)
+{
+    while(int_enabled && !in_isr && (IFS(0) & IEC(0) & CT_IRQ))
+    {
+        tick(ENTRY);
+        in_isr = 1;
+        int_enabled = 0;
+        entries++;
+        sched_isr();
+        int_enabled = 1;
+        in_isr = 0;
+    }
+}
+
+/* Brief  : Lets time pass for ticks, taking the interrupts that come
+ * Author : Rasmus Kallqvist */
+static void run_for(uint32_t ticks)
+{
+    uint32_t step;
+
+    dispatch();
+    while(ticks)
+    {
+        step = armed && compare - count < ticks ? compare - count + 1 : ticks;
+        tick(step);
+        ticks -= step;
+        dispatch();
+    }
+}
+
+/* Brief  : Callback of the order test, records when it ran. Later runs
+ *          are only counted.
+ * Author : Rasmus Kallqvist */
+static void order_run(struct sched_timer *timer)
+{
+    int i = timer - timers;
+
+    if(runs < ORDER_TIMERS)
+    {
+        ran_at[i] = count;
+        order[runs] = i;
+    }
+    runs++;
+    tick(RUN_COST);
+}
+
+/* Brief  : Callback of the periodic timer, the deadline it ran for is a
+ *          whole number of periods after the first
+ * Author : Rasmus Kallqvist */
+static void periodic_run(struct sched_timer *timer)
+{
+    uint32_t ran_for = timer->deadline - timer->period;
+
+    if((ran_for - periodic_first) % PERIOD != 0)
+        periodic_drift++;
+    if((int32_t) (count - ran_for) < -SCHED_MARGIN)
+        periodic_late++;    /* Early, counted as a failure too */
+    periodic_runs++;
+    tick(RUN_COST);
+}
+
+/* Brief  : Display power up step, as display_power_tick() in main.c. The
+ *          board's clock follows the count, without its wrap.
+ * Author : Rasmus Kallqvist */
+static void power_run(struct sched_timer *timer)
+{
+    uint32_t wait;
+
+    board_time = elapsed / SCHED_TICKS_PER_US;
+    wait = display_power_work();
+    power_steps++;
+    power_waits += wait;
+    if(wait)
+        sched_add(timer, SCHED_US(wait), 0);
+    tick(RUN_COST);
+}
+
+int main(void)
+{
+    static const uint32_t delays[ORDER_TIMERS] =
+    {
+        SCHED_US(500), SCHED_US(100), SCHED_US(900), SCHED_US(100),
+        SCHED_US(1), 0, SCHED_US(300), SCHED_US(100) + 1
+    };
+    struct sched_timer periodic, power, cancelled;
+    uint32_t start, late, stalled, stalled_for, i;
+    int j, k;
+
+    board_reset();
+    count = 0xFFFFFFFF - SCHED_US(50000);       /* Wraps around early on */
+    init_sched();
+    CHECK(IEC(0) & CT_IRQ);
+    CHECK(((IPC(0) >> 2) & 0x7) == 7);
+
+    /* One-shots run in deadline order, those with the same deadline in the
+       order they were added, none before it is due */
+    start = count;
+    for(i = 0; i < ORDER_TIMERS; i++)
+    {
+        timers[i].run = order_run;
+        due[i] = count + delays[i];
+        sched_add(&timers[i], delays[i], 0);
+        dispatch();
+    }
+    memset(&cancelled, 0, sizeof(cancelled));
+    cancelled.run = order_run;
+    sched_add(&cancelled, SCHED_US(200), 0);
+    sched_cancel(&cancelled);
+    run_for(SCHED_US(2000));
+    CHECK(runs == ORDER_TIMERS);
+    for(j = 1; j < runs; j++)
+    {
+        k = order[j - 1];
+        CHECK((int32_t) (due[order[j]] - due[k]) > 0 ||
+              (due[order[j]] == due[k] && order[j] > k));
+    }
+    late = 0;
+    for(i = 0; i < ORDER_TIMERS; i++)
+    {
+        CHECK((int32_t) (ran_at[i] - due[i]) >= -SCHED_MARGIN);
+        if((int32_t) (ran_at[i] - due[i]) > (int32_t) late)
+            late = ran_at[i] - due[i];
+        CHECK(!timers[i].queued);
+    }
+    CHECK(!cancelled.queued);
+    printf("%d one-shots in deadline order, %u entries, at most %.1f us "
+           "late\n", ORDER_TIMERS, (unsigned) entries,
+           late / (double) SCHED_TICKS_PER_US);
+
+    /* A periodic timer keeps its phase whatever else runs, and the display
+       power up chain runs alongside it */
+    memset(&periodic, 0, sizeof(periodic));
+    memset(&power, 0, sizeof(power));
+    periodic.run = periodic_run;
+    power.run = power_run;
+    sched_add(&periodic, PERIOD, PERIOD);
+    periodic_first = periodic.deadline;
+    start = count;
+    board_time = elapsed / SCHED_TICKS_PER_US;
+    power_waits = display_power_begin();
+    sched_add(&power, SCHED_US(power_waits), 0);
+    srand(24);
+    for(i = 0; i < PERIODIC_RUNS / 2; i++)
+    {
+        /* Other one-shots now and then */
+        if(i % 7 == 0)
+        {
+            k = rand() % ORDER_TIMERS;
+            sched_add(&timers[k], rand() % (3 * PERIOD), 0);
+        }
+        run_for(PERIOD / 2 + rand() % PERIOD);
+    }
+    CHECK(periodic_drift == 0 && periodic_late == 0);
+    CHECK(periodic_runs >= (count - start) / PERIOD - 1);
+
+    /* Power up steps each ran when their wait was over, on time */
+    board_sync();
+    CHECK(display_power_ready() && power_steps == 3);
+    CHECK(oled.vdd && oled.vbat && !oled.reset && oled.on);
+    CHECK(oled.reset_time >= oled.vdd_time + DISPLAY_VDD_DELAY_US);
+    CHECK(oled.on_time - oled.vbat_time >= 100000);
+    CHECK(oled.on_time - oled.vdd_time <= power_waits +
+          power_steps * (RUN_COST + SCHED_MARGIN) / SCHED_TICKS_PER_US + 10);
+    CHECK(!power.queued);
+    printf("%u periodic runs, none off their phase, power up in %u steps "
+           "took %.1f ms for %.1f ms of waits\n", (unsigned) periodic_runs,
+           (unsigned) power_steps,
+           (oled.on_time - oled.vdd_time) / 1000.0,
+           power_waits / 1000.0);
+
+    /* With interrupts off for 3.5 periods the missed runs are skipped,
+       one run catches up and the next is a period later */
+    run_for(PERIOD / 3);
+    i = periodic_runs;
+    int_enabled = 0;
+    stalled = count;
+    run_for(PERIOD * 7 / 2);
+    stalled_for = count - stalled;
+    CHECK(periodic_runs == i);
+    int_enabled = 1;
+    run_for(SCHED_US(10));
+    CHECK(periodic_runs == i + 1);
+    CHECK(periodic.deadline - count <= PERIOD &&
+          periodic.deadline - count > PERIOD - SCHED_US(20));
+    run_for(PERIOD);
+    CHECK(periodic_runs == i + 2);
+    printf("interrupts off for %.1f periods: 1 run to catch up, then "
+           "every period again\n", (double) (stalled_for) / PERIOD);
+
+    /* Cancelled, it runs no more */
+    sched_cancel(&periodic);
+    i = periodic_runs;
+    run_for(10 * PERIOD);
+    CHECK(periodic_runs == i);
+
+    return board_result("test_sched");
+}
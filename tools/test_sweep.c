@@ -0,0 +1,155 @@
+/*
+********************************************************************************
+* name   :  test_sweep.c
+* author :  Rasmus Kallqvist, 2017
+* brief  :  Host property test of the swept collisions in pong.c. Fires
+*           random shots at a racket, from up to a step away and at up to
+*           ten times the maximum ball speed, so the ball moves much further
+*           than a racket is wide in one update. Every shot whose straight
+*           path crosses the racket face within its rows must bounce off it,
+*           and no shot may end inside a racket or outside the field. First
+*           checks sweep_time(), which avoids a 64 bit divide, against the
+*           64 bit quotient. Built and run by make check, see the Makefile.
+********************************************************************************
+*/
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "board.h"
+#include "pong.c"
+
+/* Defines -------------------------------------------------------------------*/
+#define SHOTS           200000
+#define MAX_SHOT_SPEED  (10 * BALL_MAXSPEED)
+#define EDGE_SLACK      (FIX_ONE / 16)  /* Grazing shots may go either way */
+#define TIMES           1000000
+
+/* Function definitions ------------------------------------------------------*/
+/* Brief  : Returns a random Q16.16 value from 0 up to but not including max
+ * Author : Rasmus Kallqvist */
+static int32_t rand_fix(int32_t max)
+{
+    return (int32_t) (((int64_t) rand() << 16 | (rand() & 0xFFFF)) % max);
+}
+
+/* Brief  : Returns the time sweep_time() must return, worked out in 64 bits
+ * Author : Rasmus Kallqvist */
+static int32_t sweep_time_64(int32_t dist, int32_t m)
+{
+    int64_t t = (int64_t) dist * FIX_ONE / m;
+
+    return (int32_t) FIX_CLAMP(t, INT32_MIN, INT32_MAX);
+}
+
+/* Brief  : Returns non-zero if actor a overlaps actor b
+ * Author : Rasmus Kallqvist */
+static int overlaps(struct actor *a, struct actor *b)
+{
+    return a->x < b->x + FIX_FROM_INT(b->w) && a->x + FIX_FROM_INT(a->w) > b->x &&
+           a->y < b->y + FIX_FROM_INT(b->h) && a->y + FIX_FROM_INT(a->h) > b->y;
+}
+
+int main(void)
+{
+    struct pong_ctx ctx;
+    struct actor *racket, *other;
+    int32_t face, x0, y0, mx, my, dist, y_at, bh;
+    int k, right, must_hit, hits = 0, tunnels = 0, inside = 0, shots = 0;
+    int32_t dists[] = {0, 1, -1, FIX_ONE, INT32_MAX, INT32_MIN + 1, INT32_MIN};
+    int32_t motions[] = {1, -1, FIX_ONE, -FIX_ONE, (0x1 << 30) - 1};
+    int i, j, wrong = 0;
+
+    /* Times without a 64 bit divide, edge cases and distances up to a
+       field across by motions up to 64 pixels */
+    for(i = 0; i < (int) (sizeof(dists) / sizeof(dists[0])); i++)
+        for(j = 0; j < (int) (sizeof(motions) / sizeof(motions[0])); j++)
+            wrong += sweep_time(dists[i], motions[j]) !=
+                     sweep_time_64(dists[i], motions[j]);
+    srand(14);
+    for(k = 0; k < TIMES; k++)
+    {
+        x0 = rand_fix(FIX_FROM_INT(256)) - FIX_FROM_INT(128);
+        mx = rand_fix(FIX_FROM_INT(128)) - FIX_FROM_INT(64);
+        if(k & 0x1)
+            mx >>= rand() % 16;
+        if(mx != 0)
+            wrong += sweep_time(x0, mx) != sweep_time_64(x0, mx);
+    }
+    CHECK(wrong == 0);
+
+    pong_setup(&ctx);
+    ctx.params.ball_maxspeed = MAX_SHOT_SPEED;
+    bh = FIX_FROM_INT(ctx.ball.h);
+
+    srand(15);
+    for(k = 0; k < SHOTS; k++)
+    {
+        /* Shot at the right or left racket, from in front of it */
+        right = rand() % 2;
+        racket = right ? &ctx.right_racket : &ctx.left_racket;
+        other = right ? &ctx.left_racket : &ctx.right_racket;
+        racket->y = FIX_FROM_INT(rand() % (32 - racket->h + 1));
+        other->y = FIX_FROM_INT(rand() % (32 - other->h + 1));
+        ctx.ball.dx = FIX_ONE + rand_fix(MAX_SHOT_SPEED - FIX_ONE);
+        ctx.ball.dy = rand_fix(2 * ctx.ball.dx + 1) - ctx.ball.dx;
+        mx = FIX_MUL(ctx.ball.dx, BALL_STEP);
+        my = FIX_MUL(ctx.ball.dy, BALL_STEP);
+        if(right)
+        {
+            face = racket->x;
+            ctx.ball.x = face - bh - rand_fix(mx + FIX_ONE);
+        }
+        else
+        {
+            face = racket->x + FIX_FROM_INT(racket->w);
+            ctx.ball.x = face + rand_fix(mx + FIX_ONE);
+            ctx.ball.dx = -ctx.ball.dx;
+            mx = -mx;
+        }
+        ctx.ball.y = racket->y - FIX_FROM_INT(2) +
+                     rand_fix(FIX_FROM_INT(racket->h + 4));
+        ctx.ball.y = FIX_CLAMP(ctx.ball.y, FIX_FROM_INT(FIELD_TOP),
+                               FIX_FROM_INT(FIELD_BOTTOM) - bh);
+
+        /* Only shots that stay clear of the roof and floor */
+        x0 = ctx.ball.x;
+        y0 = ctx.ball.y;
+        if(y0 + my < FIX_FROM_INT(FIELD_TOP) ||
+           y0 + bh + my > FIX_FROM_INT(FIELD_BOTTOM))
+            continue;
+        shots++;
+
+        /* Row of the ball where its straight path reaches the face */
+        dist = right ? face - (x0 + bh) : face - x0;
+        must_hit = 0;
+        if(FIX_ABS(dist) <= FIX_ABS(mx))
+        {
+            y_at = y0 + FIX_MUL(my, sweep_time(dist, mx));
+            must_hit = y_at + bh > racket->y + EDGE_SLACK &&
+                       y_at < racket->y + FIX_FROM_INT(racket->h) - EDGE_SLACK;
+        }
+
+        if(pong_update_ball(&ctx) != no_player)
+            continue;
+        if(must_hit)
+        {
+            hits++;
+            if(!CHECK(right ? ctx.ball.dx < 0 : ctx.ball.dx > 0) && tunnels++ < 5)
+                printf("tunnel: (%.3f,%.3f) by (%.3f,%.3f), racket at "
+                       "%.0f\n", x0 / 65536.0, y0 / 65536.0, mx / 65536.0,
+                       my / 65536.0, racket->y / 65536.0);
+        }
+        if(overlaps(&ctx.ball, racket) || overlaps(&ctx.ball, other))
+            inside++;
+        CHECK(ctx.ball.y >= FIX_FROM_INT(FIELD_TOP) &&
+              ctx.ball.y + bh <= FIX_FROM_INT(FIELD_BOTTOM));
+    }
+    CHECK(inside == 0);
+    CHECK(hits > SHOTS / 10);
+    printf("%d shots, %d across a racket face: %d tunnelled, %d ended inside "
+           "a racket\n", shots, hits, tunnels, inside);
+
+    return board_result("test_sweep");
+}
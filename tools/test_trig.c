@@ -0,0 +1,140 @@
+/*
+********************************************************************************
+* name   :  test_trig.c
+* author :  Rasmus Kallqvist, 2017
+* brief  :  Host accuracy check and benchmark of trig.c and
+*           display_draw_cos(). The sine table, the interpolated fine
+*           angles and trig_polar() are compared with libm, and the cosine
+*           wave is checked column by column against the exact curve for
+*           many periods and phases. The benchmark times drawing the wave
+*           against evaluating libm cos() per column, as the old code did.
+*           Built and run by make check, see the Makefile.
+********************************************************************************
+*/
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "board.h"
+#include "display.c"
+#include "trig.c"
+
+/* Defines -------------------------------------------------------------------*/
+#define MAX_TABLE_ERR   5e-5    /* Rounding to Q1.15 is 1.5e-5            */
+#define MAX_FINE_ERR    2e-4    /* Interpolation error is at most 7.5e-5  */
+#define ROW_SLACK       0.01    /* Rows this close to a row boundary may
+                                   round either way                        */
+#define BENCH_LOOPS     20000
+
+/* Function definitions ------------------------------------------------------*/
+/* Brief  : Draws the wave the old way, libm cos() of a double per column
+ * Author : Rasmus Kallqvist */
+static void float_draw_cos(uint32_t period, uint32_t phase)
+{
+    uint8_t x, y;
+    double angle = phase;
+
+    for(x = 0; x < 128; x++)
+    {
+        y = 16 - 16 * cos(angle * M_PI / 180);
+        display_set_pixel(x, y);
+        angle += 360.0 / period;
+    }
+}
+
+/* Brief  : Checks the drawn wave against the exact curve, and returns the
+ *          number of columns that were drawn on the wrong row
+ * Author : Rasmus Kallqvist */
+static int check_wave(uint32_t period, int phase)
+{
+    double exact;
+    int x, y, row, bad = 0;
+
+    for(x = 0; x < DISPLAY_WIDTH; x++)
+    {
+        exact = 16 - 16 * cos(2 * M_PI * (phase / 360.0 + (double) x / period));
+        row = (int) floor(exact);
+        for(y = 0; y < DISPLAY_HEIGHT; y++)
+        {
+            if(!((screen_back[y >> 3][x] >> (y & 0x7)) & 0x1))
+                continue;
+            if(y != row && fabs(exact - floor(exact + 0.5)) > ROW_SLACK)
+                bad++;
+        }
+    }
+    return bad;
+}
+
+int main(void)
+{
+    double err, max_err = 0, max_fine = 0, max_polar = 0, t, fixed, flt;
+    int32_t px, py;
+    uint32_t period;
+    int a, phase, bad = 0, waves = 0;
+
+    /* Table entries */
+    for(a = 0; a < TRIG_ANGLES; a++)
+    {
+        err = fabs(trig_sin(a) / 32768.0 - sin(2 * M_PI * a / TRIG_ANGLES));
+        max_err = err > max_err ? err : max_err;
+        err = fabs(trig_cos(a) / 32768.0 - cos(2 * M_PI * a / TRIG_ANGLES));
+        max_err = err > max_err ? err : max_err;
+    }
+    CHECK(max_err < MAX_TABLE_ERR);
+
+    /* Fine angles */
+    for(a = 0; a < TRIG_FINE_ANGLES; a++)
+    {
+        err = fabs(trig_sin_fine(a) / 32768.0 -
+                   sin(2 * M_PI * a / TRIG_FINE_ANGLES));
+        max_fine = err > max_fine ? err : max_fine;
+        err = fabs(trig_cos_fine(a) / 32768.0 -
+                   cos(2 * M_PI * a / TRIG_FINE_ANGLES));
+        max_fine = err > max_fine ? err : max_fine;
+    }
+    CHECK(max_fine < MAX_FINE_ERR);
+
+    /* Launching a Q16.16 speed of 4 pixels per step */
+    for(a = 0; a < TRIG_ANGLES; a++)
+    {
+        trig_polar(a, FIX_FROM_INT(4), &px, &py);
+        err = fabs(px / 65536.0 - 4 * cos(2 * M_PI * a / TRIG_ANGLES));
+        max_polar = err > max_polar ? err : max_polar;
+        err = fabs(py / 65536.0 - 4 * sin(2 * M_PI * a / TRIG_ANGLES));
+        max_polar = err > max_polar ? err : max_polar;
+    }
+    CHECK(max_polar < 4 * MAX_TABLE_ERR);
+    printf("sine table max error %.2g, fine angles %.2g, trig_polar %.2g "
+           "pixels\n", max_err, max_fine, max_polar);
+
+    /* Waves, including periods that do not divide 360 and negative phase */
+    board_reset();
+    for(period = 1; period <= 256; period++)
+    {
+        for(phase = -360; phase < 720; phase += 37)
+        {
+            display_cls();
+            display_draw_cos(period, phase);
+            bad += check_wave(period, phase);
+            waves++;
+        }
+    }
+    CHECK(bad == 0);
+    printf("%d waves, %d columns off the exact row\n", waves, bad);
+
+    /* Benchmark */
+    t = board_seconds();
+    for(a = 0; a < BENCH_LOOPS; a++)
+        display_draw_cos(64, a % 360);
+    fixed = board_seconds() - t;
+    t = board_seconds();
+    for(a = 0; a < BENCH_LOOPS; a++)
+        float_draw_cos(64, a % 360);
+    flt = board_seconds() - t;
+    printf("wave of 128 columns: %.0f ns from the table, %.0f ns with libm "
+           "cos()\n", fixed * 1e9 / BENCH_LOOPS, flt * 1e9 / BENCH_LOOPS);
+
+    return board_result("test_trig");
+}
@@ -0,0 +1,60 @@
+/*
+********************************************************************************
+* name   :  trig.c
+* author :  Rasmus Kallqvist, 2017
+* brief  :  Fixed point sine and cosine from a lookup table. The firmware is
+*           built with soft float, so libm cos() costs a software double
+*           precision evaluation per call. The table is generated at build
+*           time by tools/gen_trig.c.
+********************************************************************************
+*/
+
+/* Includes ------------------------------------------------------------------*/
+#include "trig.h"
+#include "trig_table.h"   /* Generated sine table */
+
+/* Function definitions ------------------------------------------------------*/
+/* Brief  : Sine of a binary angle (256 per turn), in Q1.15
+ * Author : Rasmus Kallqvist */
+int16_t trig_sin(uint8_t angle)
+{
+    return trig_sin_table[angle];
+}
+
+/* Brief  : Cosine of a binary angle (256 per turn), in Q1.15
+ * Author : Rasmus Kallqvist */
+int16_t trig_cos(uint8_t angle)
+{
+    /* Cosine leads sine by a quarter turn */
+    return trig_sin_table[(uint8_t)(angle + TRIG_ANGLES / 4)];
+}
+
+/* Brief  : Sine of a fine binary angle (65536 per turn), in Q1.15. The
+ *          upper 8 bits select a table entry, the lower 8 bits interpolate
+ *          linearly towards the next one.
+ * Author : Rasmus Kallqvist */
+int16_t trig_sin_fine(uint16_t angle)
+{
+    int32_t a = trig_sin_table[angle >> 8];
+    int32_t b = trig_sin_table[(uint8_t)((angle >> 8) + 1)];
+
+    return (int16_t)(a + (((b - a) * (angle & 0xFF)) >> 8));
+}
+
+/* Brief  : Cosine of a fine binary angle (65536 per turn), in Q1.15
+ * Author : Rasmus Kallqvist */
+int16_t trig_cos_fine(uint16_t angle)
+{
+    return trig_sin_fine((uint16_t)(angle + TRIG_FINE_ANGLES / 4));
+}
+
+/* Brief  : Splits a vector of given length and angle into x and y parts,
+ *          in the same fixed point format as length. Angle 0 points along
+ *          positive x, a quarter turn along positive y. Used for launching
+ *          a ball in a given direction.
+ * Author : Rasmus Kallqvist */
+void trig_polar(uint8_t angle, int32_t length, int32_t *x, int32_t *y)
+{
+    *x = (int32_t)(((int64_t) length * trig_cos(angle)) >> TRIG_SHIFT);
+    *y = (int32_t)(((int64_t) length * trig_sin(angle)) >> TRIG_SHIFT);
+}
@@ -0,0 +1,32 @@
+/*
+********************************************************************************
+* name   :  trig.h
+* author :  Rasmus Kallqvist, 2017
+* brief  :  Header file for trig.c
+********************************************************************************
+*/
+
+#ifndef TRIG_H
+#define TRIG_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>     /* Declarations of uint_32 and the like */
+
+/* Defines -------------------------------------------------------------------*/
+/* Angles are binary, a full turn is 256 so a uint8_t wraps around by itself */
+#define TRIG_ANGLES         256
+#define TRIG_DEG(deg)       (uint8_t)(((deg) % 360) * TRIG_ANGLES / 360)
+/* Fine angles, a full turn is 65536, for stepping by fractions of an entry */
+#define TRIG_FINE_ANGLES    65536
+/* Sine and cosine are returned in Q1.15, 1.0 is 32767 */
+#define TRIG_ONE            32767
+#define TRIG_SHIFT          15
+
+/* Function prototypes -------------------------------------------------------*/
+int16_t trig_sin(uint8_t angle);
+int16_t trig_cos(uint8_t angle);
+int16_t trig_sin_fine(uint16_t angle);
+int16_t trig_cos_fine(uint16_t angle);
+void trig_polar(uint8_t angle, int32_t length, int32_t *x, int32_t *y);
+
+#endif /* TRIG_H */